@@ -0,0 +1,70 @@
+#pragma once
+
+#include <Arduino.h>
+#include <BleKeyboard.h>
+
+// Compiled keybind actions.
+//
+// Keybind strings ("CTRL+SHIFT+Z", "TYPE:hello", "MACRO:...") are compiled
+// once at load time into a small fixed-size program, so the press path runs
+// without any String parsing or heap allocation.
+//
+// Program layout: a byte stream of opcodes, each followed by its operands,
+// terminated by ACTION_OP_END. A program is either a combo (MODS/KEY), text
+// (TEXT), a momentary layer key (LAYER), the timer menu (MENU) or a macro
+// (MACRO followed by step opcodes run by MacroEngine).
+
+enum ActionOp : uint8_t {
+  ACTION_OP_END = 0x00,
+  ACTION_OP_MODS = 0x01,     // operand: modifier bits, held while the key is down
+  ACTION_OP_KEY = 0x02,      // operand: HID usage ID, held while the key is down
+  ACTION_OP_TEXT = 0x03,     // no operand: types `text` once on the press edge
+  ACTION_OP_MACRO = 0x04,    // no operand: rest of the program is macro steps
+  ACTION_OP_LAYER = 0x05,    // operand: layer index, active while the key is down
+  ACTION_OP_MENU = 0x06,     // no operand: opens the timer menu on the press edge
+
+  // Macro steps
+  ACTION_OP_PRESS_MODS = 0x10,   // operand: modifier bits to press
+  ACTION_OP_PRESS_KEY = 0x11,    // operand: usage to press
+  ACTION_OP_RELEASE_MODS = 0x12, // operand: modifier bits to release
+  ACTION_OP_RELEASE_KEY = 0x13,  // operand: usage to release
+  ACTION_OP_SYNC = 0x14,         // no operand: send the report now
+  ACTION_OP_WAIT = 0x15,         // operands: ms (lo, hi)
+  ACTION_OP_REPEAT = 0x16,       // operand: total passes (1..255) of the block up to LOOP
+  ACTION_OP_LOOP = 0x17,         // no operand: end of a REPEAT block
+};
+
+static constexpr size_t ACTION_PROGRAM_BYTES = 64;
+
+struct ActionProgram {
+  uint8_t code[ACTION_PROGRAM_BYTES] = {ACTION_OP_END};
+  // TYPE: text. Points into the source String, which must outlive the program
+  // and must not be modified afterwards.
+  const char* text = nullptr;
+  uint16_t textLength = 0;
+};
+
+// Compiles one keybind string. Invalid tokens are left out of the program and
+// described in `error`; returns false if there was any.
+bool actionCompile(const String& source, ActionProgram& out, String& error);
+
+// Adds everything the program holds while its key is down to `report`.
+void actionApplyHeld(const ActionProgram& program, KeyReport& report);
+
+// A held key switching from `from` to `to` (a depth change) keeps the usages
+// both hold down, so the host would never see them pressed again. Removes
+// those usages from `report` (the last report sent) to give the frame that
+// releases them before `to` goes out. Returns false when nothing is shared.
+bool actionReleaseShared(const ActionProgram& from, const ActionProgram& to, KeyReport& report);
+
+// True if the program types text on the press edge.
+bool actionHasText(const ActionProgram& program);
+
+// True if the program is a macro (run by MacroEngine on the press edge).
+bool actionIsMacro(const ActionProgram& program);
+
+// Layer index a LAYER: key switches to while held, or -1.
+int actionLayer(const ActionProgram& program);
+
+// True if the program opens the timer menu.
+bool actionIsMenu(const ActionProgram& program);
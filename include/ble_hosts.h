@@ -0,0 +1,54 @@
+#pragma once
+
+#include <Arduino.h>
+#include <BLEDevice.h>
+
+// Bonded BLE host slots.
+//
+// The pad keeps one Bluetooth identity but remembers up to BLE_HOST_SLOTS
+// bonded hosts (address + type in NVS; the keys themselves stay in
+// Bluedroid's bond store). Only the selected slot's host is let in: the
+// advertising connect filter uses the controller whitelist, so the other
+// bonded hosts can't grab the link and the selected one reconnects on its
+// stored bond with no pairing round trip.
+//
+// Selecting an empty slot advertises openly; the next host to bond fills it.
+// If the selected host hasn't come back within BLE_HOST_OPEN_AFTER_MS the
+// filter is dropped so any bonded host can connect (and becomes selected).
+
+static constexpr size_t BLE_HOST_SLOTS = 3;
+static constexpr uint32_t BLE_HOST_OPEN_AFTER_MS = 15000;
+
+// Loads the slots and applies the filter. Call once after bleLinkBegin().
+void bleHostsBegin(const char* prefsNamespace);
+
+// Switches to `slot`: drops the current host (if another one) and lets only
+// the slot's host reconnect. Returns false for an invalid slot.
+bool bleHostsSelect(size_t slot);
+
+// Removes the slot's host and its bond (the host has to pair again).
+void bleHostsForget(size_t slot);
+
+size_t bleHostsActive();
+bool bleHostsSlotUsed(size_t slot);
+
+// Call from the HID output task on every wake: records newly bonded hosts,
+// saves slot changes, opens the filter on timeout and logs reconnect times.
+void bleHostsService(uint32_t nowMs);
+
+// Event hooks, called from ble_link's Bluedroid handlers (the stack only
+// takes one custom handler of each kind).
+void bleHostsOnGattsEvent(esp_gatts_cb_event_t event, esp_ble_gatts_cb_param_t* param);
+void bleHostsOnGapEvent(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param);
+
+struct BleHostStats {
+  uint8_t activeSlot = 0;
+  uint8_t usedMask = 0;         // Bit per slot holding a bonded host
+  bool open = false;            // Connect filter off (pairing or fallback)
+  uint32_t reconnectMs = 0;     // Last select/boot -> encrypted link, known host
+  uint32_t reconnectMaxMs = 0;  // Slowest one seen
+  uint32_t reconnects = 0;      // Measured reconnects
+  uint32_t switches = 0;        // bleHostsSelect() calls that changed host
+};
+
+void bleHostsGetStats(BleHostStats& out);
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <Arduino.h>
+
+// BLE link events.
+//
+// Hooks the Bluedroid GATT server and GAP event streams (alongside the
+// BleKeyboard library, which keeps its own handlers) so that:
+// - output can be paced on real notification completion instead of fixed sleeps;
+// - the link asks for the shortest connection interval / zero slave latency
+//   the host will accept while keys are in use, and drops to a low-power
+//   interval after a period of inactivity;
+// - notification, congestion and connection-parameter stats are available.
+
+// Installs the event hooks. Call once after bleKeyboard.begin().
+void bleLinkBegin();
+
+// Call right before sending a notification; clears any stale completion.
+void bleLinkArmNotify();
+
+// Waits until the armed notification has been handed to the controller
+// (ESP_GATTS_CONF_EVT). Returns false on timeout.
+bool bleLinkWaitNotifyDone(uint32_t timeoutMs);
+
+// Call from the HID output task on every wake. `active` = output happened
+// (or is about to). Switches between fast and low-power parameters and
+// logs parameter changes on Serial.
+void bleLinkService(uint32_t nowMs, bool active);
+
+struct BleLinkStats {
+  bool connected = false;
+  bool lowPower = false;          // Idle parameters requested
+  bool congested = false;         // Stack reports the link congested right now
+  uint32_t intervalUs = 0;        // Negotiated connection interval
+  uint16_t latency = 0;           // Negotiated slave latency (intervals)
+  uint16_t timeoutMs = 0;         // Negotiated supervision timeout
+  uint32_t notifySent = 0;        // Notifications completed OK
+  uint32_t notifyFailed = 0;      // Notifications completed with an error
+  uint32_t congestEvents = 0;     // Times the link became congested
+  uint32_t paramUpdates = 0;      // Connection parameter updates seen
+};
+
+void bleLinkGetStats(BleLinkStats& out);
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Chords: keys pressed together within a short window fire their own action.
+//
+// Sits between the key scan and the tap-hold engine and is fed once per
+// scan frame with the debounced press/release edges. Keys that belong to no
+// combo pass straight through on the same frame. A combo member is held back
+// from its first press until the chord completes (the keys are consumed and
+// the combo acts until one of them is released) or can no longer complete
+// (the held-back presses go out in order, late but unchanged). Time is
+// passed in, never read.
+
+static constexpr uint16_t COMBO_WINDOW_DEFAULT_MS = 50;
+static constexpr uint16_t COMBO_WINDOW_MIN_MS = 10;
+static constexpr uint16_t COMBO_WINDOW_MAX_MS = 200;
+
+class ComboEngine {
+  public:
+    static constexpr size_t MAX_COMBOS = 4;
+
+    // keyMask: bit per hall key; fewer than two keys disables the combo.
+    // windowMs: time from the first key of the chord to the last.
+    void configure(size_t combo, uint8_t keyMask, uint16_t windowMs);
+
+    void update(uint32_t nowMs, uint8_t pressedMask, uint8_t releasedMask);
+
+    // Key edges for the next stage (same meaning as the scan's edges).
+    uint8_t pressedMask() const {
+      return pressedOut;
+    }
+
+    uint8_t releasedMask() const {
+      return releasedOut;
+    }
+
+    // Combos acting now (bit per combo) / combos that fired this frame.
+    uint8_t activeMask() const {
+      return active;
+    }
+
+    uint8_t firedMask() const {
+      return fired;
+    }
+
+    // Combo keys currently held back.
+    uint8_t bufferedMask() const {
+      return buffered;
+    }
+
+  private:
+    uint8_t comboKeys[MAX_COMBOS] = {};
+    uint16_t windowMs[MAX_COMBOS] = {};
+    uint8_t memberMask = 0;       // Union of all combo keys
+    uint8_t buffered = 0;
+    uint32_t firstPressMs = 0;    // First key of the buffered chord
+    uint32_t lastPressMs = 0;     // Latest key added to it
+    uint8_t consumed = 0;         // Keys of fired combos, swallowed until released
+    uint8_t deferredRelease = 0;  // Releases held one frame behind their flushed press
+    uint8_t active = 0;
+    uint8_t fired = 0;
+    uint8_t pressedOut = 0;
+    uint8_t releasedOut = 0;
+
+    void flush();
+    void decide(uint32_t nowMs);
+};
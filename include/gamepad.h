@@ -0,0 +1,45 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Analog gamepad output.
+//
+// In gamepad mode the six hall keys are reported as proportional axes (their
+// linearized travel) plus one button each, and the knob as a seventh axis.
+// Only native USB carries it (the BLE keyboard library has no gamepad
+// descriptor), so over BLE the pad stays a keyboard.
+//
+// The scan task posts a report every frame; anything within the deadband of
+// the last posted report is dropped there. A small worker sends the newest
+// report as fast as the host polls (1 ms on USB full speed).
+
+static constexpr size_t GAMEPAD_KEY_AXES = 6;
+static constexpr size_t GAMEPAD_AXES = GAMEPAD_KEY_AXES + 1;  // + knob
+static constexpr uint16_t GAMEPAD_AXIS_MAX = 4095;
+// Axis counts (of 4096) an axis must move before a report goes out.
+static constexpr uint16_t GAMEPAD_DEADBAND = 8;
+
+struct GamepadReport {
+  uint16_t axes[GAMEPAD_AXES] = {};  // 0..GAMEPAD_AXIS_MAX
+  uint8_t buttons = 0;               // Bit per hall key
+};
+
+// True if `next` differs from `last` by more than `deadband` on any axis, in
+// any button, or reaches an axis end the last report hadn't.
+bool gamepadReportChanged(const GamepadReport& last, const GamepadReport& next, uint16_t deadband);
+
+// Starts the send worker. Call once from setup() after hidOutputStart().
+void gamepadOutputStart();
+
+// Hands the current state to the worker (newest wins). Returns false if it
+// was inside the deadband and not posted.
+bool gamepadOutputPost(const GamepadReport& report);
+
+struct GamepadStats {
+  uint32_t posted = 0;   // Reports handed to the worker
+  uint32_t sent = 0;     // Reports the host took
+  uint32_t failed = 0;   // Sends that failed (not mounted / timed out)
+  uint16_t rateHz = 0;   // Reports sent during the last full second
+};
+
+void gamepadGetStats(GamepadStats& out);
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "mxgicHall.h"
+
+// Versioned, CRC-protected hall calibration record stored as one NVS blob.
+// Holds min/max for every calibrated hall key (MxgicHall::isCalibrated()).
+static constexpr uint16_t HALL_CAL_VERSION = 1;
+static constexpr size_t HALL_CAL_MAX_KEYS = 6;
+
+// Loads the record in a single read and applies it to every key it has a
+// usable range for. Returns false (leaving the keys untouched) when the
+// record is missing, stale or corrupt, or calibrates no key.
+bool hallCalibrationLoadFromPrefs(const char* prefsNamespace, MxgicHall** hall, size_t hallCount);
+
+// Writes the calibrated keys, only if that differs from what was last
+// loaded/saved and at least one key is calibrated. Returns true if a write
+// happened.
+bool hallCalibrationSaveIfChanged(const char* prefsNamespace, MxgicHall** hall, size_t hallCount);
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <Arduino.h>
+#include <BleKeyboard.h>
+
+#include "actions.h"
+
+// HID output worker.
+//
+// The scan task never talks to BLE directly. It pushes events into a bounded
+// FreeRTOS queue and a separate worker task drains it, so a long TYPE: string
+// or a congested link can never stall key sampling.
+//
+// Backpressure: enqueueing never blocks. Report events carry the full held
+// state, so when the queue is full the caller simply retries with its latest
+// report on the next frame. Text events that don't fit are dropped and counted.
+//
+// Macros run inside the worker on a MacroEngine; the worker sleeps on the
+// queue only until the next macro step is due. Reports go to whichever
+// transport is live (native USB when plugged in, else BLE; hid_transport.h).
+
+static constexpr size_t HID_OUTPUT_QUEUE_DEPTH = 16;
+
+// Starts the HID transports and the worker. Call once after
+// bleKeyboard.begin().
+void hidOutputStart(BleKeyboard& keyboard);
+
+// Queues a full keyboard report (held keys). Returns false if the queue is full.
+bool hidOutputQueueReport(const KeyReport& report);
+
+// Queues text to type. `text` must stay valid until typed (e.g. a keybind
+// string that lives for the whole run). Returns false if dropped.
+bool hidOutputQueueText(const char* text, size_t length);
+
+// Starts a compiled macro (see actions.h). `program` must stay valid while it
+// runs. Returns false if dropped (queue full).
+bool hidOutputQueueMacro(const ActionProgram* program);
+
+struct HidOutputStats {
+  uint32_t queued = 0;        // Events accepted
+  uint32_t sent = 0;          // Events completed by the worker
+  uint32_t reportRetries = 0; // Report events that found the queue full
+  uint32_t textDropped = 0;   // Text events dropped (queue full)
+  uint32_t macrosDropped = 0; // Macros dropped (queue full or all slots busy)
+  uint8_t macrosRunning = 0;  // Macros in progress right now
+  uint8_t depth = 0;          // Events waiting right now
+  uint8_t highWater = 0;      // Largest depth seen
+  uint32_t typedChars = 0;    // Characters typed by TYPE: actions
+  uint32_t typeCps = 0;       // Characters per second of the last TYPE: action
+};
+
+void hidOutputGetStats(HidOutputStats& out);
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <Arduino.h>
+#include <BleKeyboard.h>
+
+// Combined HID keyboard reports.
+//
+// BleKeyboard::press() sends one report per key. These helpers build a single
+// KeyReport for everything that changed in a scan frame so it can go out with
+// one BleKeyboard::sendReport() call. Keys use the same codes as
+// BleKeyboard::press(): printable ASCII, KEY_LEFT_CTRL..KEY_RIGHT_GUI
+// (modifiers) and the KEY_* constants >= 136 (raw usage + 136).
+
+static constexpr size_t HID_REPORT_KEY_SLOTS = 6;
+
+// Key code for one combo token (already upper-cased), e.g. "CTRL", "F5", "Z".
+// Returns 0 when the token is not recognized.
+uint8_t hidKeyCodeForToken(const String& tokenUpper);
+
+// Splits a key code into modifier bits and a usage ID (0 for pure
+// modifiers). Returns false for characters with no usage.
+bool hidKeyToUsage(uint8_t key, uint8_t& modifierBits, uint8_t& usage);
+
+// US layout ASCII -> usage ID via a precomputed table. Returns false for
+// characters that can't be typed.
+bool hidUsageForAscii(char c, uint8_t& usage, bool& shift);
+
+void hidReportClear(KeyReport& report);
+bool hidReportIsEmpty(const KeyReport& report);
+bool hidReportEquals(const KeyReport& a, const KeyReport& b);
+
+// Adds a key to the report (modifier bit or a free slot; shifted ASCII also
+// sets left shift). Returns false if the key is unknown or all slots are used.
+bool hidReportAddKey(KeyReport& report, uint8_t key);
+
+// Adds a usage ID to a free slot (no-op if already present).
+bool hidReportAddUsage(KeyReport& report, uint8_t usage);
+
+// Clears every slot holding `usage`.
+void hidReportRemoveUsage(KeyReport& report, uint8_t usage);
+
+// True if `usage` is in one of the report's slots.
+bool hidReportHasUsage(const KeyReport& report, uint8_t usage);
+
+// Destination for keyboard reports (a HID transport). The firmware routes to
+// USB or BLE (hid_transport.h); anything else, e.g. a recording fake, can be
+// plugged in to check the report stream.
+class HidSink {
+  public:
+    virtual ~HidSink() {}
+    virtual void sendReport(const KeyReport& report) = 0;
+
+    // True when a host is attached and reports will be delivered.
+    virtual bool isConnected() {
+      return true;
+    }
+
+    // Blocks until the last report has left the device (or timeout).
+    virtual void waitSent(uint32_t timeoutMs) {
+      (void)timeoutMs;
+    }
+};
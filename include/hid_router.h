@@ -0,0 +1,39 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "hid_report.h"
+
+enum class HidTransportKind : uint8_t {
+  None = 0,
+  Usb = 1,
+  Ble = 2,
+};
+
+// Routes keyboard reports to USB while a host has it mounted, else to BLE.
+// Only sees the two transports as HidSinks, so fakes can stand in for them
+// and the report stream can be checked on the host.
+class HidRouter : public HidSink {
+  public:
+    HidRouter(HidSink& usbSink, HidSink& bleSink) : usb(usbSink), ble(bleSink) {}
+
+    void sendReport(const KeyReport& report) override;
+    bool isConnected() override;
+    void waitSent(uint32_t timeoutMs) override;
+
+    // Re-evaluates the route from the transports' isConnected(). Returns true
+    // when it changed; the old transport (if still connected) has been sent
+    // a release, and the caller should resend its held state.
+    bool update();
+
+    HidTransportKind active() const {
+      return route;
+    }
+
+  private:
+    HidSink& usb;
+    HidSink& ble;
+    HidTransportKind route = HidTransportKind::None;
+
+    HidSink* current();
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <Arduino.h>
+#include <BleKeyboard.h>
+
+#include "hid_report.h"
+#include "hid_router.h"
+
+// HID transport selection.
+//
+// Keyboard output goes to native USB (1 ms polling) whenever the pad is
+// plugged into a host, and to BLE otherwise. Callers only see a HidSink;
+// the routing itself is HidRouter (hid_router.h).
+
+// Sets up both backends. Call once from setup() after bleKeyboard.begin().
+void hidTransportBegin(BleKeyboard& keyboard);
+
+// Sink that routes each report to the active transport.
+HidSink& hidTransportSink();
+
+// Re-evaluates the route. Returns true when it changed (the old transport
+// has been sent a release; the caller should resend its held state).
+bool hidTransportUpdate();
+
+HidTransportKind hidTransportActive();
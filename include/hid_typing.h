@@ -0,0 +1,23 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "hid_report.h"
+
+// TYPE: text as batched keyboard reports.
+//
+// Consecutive characters that share a shift state and don't repeat a key go
+// out in one report; each report is paced on the sink's waitSent() instead
+// of a fixed sleep. No RTOS or transport dependency, so a recording HidSink
+// can check the report stream.
+
+// Safety net if a BLE notification completion event never arrives.
+static constexpr uint32_t HID_TYPE_NOTIFY_TIMEOUT_MS = 30;
+
+// Types `text`. `held` is the report the host has down right now. Held keys
+// the text never types stay down in every report, so the host sees no
+// release and re-press of them. Held modifiers and held keys the text types
+// are released first (otherwise they would change or swallow characters);
+// the caller re-sends them afterwards. Returns the number of characters
+// typed (0 if the sink is not connected).
+size_t hidTypeText(HidSink& sink, const char* text, size_t length, const KeyReport& held);
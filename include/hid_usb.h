@@ -0,0 +1,26 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "gamepad.h"
+
+// Native USB HID keyboard + gamepad (TinyUSB, ESP32-S3 USB-OTG).
+//
+// Kept in its own translation unit: the USB keyboard header defines its own
+// `KeyReport`, which clashes with BleKeyboard's. Only available when built
+// with ARDUINO_USB_MODE=0 (see platformio.ini); otherwise every call is a
+// no-op and hidUsbMounted() stays false.
+
+// Registers the keyboard and gamepad and starts the USB stack. Call once from
+// setup().
+void hidUsbBegin();
+
+// True while a host has configured the device (cable plugged into a computer).
+bool hidUsbMounted();
+
+// Sends one boot-keyboard report. Blocks until the previous report has been
+// picked up by the host (at most one 1 ms poll interval).
+bool hidUsbSendReport(uint8_t modifiers, const uint8_t keys[6]);
+
+// Sends one gamepad report (see gamepad.h). Same blocking as the keyboard.
+bool hidUsbSendGamepad(const GamepadReport& report);
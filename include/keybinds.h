@@ -2,17 +2,92 @@
 
 #include <Arduino.h>
 
-// Shared action prefix used across modules.
+// Shared action prefixes used across modules.
 static constexpr const char* ACTION_TYPE_PREFIX = "TYPE:";
+static constexpr const char* ACTION_MACRO_PREFIX = "MACRO:";  // e.g. MACRO:PRESS CTRL; TAP C; RELEASE CTRL
+static constexpr const char* ACTION_LAYER_PREFIX = "LAYER:";  // e.g. LAYER:2 (momentary, 1-based)
+static constexpr const char* ACTION_MENU = "MENU";             // opens the timer menu
 
-// Loads keybind strings from Preferences (NVS). If keys are missing, fills and stores defaults.
-void keybindsLoadFromPrefs(const char* prefsNamespace, String* actions, size_t actionCount);
+// Keymap layers. Layer 1 (index 0) uses the original btn0..btnN keys.
+static constexpr size_t KEYMAP_MAX_LAYERS = 4;
 
-// Saves keybind strings to Preferences (NVS).
-void keybindsSaveToPrefs(const char* prefsNamespace, const String* actions, size_t actionCount);
+struct ActionProgram;
 
-// Returns the form field / prefs key for a button index (e.g. "btn0").
-String keybindsKeyForButton(size_t idx);
+// Loads one layer's keybind strings from Preferences (NVS). If layer 0 keys are
+// missing, fills and stores defaults; other layers default to empty.
+// When `compiled` is given, each action is also compiled (see actions.h) and
+// invalid tokens are reported on Serial. The programs reference `actions`.
+void keybindsLoadFromPrefs(const char* prefsNamespace, String* actions, size_t actionCount, ActionProgram* compiled = nullptr, size_t layer = 0);
+
+// Saves one layer's keybind strings to Preferences (NVS).
+void keybindsSaveToPrefs(const char* prefsNamespace, const String* actions, size_t actionCount, size_t layer = 0);
+
+// Returns the form field / prefs key for a button index (e.g. "btn0", or
+// "l2btn0" on layer index 2).
+String keybindsKeyForButton(size_t idx, size_t layer = 0);
+
+// Hold action of a dual-role key, per layer (same storage rules as above,
+// never defaulted). A key with a non-empty hold action is tap-hold.
+void keybindsLoadHoldFromPrefs(const char* prefsNamespace, String* actions, size_t actionCount, ActionProgram* compiled = nullptr, size_t layer = 0);
+void keybindsSaveHoldToPrefs(const char* prefsNamespace, const String* actions, size_t actionCount, size_t layer = 0);
+
+// Form field / prefs key for a hold action (e.g. "hold0", "l2hold0").
+String keybindsKeyForHold(size_t idx, size_t layer = 0);
+
+// Tap-hold resolution per button (see tap_hold.h).
+// mode: 0 = timeout, 1 = permissive hold, 2 = hold on other key press (default 0).
+// term: ms before an undecided key counts as held, 50..1000 (default 200).
+void keybindsLoadTapHoldFromPrefs(const char* prefsNamespace, uint8_t* modes, uint16_t* termsMs, size_t count);
+void keybindsSaveTapHoldToPrefs(const char* prefsNamespace, const uint8_t* modes, const uint16_t* termsMs, size_t count);
+
+// Form fields / prefs keys for a button's tap-hold settings (e.g. "thm0", "tht0").
+String keybindsKeyForTapHoldMode(size_t idx);
+String keybindsKeyForTapHoldTerm(size_t idx);
+
+// Combos (chords): up to ComboEngine::MAX_COMBOS entries of
+// keys (bit per hall key), action string and window in ms (10..200, default 50).
+// A key mask with fewer than two keys means the entry is unused.
+void keybindsLoadCombosFromPrefs(const char* prefsNamespace, uint8_t* keyMasks, String* actions, uint16_t* windowsMs, size_t count, ActionProgram* compiled = nullptr);
+void keybindsSaveCombosToPrefs(const char* prefsNamespace, const uint8_t* keyMasks, const String* actions, const uint16_t* windowsMs, size_t count);
+
+// Form fields / prefs keys for combo i (e.g. "cbk0", "cba0", "cbw0").
+String keybindsKeyForComboKeys(size_t idx);
+String keybindsKeyForComboAction(size_t idx);
+String keybindsKeyForComboWindow(size_t idx);
+
+// "LT+RT" <-> key mask (LT RT LM RM LB RB = bits 0..5).
+bool keybindsParseComboKeys(const String& source, uint8_t& keyMask, String& error);
+String keybindsComboKeysToString(uint8_t keyMask);
+
+// SOCD pairs: up to SocdResolver::MAX_PAIRS entries of two opposing keys
+// (bit per hall key) and a policy (see socd.h; 0 = off, default).
+void keybindsLoadSocdFromPrefs(const char* prefsNamespace, uint8_t* keyMasks, uint8_t* policies, size_t count);
+void keybindsSaveSocdToPrefs(const char* prefsNamespace, const uint8_t* keyMasks, const uint8_t* policies, size_t count);
+
+// Form fields / prefs keys for SOCD pair i (e.g. "socdk0", "socdm0").
+String keybindsKeyForSocdKeys(size_t idx);
+String keybindsKeyForSocdPolicy(size_t idx);
+
+// Number of layers in use (1..KEYMAP_MAX_LAYERS, default 1) and whether the
+// knob position selects the layer (default on).
+void keybindsLoadLayersFromPrefs(const char* prefsNamespace, uint8_t& layerCount, bool& knobSelect);
+void keybindsSaveLayersToPrefs(const char* prefsNamespace, uint8_t layerCount, bool knobSelect);
+
+// Gamepad mode ("gamepad", default off): on USB the keys report as analog axes.
+bool keybindsLoadGamepadFromPrefs(const char* prefsNamespace);
+void keybindsSaveGamepadToPrefs(const char* prefsNamespace, bool enabled);
+
+// ADC data-rate governor ("adsGov", default on): slower, quieter ADS1115
+// rate while the pad is idle (see sensor_acq.h).
+bool keybindsLoadRateGovernorFromPrefs(const char* prefsNamespace);
+void keybindsSaveRateGovernorToPrefs(const char* prefsNamespace, bool enabled);
+
+// MIDI mode ("midi", default off): keys play notes over BLE-MIDI.
+// channel "midiCh" 1..16 (default 1), baseNote "midiNote" 0..121 for LT
+// (default 60, the other keys follow chromatically), knobCc "midiCC" 0..119
+// (default 1, mod wheel).
+void keybindsLoadMidiFromPrefs(const char* prefsNamespace, bool& enabled, uint8_t& channel, uint8_t& baseNote, uint8_t& knobCc);
+void keybindsSaveMidiToPrefs(const char* prefsNamespace, bool enabled, uint8_t channel, uint8_t baseNote, uint8_t knobCc);
 
 // Timer meter LED color style.
 // 0 = white, 1 = gradient
@@ -23,3 +98,46 @@ void keybindsSaveMeterStyleToPrefs(const char* prefsNamespace, uint8_t meterStyl
 // Range: 1..255 (0 is treated as off; we clamp to 1).
 uint8_t keybindsLoadLedBrightnessFromPrefs(const char* prefsNamespace);
 void keybindsSaveLedBrightnessToPrefs(const char* prefsNamespace, uint8_t brightness);
+
+// Hall noise filter applied in the acquisition task (see mxgicFilter.h).
+// mode: 0 = off, 1 = EMA, 2 = median of 3, 3 = adaptive. strength: EMA shift 1..4.
+// Defaults: adaptive, strength 2.
+void keybindsLoadHallFilterFromPrefs(const char* prefsNamespace, uint8_t& mode, uint8_t& strength);
+void keybindsSaveHallFilterToPrefs(const char* prefsNamespace, uint8_t mode, uint8_t strength);
+
+// Rapid-trigger sensitivity per button, in percent of calibrated travel.
+// 0 = off (fixed threshold), otherwise 1..50.
+void keybindsLoadRapidTriggerFromPrefs(const char* prefsNamespace, uint8_t* percents, size_t count);
+void keybindsSaveRapidTriggerToPrefs(const char* prefsNamespace, const uint8_t* percents, size_t count);
+
+// Returns the form field / prefs key for a button's rapid-trigger setting (e.g. "rt0").
+String keybindsKeyForRapidTrigger(size_t idx);
+
+// Actuation point per button in percent of calibrated travel ("ap0"):
+// 0 = fixed raw threshold (default), otherwise 5..95. Release point ("ar0")
+// 1..press-1; missing or out of range it is 10 below the press point.
+static constexpr uint8_t KEY_ACTUATION_MIN_PERCENT = 5;
+static constexpr uint8_t KEY_ACTUATION_MAX_PERCENT = 95;
+
+void keybindsLoadActuationFromPrefs(const char* prefsNamespace, uint8_t* pressPercents, uint8_t* releasePercents, size_t count);
+void keybindsSaveActuationToPrefs(const char* prefsNamespace, const uint8_t* pressPercents, const uint8_t* releasePercents, size_t count);
+
+// Form fields / prefs keys for a button's actuation / release point (e.g. "ap0", "ar0").
+String keybindsKeyForActuationPress(size_t idx);
+String keybindsKeyForActuationRelease(size_t idx);
+
+// Multi-point actuation: extra depths per button (layer 1 only), each with
+// its own action and depth in percent of travel, 10..100 (defaults 70 and 95).
+// Arrays hold KEY_DEPTH_POINTS * count entries, indexed [point * count + idx].
+// Point 0 is depth 2 (the key's normal actuation is depth 1). An empty action
+// leaves the point unused; a point after an unused one is ignored.
+static constexpr size_t KEY_DEPTH_POINTS = 2;
+static constexpr uint8_t KEY_DEPTH_PERCENT_MIN = 10;
+static constexpr uint8_t KEY_DEPTH_PERCENT_MAX = 100;
+
+void keybindsLoadDepthFromPrefs(const char* prefsNamespace, String* actions, uint8_t* percents, size_t count, ActionProgram* compiled = nullptr);
+void keybindsSaveDepthToPrefs(const char* prefsNamespace, const String* actions, const uint8_t* percents, size_t count);
+
+// Form fields / prefs keys for a depth point (e.g. "d2a0" / "d2p0" for depth 2 of button 0).
+String keybindsKeyForDepthAction(size_t idx, size_t point);
+String keybindsKeyForDepthPercent(size_t idx, size_t point);
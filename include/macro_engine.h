@@ -0,0 +1,72 @@
+#pragma once
+
+#include <Arduino.h>
+#include <BleKeyboard.h>
+
+#include "actions.h"
+#include "hid_report.h"
+
+// Safety net for a SYNC whose send completion never arrives.
+static constexpr uint32_t MACRO_SYNC_TIMEOUT_MS = 30;
+// Shortest pass of a REPEAT block (one FreeRTOS tick at 1 kHz). A block
+// without WAIT would otherwise come back due at once, and the worker would
+// spin on 0 ms sleeps and starve equal-priority tasks.
+static constexpr uint32_t MACRO_REPEAT_MIN_MS = 1;
+
+// Cooperative macro scheduler.
+//
+// Runs compiled macro programs (ACTION_OP_MACRO) step by step. WAIT never
+// blocks: run() executes every step that is due and returns how long the
+// caller may sleep before calling it again, so several macros run at once
+// from a single task. The engine also owns the final report: it merges the
+// held-combo report from the scan task with every running macro's keys and
+// only sends when the result changes. Each SYNC step waits for the sink to
+// finish sending (HidSink::waitSent()), so consecutive steps never merge into
+// one BLE notification. Time is passed in, never read.
+class MacroEngine {
+  public:
+    static constexpr size_t MAX_RUNNING = 4;
+    static constexpr uint32_t IDLE = 0xFFFFFFFFUL;
+
+    // Starts a macro. Returns false if all slots are busy or it isn't a macro.
+    bool start(const ActionProgram* program, uint32_t nowMs);
+
+    // Held combos from the scan task (replaces the previous base report).
+    void setBaseReport(const KeyReport& report);
+
+    // Forces the next run() to resend (e.g. after something else sent reports).
+    void invalidate();
+
+    // Runs all due steps and sends the merged report if it changed. Returns ms
+    // until the next step is due, or IDLE when no macro is running.
+    uint32_t run(uint32_t nowMs, HidSink& sink);
+
+    size_t runningCount() const;
+
+    // Base report merged with all running macros.
+    const KeyReport& currentReport() const {
+      return lastSent;
+    }
+
+  private:
+    struct Slot {
+      const ActionProgram* program = nullptr;
+      uint8_t pc = 0;
+      uint32_t wakeMs = 0;
+      uint8_t repeatPc = 0;     // First step of the active REPEAT block
+      uint8_t repeatLeft = 0;   // Passes still to run after the current one
+      uint32_t passMs = 0;      // Scheduled start of the current REPEAT pass
+      uint8_t modifiers = 0;
+      uint8_t usages[HID_REPORT_KEY_SLOTS] = {};
+    };
+
+    Slot slots[MAX_RUNNING];
+    KeyReport base = {};
+    KeyReport lastSent = {};
+    bool dirty = true;
+
+    void step(Slot& slot, uint32_t nowMs, HidSink& sink);
+    bool emit(HidSink& sink);
+    static void pressUsage(Slot& slot, uint8_t usage);
+    static void releaseUsage(Slot& slot, uint8_t usage);
+};
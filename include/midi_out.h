@@ -0,0 +1,31 @@
+#pragma once
+
+#include <Arduino.h>
+
+// BLE-MIDI output.
+//
+// Adds the standard BLE-MIDI service to the BLE stack the keyboard already
+// runs, so a host sees one device with both. Calls only enqueue; a worker
+// packs waiting messages into BLE-MIDI packets (13-bit ms timestamps taken
+// from each message's acquisition time) and notifies them.
+
+static constexpr size_t MIDI_OUT_QUEUE_DEPTH = 32;
+
+// Adds the MIDI service to BleKeyboard's server and starts the worker. Call
+// once from setup() after bleKeyboard.begin(). `channel` is 1..16.
+void midiOutBegin(uint8_t channel);
+
+// Each returns false if the queue was full (message dropped).
+bool midiOutNoteOn(uint8_t note, uint8_t velocity, uint32_t timestampUs);
+bool midiOutNoteOff(uint8_t note, uint32_t timestampUs);
+bool midiOutControlChange(uint8_t controller, uint8_t value, uint32_t timestampUs);
+
+struct MidiOutStats {
+  bool subscribed = false;  // A host has enabled notifications
+  uint32_t sent = 0;        // Messages notified
+  uint32_t packets = 0;     // BLE packets notified
+  uint32_t dropped = 0;     // Messages dropped (queue full or nobody listening)
+  uint8_t lastVelocity = 0; // Velocity of the last note on
+};
+
+void midiOutGetStats(MidiOutStats& out);
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Note velocity from key travel timing.
+//
+// Fed with every acquisition frame's linearized travel (0..4096) and that
+// frame's micros() timestamp. Velocity comes from the time the key takes from
+// the start-of-travel threshold to the full-press threshold. Each crossing
+// time is interpolated between the two frames around it, so the result is
+// finer than the frame interval and independent of how often the scan task
+// runs.
+
+static constexpr uint16_t MIDI_TRAVEL_FULL = 4096;
+static constexpr uint16_t MIDI_START_TRAVEL = MIDI_TRAVEL_FULL / 10;       // 10 %: key is moving
+static constexpr uint16_t MIDI_STRIKE_TRAVEL = MIDI_TRAVEL_FULL * 9 / 10;  // 90 %: note on
+static constexpr uint16_t MIDI_RELEASE_TRAVEL = MIDI_TRAVEL_FULL * 4 / 10; // 40 %: note off
+// Start-to-strike times mapped to velocity 127 and 1 (log scale in between).
+static constexpr uint32_t MIDI_FASTEST_US = 2000;
+static constexpr uint32_t MIDI_SLOWEST_US = 100000;
+
+class MidiVelocityTracker {
+  public:
+    enum Event : uint8_t {
+      None = 0,
+      NoteOn,
+      NoteOff,
+    };
+
+    // Returns the event this sample produced. For NoteOn, `velocity` (1..127)
+    // and `strikeUs` (interpolated time the strike threshold was crossed)
+    // are set.
+    Event update(uint16_t travel, uint32_t timestampUs, uint8_t& velocity, uint32_t& strikeUs);
+
+    bool noteOn() const {
+      return sounding;
+    }
+
+    // Maps a start-to-strike time to a velocity.
+    static uint8_t velocityForUs(uint32_t us);
+
+  private:
+    uint16_t lastTravel = 0;
+    uint32_t lastUs = 0;
+    bool haveLast = false;
+    bool moving = false;      // Crossed the start threshold going down
+    uint32_t startUs = 0;     // When it did
+    bool sounding = false;
+};
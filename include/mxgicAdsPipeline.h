@@ -0,0 +1,133 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <Adafruit_ADS1X15.h>
+
+// How a full hall frame is read across both chips.
+// - Serialized: every channel of the first chip, then every channel of the
+//   second; one chip idles while the other converts.
+// - Interleaved: both chips convert the same channel index at the same time,
+//   so a 3+3 channel frame costs three conversion periods instead of six.
+enum class AdsScanMode : uint8_t {
+  Serialized = 0,
+  Interleaved = 1,
+};
+
+class MxgicAdsPipeline;
+
+// Reads one fresh sample of every enabled channel on both chips: every value
+// comes from a conversion started after the call. Each chip goes idle after
+// its last channel, so the next frame starts both from scratch.
+void adsPipelineReadFrame(MxgicAdsPipeline& a, MxgicAdsPipeline& b, AdsScanMode mode);
+
+// Frame statistics for adsPipelineReadFrame() (smoothed frame time).
+uint32_t adsPipelineFrameTimeUs();
+uint32_t adsPipelineFrameCount();
+
+// Pipelined ADS1115 sampler.
+//
+// `readADC_SingleEnded()` starts a conversion and then blocks for the whole
+// conversion time before reading the result back. This engine keeps the chip
+// converting back-to-back instead:
+// - When the chip signals conversion-ready, the *next* channel's conversion is
+//   started first and only then is the finished result read back. The
+//   conversion register keeps the previous result until the new conversion
+//   completes, so the I2C read-back overlaps the next conversion.
+// - Ready is detected from the ALERT/RDY pin (interrupt) when it is wired,
+//   otherwise from the config register OS bit, which is only polled once the
+//   nominal conversion time has elapsed.
+// - A reader asks for a channel together with a start count (`starts` when
+//   its frame or call began); a conversion started before that never
+//   satisfies it, even if it is the requested channel.
+//
+// One instance per chip. Not re-entrant across tasks without the internal lock.
+class MxgicAdsPipeline {
+  public:
+    static constexpr uint8_t CHANNEL_COUNT = 4;
+
+    // Takes gain/data rate from an already-initialized Adafruit driver.
+    // alertPin < 0 means ALERT/RDY is not wired.
+    bool begin(Adafruit_ADS1115& ads, uint8_t i2cAddr, int8_t alertPin = -1);
+
+    // Data rate (RATE_ADS1115_*) for conversions started from now on; the
+    // one in flight finishes at the old rate. Gain is left alone.
+    void setDataRate(uint16_t rate);
+
+    uint16_t dataRate() const {
+      return (uint16_t)(configBase & RATE_MASK);
+    }
+
+    // Adds a channel to the round-robin. Safe to call before begin().
+    void enableChannel(uint8_t ch);
+
+    // Non-blocking. If the in-flight conversion is done, starts the next one
+    // and stores the finished result. Returns true when a sample was stored.
+    bool poll();
+
+    // Blocks (yielding the CPU) until a sample of `ch` whose conversion
+    // started after the call is available and returns it.
+    uint16_t read(uint8_t ch);
+
+    uint16_t latest(uint8_t ch) const {
+      return (ch < CHANNEL_COUNT) ? values[ch] : 0;
+    }
+
+    uint32_t sampleCount(uint8_t ch) const {
+      return (ch < CHANNEL_COUNT) ? seq[ch] : 0;
+    }
+
+    bool usesAlertPin() const {
+      return alertPin >= 0;
+    }
+
+    uint8_t enabledChannels() const {
+      return channelMask;
+    }
+
+  private:
+    static constexpr uint16_t RATE_MASK = 0x00E0;  // Config register DR bits
+
+    uint8_t addr = 0;
+    int8_t alertPin = -1;
+    uint16_t configBase = 0;       // gain | rate | single-shot | RDY comparator setup
+    uint32_t convTimeUs = 1200;    // nominal conversion time for the data rate
+    uint8_t channelMask = 0;
+    int8_t inFlightCh = -1;        // -1 = idle
+    uint32_t starts = 0;           // conversions started so far
+    uint32_t inFlightStart = 0;    // `starts` value of the one in flight
+    volatile int8_t demandCh = -1; // channel a blocked reader is waiting on
+    uint32_t demandAfter = 0;      // ... started after this count
+    int8_t stopAfterCh = -1;       // go idle after this channel (frame end)
+    uint32_t convStartUs = 0;
+    bool started = false;
+
+    volatile bool readyFlag = false;
+    volatile TaskHandle_t waiter = nullptr;
+    SemaphoreHandle_t lock = nullptr;
+
+    volatile uint16_t values[CHANNEL_COUNT] = {0, 0, 0, 0};
+    volatile uint32_t seq[CHANNEL_COUNT] = {0, 0, 0, 0};
+    volatile uint32_t sampleStart[CHANNEL_COUNT] = {0, 0, 0, 0};  // `starts` of each stored value
+
+    bool conversionReady();
+    void startConversion(uint8_t ch);
+    int8_t nextChannel(uint8_t doneCh, uint32_t doneStart) const;
+    void request(uint8_t ch, uint32_t after);
+    uint16_t readAfter(uint8_t ch, uint32_t after);
+    bool fresh(uint8_t ch, uint32_t after) const {
+      return sampleStart[ch] > after;
+    }
+    uint8_t lastChannel() const;
+    void waitForReady();
+    bool writeRegister(uint8_t reg, uint16_t value);
+    bool readRegister(uint8_t reg, uint16_t& value);
+
+    static void onAlert(void* arg);
+
+    friend void adsPipelineReadFrame(MxgicAdsPipeline& a, MxgicAdsPipeline& b, AdsScanMode mode);
+};
+
+// Defined in src/kronos_globals.cpp
+extern MxgicAdsPipeline adsPipe1;  // Pipeline for ads1 (0x48)
+extern MxgicAdsPipeline adsPipe2;  // Pipeline for ads2 (0x49)
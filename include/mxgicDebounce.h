@@ -36,4 +36,9 @@ class MxgicDebounce
     debouncedState = output;
     return debouncedState;
   }
+
+  // Current debounced state (true while the key is considered pressed).
+  bool isPressed() const {
+    return debouncedState;
+  }
 };
\ No newline at end of file
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Per-channel noise filter for raw hall readings.
+//
+// Integer math only, fixed cost per sample (no loops, no division):
+// - Ema:      one subtract, one shift, one add on a Q4 accumulator.
+// - Median3:  three compares over the last three samples.
+// - Adaptive: Median3 first (kills single-sample spikes), then an EMA whose
+//   shift drops to 0 (output follows the median) while the input is far from
+//   the output, so a moving key lags by at most one sample and a resting key
+//   is still smoothed hard.
+enum class HallFilterMode : uint8_t {
+  Off = 0,
+  Ema = 1,
+  Median3 = 2,
+  Adaptive = 3,
+};
+
+static constexpr uint8_t HALL_FILTER_MODE_COUNT = 4;
+static constexpr uint8_t HALL_FILTER_STRENGTH_MIN = 1;  // EMA alpha = 1/2
+static constexpr uint8_t HALL_FILTER_STRENGTH_MAX = 4;  // EMA alpha = 1/16
+
+class MxgicFilter {
+  private:
+    static constexpr uint8_t FRAC_BITS = 4;
+
+    HallFilterMode mode = HallFilterMode::Off;
+    uint8_t shift = 2;
+    uint16_t snapThreshold = 64;  // Raw counts; beyond this Adaptive tracks fast
+    bool primed = false;
+    int32_t acc = 0;              // Q4 EMA state
+    uint16_t hist[3] = {0, 0, 0};
+    uint8_t histPos = 0;
+
+    static uint16_t median3(uint16_t a, uint16_t b, uint16_t c) {
+      if (a > b) { const uint16_t t = a; a = b; b = t; }
+      if (b > c) { b = c; }
+      return (a > b) ? a : b;
+    }
+
+    uint16_t pushMedian(uint16_t x) {
+      hist[histPos] = x;
+      histPos = (histPos == 2) ? 0 : (uint8_t)(histPos + 1);
+      return median3(hist[0], hist[1], hist[2]);
+    }
+
+    uint16_t ema(uint16_t x, uint8_t k) {
+      acc += (((int32_t)x << FRAC_BITS) - acc) >> k;
+      return (uint16_t)((acc + (1 << (FRAC_BITS - 1))) >> FRAC_BITS);
+    }
+
+  public:
+    // strength = EMA shift (1..4). snap = Adaptive fast-track threshold in raw counts.
+    void configure(HallFilterMode filterMode, uint8_t strength, uint16_t snap = 64) {
+      mode = filterMode;
+      if (strength < HALL_FILTER_STRENGTH_MIN) strength = HALL_FILTER_STRENGTH_MIN;
+      if (strength > HALL_FILTER_STRENGTH_MAX) strength = HALL_FILTER_STRENGTH_MAX;
+      shift = strength;
+      snapThreshold = snap;
+      primed = false;
+    }
+
+    HallFilterMode getMode() const {
+      return mode;
+    }
+
+    uint16_t update(uint16_t x) {
+      if (!primed) {
+        // Start from the first sample so the output doesn't ramp up from 0.
+        acc = (int32_t)x << FRAC_BITS;
+        hist[0] = hist[1] = hist[2] = x;
+        histPos = 0;
+        primed = true;
+        return x;
+      }
+
+      switch (mode) {
+        case HallFilterMode::Ema:
+          return ema(x, shift);
+
+        case HallFilterMode::Median3:
+          return pushMedian(x);
+
+        case HallFilterMode::Adaptive: {
+          const uint16_t m = pushMedian(x);
+          const int32_t diff = ((int32_t)m << FRAC_BITS) - acc;
+          const int32_t dist = (diff < 0) ? -diff : diff;
+          return ema(m, (dist > ((int32_t)snapThreshold << FRAC_BITS)) ? 0 : shift);
+        }
+
+        case HallFilterMode::Off:
+        default:
+          return x;
+      }
+    }
+};
@@ -3,6 +3,9 @@
 #include <Arduino.h>
 #include <Adafruit_ADS1X15.h>
 
+#include "sensor_acq.h"
+#include "mxgicHallLut.h"
+
 // ADS1115 
 extern Adafruit_ADS1115 ads1;  // First ADS1115
 extern Adafruit_ADS1115 ads2;  // Second ADS1115
@@ -13,13 +16,34 @@ extern Adafruit_ADS1115 ads2;  // Second ADS1115
     const bool USE_AS5600 = 0;
   #endif
 
+// Extra actuation depths per key (multi-point actuation).
+static constexpr size_t HALL_DEPTH_POINTS = 2;
+
 class MxgicHall {
   private:
     unsigned int minVal=64000; // Store the min value
     unsigned int maxVal=0; // Store the max value
+    bool latched = false; // currentVal is pinned to a frame by latch() until unlatch()
+    MxgicHallLut lut; // Raw -> linear travel, built when a calibration is set
+    int rtSensitivity = 0; // Rapid trigger distance in travel units (0 = off)
+    bool rtPressed = false; // Rapid trigger actuation state
+    int rtExtreme = 0; // Deepest point while pressed / shallowest while released
+    uint8_t depthPercent[HALL_DEPTH_POINTS] = {}; // Extra actuation depths in % of travel (0 = unused)
+    unsigned int depthPressRaw[HALL_DEPTH_POINTS] = {}; // Raw counts at/above which a depth is reached
+    unsigned int depthReleaseRaw[HALL_DEPTH_POINTS] = {}; // Raw counts below which it is left again
+    uint8_t depthLevel = 0; // Deepest extra depth currently reached (0 = none)
+    uint8_t trigPressPercent = 0; // Actuation point in % of travel (0 = fixed raw threshold)
+    uint8_t trigReleasePercent = 0; // Release point in % of travel, below trigPressPercent
+    unsigned int trigPressRaw = 0; // Raw counts at/above which the key actuates
+    unsigned int trigReleaseRaw = 0; // Raw counts below which it releases again
+    bool trigRawValid = false; // trigPressRaw/trigReleaseRaw are in use
+    bool trigPressed = false; // Actuation state for the raw thresholds
     //int calibrationtime; // Variable to store the calibration time
     
   public:
+    static constexpr int TRAVEL_MAX = 1024; // Full calibrated travel in travel units
+    static constexpr unsigned int FIXED_TRIG_RAW = 11000; // checkTrig(0) threshold without actuation points
+    static constexpr unsigned int MIN_CAL_SPAN = 400; // Smallest min..max range that is a real press, not noise
     unsigned int precisionTable[6] = {128, 256, 512, 1024, 2048, 4096};
     unsigned int currentVal; // Store the current value
     int precision = 1; // Set Hall Pecision 1 = 128 2 = 256 
@@ -31,78 +55,213 @@ class MxgicHall {
     void setChannel (int adcSelect , int adcChannel) {
       adcSel = adcSelect;
       adcCh = adcChannel;
-    }
-
-    unsigned int rawRead() {
+      // Register the channel with the sampler that the acquisition task runs.
       switch (adcSel) {
         case 1:
-          switch(adcCh) {
-            case 0:
-              currentVal = ads1.readADC_SingleEnded(0);
-              break;
-            case 1:
-              currentVal = ads1.readADC_SingleEnded(1);
-              break;
-            case 2:
-              currentVal = ads1.readADC_SingleEnded(2);
-              break;
-            case 3:
-              currentVal = ads1.readADC_SingleEnded(3);
-              break;
-          }
+          adsPipe1.enableChannel(adcCh);
           break;
         case 2:
-          switch (adcCh) {
-            case 0:
-              currentVal = ads2.readADC_SingleEnded(0);
-              break;
-            case 1:
-              currentVal = ads2.readADC_SingleEnded(1);
-              break;
-            case 2:
-              currentVal = ads2.readADC_SingleEnded(2);
-              break;
-            case 3:
-              currentVal = ads2.readADC_SingleEnded(3);
-              break;
-          }
+          adsPipe2.enableChannel(adcCh);
           break;
       }
+    }
+
+    // Pins this key to a specific acquisition frame: every rawRead() returns
+    // this value until unlatch(), so all keys in one scan, and everything
+    // that reads a key during it (trigger, depth, travel), see the same frame.
+    void latch(const SensorSnapshot& snap) {
+      if (adcSel >= 1 && adcSel <= (int)SENSOR_ADC_COUNT && adcCh >= 0 && adcCh < (int)SENSOR_ADC_CHANNELS) {
+        currentVal = snap.hallRaw[adcSel - 1][adcCh];
+        latched = true;
+      }
+    }
+
+    // Back to the newest snapshot on every rawRead().
+    void unlatch() {
+      latched = false;
+    }
+
+    unsigned int rawRead() {
+      // Never touches the bus: the acquisition task owns the ADS1115s.
+      if (latched) {
+        return currentVal;
+      }
+      if (adcSel >= 1 && adcSel <= (int)SENSOR_ADC_COUNT) {
+        currentVal = sensorAcqHallRaw(adcSel, adcCh);
+      }
       return currentVal;
     }
     
+    // Until the key is calibrated, every sample widens its min/max. That is
+    // two compares; nothing is rebuilt here.
     int cali() {
         currentVal = rawRead();
-        if (currentVal < minVal) {
-          minVal = currentVal;
-        }
-        if (currentVal > maxVal) {
-          maxVal = currentVal;
+        if (!calibrated) {
+          if (currentVal < minVal) {
+            minVal = currentVal;
+          }
+          if (currentVal > maxVal) {
+            maxVal = currentVal;
+          }
         }
         return currentVal;
         Serial.println(currentVal);
     }
+
+    // A calibrated range wide enough to hold actuation points. Uncalibrated
+    // keys fall back to the fixed FIXED_TRIG_RAW threshold.
+    bool isCalibrated() const {
+      return calibrated && (maxVal > minVal) && (maxVal - minVal >= MIN_CAL_SPAN);
+    }
+
+    // Calibration pass (initializeKronos): forget the range, widen it with
+    // checkTrig(0)/cali() while the key is pressed, then finish. A range
+    // that is too small leaves the key uncalibrated.
+    void beginCalibration() {
+      minVal = 64000;
+      maxVal = 0;
+      calibrated = 0;
+      applyCalibration();
+    }
+
+    void finishCalibration() {
+      calibrated = (maxVal > minVal) && (maxVal - minVal >= MIN_CAL_SPAN);
+      applyCalibration();
+    }
     
+    // Linearized travel in HALL_TRAVEL_FULL units (0..4096). Uncalibrated
+    // keys get a straight line over the range seen so far.
+    uint16_t linearTravel() {
+      const unsigned int raw = rawRead();
+      if (isCalibrated()) {
+        return lut.lookup(raw);
+      }
+      if (maxVal <= minVal || raw <= minVal) {
+        return 0;
+      }
+      if (raw >= maxVal) {
+        return HALL_TRAVEL_FULL;
+      }
+      return (uint16_t)(((uint32_t)(raw - minVal) * HALL_TRAVEL_FULL) / (maxVal - minVal));
+    }
+
     int caliRead() {
-      int mapMax;
-      mapMax = precisionTable[precision];
-      currentVal = rawRead(); // -10 to get min closer to 0 when mapped
-      currentVal = constrain(currentVal, minVal, maxVal);
-      currentVal = map (currentVal, minVal, maxVal, 0, mapMax);
-      return currentVal;
+      // precisionTable[p] == HALL_TRAVEL_FULL >> (5 - p), so this is a shift.
+      const int p = constrain(precision, 0, 5);
+      return linearTravel() >> (5 - p);
     }
     
+    // Calibrated key travel, 0 (rest) .. TRAVEL_MAX (bottomed out).
+    int travelRead() {
+      return linearTravel() >> 2;
+    }
+
+    // Rapid trigger: sensitivity in percent of travel (0 disables, max 50).
+    void setRapidTrigger(uint8_t percent) {
+      if (percent > 50) percent = 50;
+      rtSensitivity = ((int)percent * TRAVEL_MAX) / 100;
+      rtPressed = false;
+      rtExtreme = 0;
+    }
+
+    // Needs a real calibration: on a noise-only range any jitter is a
+    // large fraction of "travel".
+    bool rapidTriggerEnabled() {
+      return (rtSensitivity > 0) && isCalibrated();
+    }
+
+    // Releases as soon as the key rises by rtSensitivity from its deepest
+    // point and re-actuates as soon as it falls by rtSensitivity from its
+    // shallowest point, wherever it is in its travel. Within rtSensitivity
+    // of the top the key is always released.
+    bool checkRapidTrigger() {
+      const int travel = travelRead();
+      if (travel <= rtSensitivity) {
+        rtPressed = false;
+        rtExtreme = travel;
+        return false;
+      }
+      if (rtPressed) {
+        if (travel > rtExtreme) {
+          rtExtreme = travel;
+        } else if (travel <= rtExtreme - rtSensitivity) {
+          rtPressed = false;
+          rtExtreme = travel;
+        }
+      } else {
+        if (travel < rtExtreme) {
+          rtExtreme = travel;
+        } else if (travel >= rtExtreme + rtSensitivity) {
+          rtPressed = true;
+          rtExtreme = travel;
+        }
+      }
+      return rtPressed;
+    }
+
+    // Actuation and release points in percent of travel for checkTrig(0).
+    // pressPercent 0 keeps the fixed FIXED_TRIG_RAW threshold; otherwise
+    // releasePercent must be below it (missing or too high, it becomes
+    // ACTUATION_HYSTERESIS_PERCENT below, at least 1).
+    static constexpr uint8_t ACTUATION_HYSTERESIS_PERCENT = 10;
+
+    void setActuation(uint8_t pressPercent, uint8_t releasePercent) {
+      if (pressPercent > 100) pressPercent = 100;
+      if (pressPercent == 1) pressPercent = 2; // Leaves room for a release point above 0
+      if (pressPercent > 0 && (releasePercent == 0 || releasePercent >= pressPercent)) {
+        releasePercent = (pressPercent > ACTUATION_HYSTERESIS_PERCENT)
+                           ? (uint8_t)(pressPercent - ACTUATION_HYSTERESIS_PERCENT) : 1;
+      }
+      trigPressPercent = pressPercent;
+      trigReleasePercent = releasePercent;
+      trigPressed = false;
+      buildThresholds();
+    }
+
+    // Multi-point actuation: up to DEPTH_POINTS extra depths below the normal
+    // actuation point, each with its own press/release threshold.
+    static constexpr size_t DEPTH_POINTS = HALL_DEPTH_POINTS;
+    static constexpr uint8_t DEPTH_HYSTERESIS_PERCENT = 4;
+
+    // percents[i]: depth i + 2 in % of travel (1..100, ascending; 0 = unused
+    // and ends the list).
+    void setDepthPoints(const uint8_t percents[DEPTH_POINTS]) {
+      for (size_t i = 0; i < DEPTH_POINTS; i++) {
+        depthPercent[i] = (percents[i] > 100) ? 100 : percents[i];
+      }
+      depthLevel = 0;
+      buildThresholds();
+    }
+
+    // Deepest extra depth reached this frame (0 = none, 1 = depth 2, ...).
+    // Uses the sample checkTrig() read, so call it after checkTrig() in the
+    // same frame. The thresholds are raw ADS counts worked out from the
+    // calibration ahead of time, so this is only a few integer compares.
+    uint8_t checkDepth() {
+      const unsigned int raw = currentVal;
+      while (depthLevel < DEPTH_POINTS && raw >= depthPressRaw[depthLevel]) {
+        depthLevel++;
+      }
+      while (depthLevel > 0 && raw < depthReleaseRaw[depthLevel - 1]) {
+        depthLevel--;
+      }
+      return depthLevel;
+    }
+
     void setPrecision(int precision = 4) {
       trigPoint = (precisionTable[precision]) / 2;
     }
     bool checkTrig(int option) {
       switch (option) {
         case 0:
-          return cali() > 11000;
+          return checkActuation(cali());
           break;
         case 1:
           return caliRead() > trigPoint;
           break;
+        case 2:
+          return checkRapidTrigger();
+          break;
         default:
           return false;
           break;
@@ -116,4 +275,79 @@ class MxgicHall {
     unsigned int getMax() {
       return maxVal;
     }
+
+    // Restores a stored calibration (see hall_calibration.h).
+    void setCalibration(unsigned int minValue, unsigned int maxValue) {
+      minVal = minValue;
+      maxVal = maxValue;
+      finishCalibration();
+    }
+
+  private:
+    static constexpr unsigned int DEPTH_NEVER = ~0U; // Threshold of an unused depth
+
+    // Smallest raw count whose linearized travel reaches `travel`.
+    unsigned int rawForTravel(uint16_t travel) {
+      unsigned int lo = minVal;
+      unsigned int hi = maxVal;
+      while (lo < hi) {
+        const unsigned int mid = lo + (hi - lo) / 2;
+        if (lut.lookup(mid) >= travel) {
+          hi = mid;
+        } else {
+          lo = mid + 1;
+        }
+      }
+      return lo;
+    }
+
+    // Two integer compares per sample. The thresholds are built only when
+    // the calibration or the points are set, never from the scan.
+    bool checkActuation(unsigned int raw) {
+      if (!trigRawValid) {
+        return raw > FIXED_TRIG_RAW;
+      }
+      if (trigPressed) {
+        trigPressed = (raw >= trigReleaseRaw);
+      } else {
+        trigPressed = (raw >= trigPressRaw);
+      }
+      return trigPressed;
+    }
+
+    void applyCalibration() {
+      if (isCalibrated()) {
+        lut.build(minVal, maxVal);
+      }
+      buildThresholds();
+    }
+
+    // Converts the actuation and depth percentages into raw ADS counts.
+    void buildThresholds() {
+      trigRawValid = isCalibrated() && (trigPressPercent > 0);
+      if (trigRawValid) {
+        trigPressRaw = rawForTravel((uint16_t)((uint32_t)trigPressPercent * HALL_TRAVEL_FULL / 100));
+        trigReleaseRaw = rawForTravel((uint16_t)((uint32_t)trigReleasePercent * HALL_TRAVEL_FULL / 100));
+      } else {
+        trigPressed = false;
+      }
+      bool active = isCalibrated();
+      for (size_t i = 0; i < DEPTH_POINTS; i++) {
+        // Unused points, and every point of an uncalibrated key, are never
+        // reached, nor any after them.
+        active = active && (depthPercent[i] > 0);
+        if (!active) {
+          depthPressRaw[i] = DEPTH_NEVER;
+          depthReleaseRaw[i] = DEPTH_NEVER;
+          continue;
+        }
+        const uint8_t releasePercent = (depthPercent[i] > DEPTH_HYSTERESIS_PERCENT)
+                                         ? (uint8_t)(depthPercent[i] - DEPTH_HYSTERESIS_PERCENT) : 0;
+        depthPressRaw[i] = rawForTravel((uint16_t)((uint32_t)depthPercent[i] * HALL_TRAVEL_FULL / 100));
+        depthReleaseRaw[i] = rawForTravel((uint16_t)((uint32_t)releasePercent * HALL_TRAVEL_FULL / 100));
+      }
+      if (depthLevel > 0 && depthPressRaw[depthLevel - 1] == DEPTH_NEVER) {
+        depthLevel = 0;
+      }
+    }
 };
\ No newline at end of file
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Hall travel linearization.
+//
+// A hall sensor's output grows much faster than key travel as the magnet gets
+// close, so a straight min/max map() gives "travel" that is compressed at the
+// top and stretched at the bottom. The default curve below inverts a dipole
+// model (field ~ 1 / gap^3) and is generated at compile time. Each key then
+// builds its own raw-count table from its calibration; the per-sample lookup
+// is a shift, a mask and one multiply with no division. The point of the
+// table is accuracy: it has not been measured to be faster than map() on
+// the ESP32-S3 (on a host CPU it is slower).
+
+static constexpr uint16_t HALL_TRAVEL_FULL = 4096;   // Travel units at full press
+static constexpr int HALL_CURVE_BITS = 7;
+static constexpr int HALL_CURVE_SEGMENTS = 1 << HALL_CURVE_BITS;
+static constexpr int HALL_LUT_SEGMENTS = 128;        // Per-key raw table resolution
+
+namespace hall_lut_detail {
+
+// Magnet gap (mm) at rest and at full press; only the ratio matters.
+constexpr double kGapRest = 4.0;
+constexpr double kGapPressed = 2.0;
+
+constexpr double fieldAt(double gap) {
+  return 1.0 / (gap * gap * gap);
+}
+
+// Newton iterations for the cube root (C++11 constexpr: recursion only).
+constexpr double cbrtStep(double v, double g) {
+  return g - (g * g * g - v) / (3.0 * g * g);
+}
+
+constexpr double cbrtIter(double v, double g, int n) {
+  return (n == 0) ? g : cbrtIter(v, cbrtStep(v, g), n - 1);
+}
+
+constexpr double gapForField(double b) {
+  return 1.0 / cbrtIter(b, 0.3, 40);
+}
+
+// Normalized sensor signal 0..1 -> normalized travel 0..1.
+constexpr double travelForSignal(double s) {
+  return (kGapRest - gapForField(fieldAt(kGapRest) + s * (fieldAt(kGapPressed) - fieldAt(kGapRest)))) /
+         (kGapRest - kGapPressed);
+}
+
+constexpr uint16_t curvePoint(int i) {
+  return (i <= 0) ? 0
+       : (i >= HALL_CURVE_SEGMENTS) ? HALL_TRAVEL_FULL
+       : (uint16_t)(travelForSignal((double)i / HALL_CURVE_SEGMENTS) * HALL_TRAVEL_FULL + 0.5);
+}
+
+template <int... I> struct IndexList {};
+template <int N, int... I> struct MakeIndexList : MakeIndexList<N - 1, N - 1, I...> {};
+template <int... I> struct MakeIndexList<0, I...> { typedef IndexList<I...> type; };
+
+struct Curve {
+  uint16_t v[HALL_CURVE_SEGMENTS + 1];
+};
+
+template <int... I>
+constexpr Curve makeCurve(IndexList<I...>) {
+  return Curve{{curvePoint(I)...}};
+}
+
+constexpr bool isMonotonic(const Curve& c, int i) {
+  return (i > HALL_CURVE_SEGMENTS) ? true : ((c.v[i] >= c.v[i - 1]) && isMonotonic(c, i + 1));
+}
+
+} // namespace hall_lut_detail
+
+// Default travel curve indexed by normalized signal (HALL_CURVE_SEGMENTS steps).
+static constexpr hall_lut_detail::Curve kHallDefaultCurve =
+  hall_lut_detail::makeCurve(hall_lut_detail::MakeIndexList<HALL_CURVE_SEGMENTS + 1>::type());
+
+static_assert(kHallDefaultCurve.v[0] == 0, "curve must start at 0");
+static_assert(kHallDefaultCurve.v[HALL_CURVE_SEGMENTS] == HALL_TRAVEL_FULL, "curve must end at full travel");
+static_assert(hall_lut_detail::isMonotonic(kHallDefaultCurve, 1), "curve must be monotonic");
+
+class MxgicHallLut {
+  private:
+    uint16_t base = 0;   // Raw value at rest (calibrated min)
+    uint16_t span = 0;   // Calibrated max - min
+    uint8_t shift = 0;   // Raw counts per table step = 1 << shift
+    bool valid = false;
+    uint16_t table[HALL_LUT_SEGMENTS + 1] = {};
+
+    // Default curve at a normalized signal in Q16 (0..65536).
+    static uint16_t curveAt(uint32_t signalQ16) {
+      const uint32_t pos = signalQ16 << HALL_CURVE_BITS;
+      const uint32_t idx = pos >> 16;
+      if (idx >= (uint32_t)HALL_CURVE_SEGMENTS) {
+        return HALL_TRAVEL_FULL;
+      }
+      const uint32_t frac = pos & 0xFFFFUL;
+      const uint32_t lo = kHallDefaultCurve.v[idx];
+      const uint32_t hi = kHallDefaultCurve.v[idx + 1];
+      return (uint16_t)(lo + (((hi - lo) * frac) >> 16));
+    }
+
+  public:
+    // Rebuilds the table for a calibrated raw range. Runs only when the
+    // calibration changes.
+    void build(unsigned int minRaw, unsigned int maxRaw) {
+      valid = (maxRaw > minRaw);
+      if (!valid) {
+        return;
+      }
+      base = (uint16_t)minRaw;
+      span = (uint16_t)(maxRaw - minRaw);
+      shift = 0;
+      while (((uint32_t)span >> shift) >= (uint32_t)HALL_LUT_SEGMENTS) {
+        shift++;
+      }
+      for (int i = 0; i <= HALL_LUT_SEGMENTS; i++) {
+        const uint32_t offset = (uint32_t)i << shift;
+        table[i] = (offset >= span) ? HALL_TRAVEL_FULL : curveAt((offset << 16) / span);
+      }
+    }
+
+    bool isValid() const {
+      return valid;
+    }
+
+    // Raw ADS counts -> travel units (0..HALL_TRAVEL_FULL).
+    uint16_t lookup(unsigned int raw) const {
+      if (!valid || raw <= base) {
+        return 0;
+      }
+      const uint32_t offset = (uint32_t)(raw - base);
+      // The top table step can straddle max; clamp on the range itself.
+      if (offset >= span) {
+        return HALL_TRAVEL_FULL;
+      }
+      const uint32_t idx = offset >> shift;
+      const uint32_t frac = offset & ((1UL << shift) - 1UL);
+      const uint32_t lo = table[idx];
+      const uint32_t hi = table[idx + 1];
+      return (uint16_t)(lo + (((hi - lo) * frac) >> shift));
+    }
+};
@@ -2,7 +2,11 @@
 
 #include <Arduino.h>
 #include <AS5600.h>
+
+#include "sensor_acq.h"
+
 // AS5600 Hall Effect Sensor
+// Only the acquisition task reads it; everything else uses the snapshot.
 extern AS5600 as5600;
 
 class MxgicRotary {
@@ -18,7 +22,7 @@ class MxgicRotary {
         bool rotationCheckActive;
 
     uint16_t readRawAngle() {
-        int angle = as5600.rawAngle();
+        int angle = sensorAcqKnobRaw();
         return angle;
     }
 
@@ -27,14 +31,14 @@ class MxgicRotary {
         return;
     }
     uint16_t readCaliAngle () {
-        int angle = as5600.rawAngle();
+        int angle = sensorAcqKnobRaw();
         angle = map(angle, 0, 4096, 0, precisionMap[precision]);
         return angle;
     }
 
     // This function maps the raw angle measured by the AS5600 to a range specified through function parameters
     uint16_t scanMapAngle(int myMap = 100 ,int myMap2 = 255 , int selectMap =1) {
-        int angleRaw = as5600.rawAngle();
+        int angleRaw = sensorAcqKnobRaw();
         myMapValue = map(angleRaw, 0, 4096, 0, myMap);
         myMapValue2 = map(angleRaw, 0, 4096, 0, myMap2);
         
@@ -51,11 +55,11 @@ class MxgicRotary {
     }
 
     void startRotationCheck() {
-        currentAngle = as5600.rawAngle();
+        currentAngle = sensorAcqKnobRaw();
         previousAngle = currentAngle;
     }
     int checkRotation() {
-        currentAngle = as5600.rawAngle();
+        currentAngle = sensorAcqKnobRaw();
         if (currentAngle == previousAngle) {
             return 0;
         }
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "mxgicAdsPipeline.h"
+#include "mxgicFilter.h"
+
+// Sensor acquisition task.
+//
+// A single FreeRTOS task owns both ADS1115s and the AS5600. It reads one
+// frame of every channel and publishes it as a timestamped snapshot through a
+// seqlock, so readers never block the writer and never touch the I2C bus.
+// Hall channels pass through a per-channel MxgicFilter before publishing.
+// Readers must not outrank the acquisition task on its core (they spin while
+// a frame is being written).
+
+static constexpr uint8_t SENSOR_ADC_COUNT = 2;      // ads1, ads2
+static constexpr uint8_t SENSOR_ADC_CHANNELS = 4;   // A0..A3
+
+struct SensorSnapshot {
+  uint32_t frame = 0;        // Increments once per published frame
+  uint32_t timestampUs = 0;  // micros() when the frame was completed
+  uint16_t hallRaw[SENSOR_ADC_COUNT][SENSOR_ADC_CHANNELS] = {};       // Filtered, [adcSel - 1][adcCh]
+  uint16_t hallUnfiltered[SENSOR_ADC_COUNT][SENSOR_ADC_CHANNELS] = {};  // As read from the ADC
+  uint16_t knobRaw = 0;      // AS5600 raw angle 0..4095
+};
+
+// Starts the task. ADS pipelines and the AS5600 must already be initialized.
+void sensorAcqStart(AdsScanMode mode);
+bool sensorAcqRunning();
+
+void sensorAcqSetScanMode(AdsScanMode mode);
+AdsScanMode sensorAcqScanMode();
+
+// Hall filter applied to every channel. Takes effect on the next frame
+// (filter state restarts from the next sample).
+void sensorAcqSetFilter(HallFilterMode mode, uint8_t strength);
+HallFilterMode sensorAcqFilterMode();
+uint8_t sensorAcqFilterStrength();
+
+// Data-rate governor: after 1.5 s with no key held and no
+// channel moving, both ADS1115s drop to a slower, quieter data rate; the
+// first frame that shows movement (or a held key) switches them back to the
+// fastest rate before the next conversion starts. Only the data rate
+// changes: idle frames still convert every channel, since the first press
+// can come on any key, and keep the same PGA, since a different gain would
+// rescale the raw counts that calibration and the thresholds are set in.
+// Disabled, the chips stay at the fastest rate. Enabled by default.
+void sensorAcqSetRateGovernor(bool enabled);
+bool sensorAcqRateGovernor();
+
+// Called by the key scan every frame; the governor keeps the fast rate while
+// any key is down.
+void sensorAcqSetKeysHeld(bool held);
+
+struct SensorAcqRateStats {
+  uint16_t samplesPerSecond = 0;  // Current ADS1115 data rate
+  bool idle = false;              // Running at the idle rate
+  uint32_t toIdle = 0;            // Switches to the idle rate since boot
+  uint32_t toActive = 0;          // Switches back to the fast rate
+  uint32_t idleMs = 0;            // Total time spent at the idle rate
+};
+
+void sensorAcqGetRateStats(SensorAcqRateStats& out);
+
+// Copies the latest consistent snapshot (lock-free).
+void sensorAcqRead(SensorSnapshot& out);
+
+// Convenience accessors; each takes its own snapshot.
+uint16_t sensorAcqHallRaw(int adcSel, int adcCh);
+uint16_t sensorAcqKnobRaw();
+
+// Registers the calling task to be notified on every published frame, then
+// blocks until a frame newer than the last one this task consumed arrives.
+// Returns false on timeout.
+bool sensorAcqWaitFrame(TickType_t timeout);
+
+// Smoothed frames per second of the acquisition task.
+uint32_t sensorAcqFramesPerSecond();
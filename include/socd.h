@@ -0,0 +1,67 @@
+#pragma once
+
+#include <Arduino.h>
+
+// SOCD (simultaneous opposing cardinal directions) resolution for pairs of
+// keys used as opposite directions, e.g. LT/RT as left/right.
+//
+// First stage after the key scan, fed once per scan frame with the
+// debounced key state and edges. While both keys of a pair are down only
+// the winner (or neither, for Neutral) is passed on; the conflict is
+// resolved on the frame that sees the second press. When one key comes up,
+// the other acts again on that frame. Keys in no pair pass straight through.
+
+enum class SocdPolicy : uint8_t {
+  Off = 0,
+  LastWins = 1,    // The key pressed last acts ("snap tap")
+  FirstWins = 2,   // The key already down keeps acting
+  Neutral = 3,     // Neither acts
+  DeeperWins = 4,  // The key pressed further acts (analog travel)
+};
+
+static constexpr uint8_t SOCD_POLICY_COUNT = 5;
+// Travel (of HALL_TRAVEL_FULL) the other key must be deeper by before
+// DeeperWins switches over, so two keys at the same depth don't flicker.
+static constexpr uint16_t SOCD_TRAVEL_HYSTERESIS = 80;
+
+class SocdResolver {
+  public:
+    static constexpr size_t MAX_PAIRS = 3;
+
+    // Linearized travel of a key; only called for DeeperWins and for
+    // presses of both keys on the same frame.
+    typedef uint16_t (*TravelFn)(size_t key);
+
+    // keyMask: exactly two keys (bit per hall key), else the pair is off.
+    void configure(size_t pair, uint8_t keyMask, SocdPolicy policy);
+
+    void update(uint8_t heldMask, uint8_t pressedMask, uint8_t releasedMask, TravelFn travel);
+
+    // Resolved key state and edges for the next stage.
+    uint8_t heldMask() const {
+      return heldOut;
+    }
+
+    uint8_t pressedMask() const {
+      return pressedOut;
+    }
+
+    uint8_t releasedMask() const {
+      return releasedOut;
+    }
+
+  private:
+    struct Pair {
+      uint8_t keys = 0;
+      SocdPolicy policy = SocdPolicy::Off;
+      uint8_t winner = 0;  // Key bit acting while both are down, 0 = none
+    };
+
+    Pair pairs[MAX_PAIRS];
+    uint8_t pairedMask = 0;  // Union of all active pairs' keys
+    uint8_t heldOut = 0;
+    uint8_t pressedOut = 0;
+    uint8_t releasedOut = 0;
+
+    static uint8_t deeper(const Pair& pair, TravelFn travel);
+};
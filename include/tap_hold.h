@@ -0,0 +1,103 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Tap-hold (dual-role) key resolution.
+//
+// Fed once per scan frame with the debounced press/release edges. Plain keys
+// start acting on the same frame they are pressed; only a dual-role key adds
+// delay, and only while it is undecided. Keys pressed while a dual-role key
+// is undecided are queued in order and released once it resolves, so a
+// modifier/layer hold applies to them. Time is passed in, never read.
+//
+// A dual-role key resolves to hold when:
+// - it has been down for its term (every mode);
+// - HoldOnOtherPress: any key is pressed after it;
+// - PermissiveHold: a key pressed after it is also released.
+// Released before that, it resolves to tap.
+//
+// A key tapped again while still queued keeps its place; the extra taps go
+// out first, each as its own press and release.
+
+enum class TapHoldMode : uint8_t {
+  Timeout = 0,
+  PermissiveHold = 1,
+  HoldOnOtherPress = 2,
+};
+
+static constexpr uint8_t TAP_HOLD_MODE_COUNT = 3;
+static constexpr uint16_t TAP_HOLD_TERM_DEFAULT_MS = 200;
+static constexpr uint16_t TAP_HOLD_TERM_MIN_MS = 50;
+static constexpr uint16_t TAP_HOLD_TERM_MAX_MS = 1000;
+
+class TapHoldEngine {
+  public:
+    static constexpr size_t MAX_KEYS = 8;
+
+    // Called when a key starts acting (its press, or when it leaves the
+    // queue). Latch whatever the key depends on (e.g. its layer) and return
+    // true if it is dual-role.
+    typedef bool (*ActivateFn)(size_t key);
+
+    void configure(size_t key, TapHoldMode mode, uint16_t termMs);
+
+    void update(uint32_t nowMs, uint8_t pressedMask, uint8_t releasedMask, ActivateFn activate);
+
+    // Keys acting with their tap (normal) program. A tap that resolved on
+    // release stays in here for exactly one frame.
+    uint8_t tapMask() const {
+      return taps;
+    }
+
+    // Keys acting with their hold program.
+    uint8_t holdMask() const {
+      return holds;
+    }
+
+    // Keys that started acting as tap / hold this frame.
+    uint8_t tapEdges() const {
+      return tapStarted;
+    }
+
+    uint8_t holdEdges() const {
+      return holdStarted;
+    }
+
+    // Keys held back: undecided or queued behind an undecided key.
+    uint8_t pendingMask() const;
+
+  private:
+    enum State : uint8_t {
+      Idle = 0,
+      Undecided,
+      Queued,
+      Tap,
+      Hold,
+    };
+
+    struct Key {
+      State state = Idle;
+      TapHoldMode mode = TapHoldMode::Timeout;
+      uint16_t termMs = TAP_HOLD_TERM_DEFAULT_MS;
+      uint32_t pressMs = 0;
+      bool releasedWhileQueued = false;
+      uint8_t queuedTaps = 0;   // Completed taps before its latest press
+    };
+
+    Key keys[MAX_KEYS];
+    uint8_t queue[MAX_KEYS] = {};
+    size_t queueLength = 0;
+    int8_t undecided = -1;
+    uint8_t pressedAfter = 0;   // Keys pressed while `undecided` was pending
+    uint8_t taps = 0;
+    uint8_t holds = 0;
+    uint8_t pulses = 0;         // Taps to drop from `taps` next frame
+    uint8_t tapStarted = 0;
+    uint8_t holdStarted = 0;
+
+    void start(size_t key, ActivateFn activate);
+    void startTap(size_t key);
+    void pulseTap(size_t key);
+    void resolveHold();
+    void checkTimeout(uint32_t nowMs);
+};
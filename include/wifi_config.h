@@ -9,8 +9,9 @@
 // - ssid: AP SSID (open AP)
 // - prefsNamespace: Preferences namespace used for keybind storage
 // - oled: display used for the "WiFi Config Mode" screen
-// - actions: array of action strings (btn0..btnN)
-// - actionCount: number of actions
+// - actions: KEYMAP_MAX_LAYERS rows of `actionCount` action strings
+//   (layer L, button i at actions[L * actionCount + i])
+// - actionCount: number of buttons
 void startWifiConfigPortal(const char* ssid,
                            const char* prefsNamespace,
                            Adafruit_SSD1306& oled,
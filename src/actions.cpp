@@ -0,0 +1,313 @@
+#include "actions.h"
+
+#include "hid_report.h"
+#include "keybinds.h"
+
+static constexpr uint16_t MACRO_MAX_MS = 0xFFFF;
+
+struct Combo {
+  uint8_t modifiers = 0;
+  uint8_t usages[HID_REPORT_KEY_SLOTS] = {};
+  size_t usageCount = 0;
+};
+
+// Appends opcodes to a program; records overflow instead of writing past the end.
+struct Emitter {
+  ActionProgram& program;
+  size_t pc = 0;
+  bool overflow = false;
+
+  explicit Emitter(ActionProgram& p) : program(p) {}
+
+  void op(uint8_t b) {
+    // Always leave room for the terminating END.
+    if (pc + 1 >= ACTION_PROGRAM_BYTES) {
+      overflow = true;
+      return;
+    }
+    program.code[pc++] = b;
+  }
+
+  void op(uint8_t b, uint8_t operand) {
+    if (pc + 2 >= ACTION_PROGRAM_BYTES) {
+      overflow = true;
+      return;
+    }
+    program.code[pc++] = b;
+    program.code[pc++] = operand;
+  }
+
+  void end() {
+    program.code[pc] = ACTION_OP_END;
+  }
+};
+
+static void appendError(String& error, const String& message) {
+  if (error.length() > 0) {
+    error += F("; ");
+  }
+  error += message;
+}
+
+// Parses "CTRL+SHIFT+Z" into modifier bits and usages. Invalid tokens are
+// skipped and described in `error`.
+static void parseCombo(const String& text, Combo& combo, String& error) {
+  combo = Combo();
+  int start = 0;
+  while (start < (int)text.length()) {
+    int plusPos = text.indexOf('+', start);
+    if (plusPos == -1) {
+      plusPos = text.length();
+    }
+    String token = text.substring(start, plusPos);
+    start = plusPos + 1;
+    token.trim();
+    token.toUpperCase();
+    if (token.length() == 0) {
+      continue;
+    }
+
+    uint8_t modifierBits = 0;
+    uint8_t usage = 0;
+    const uint8_t key = hidKeyCodeForToken(token);
+    if (key == 0 || !hidKeyToUsage(key, modifierBits, usage)) {
+      appendError(error, String(F("unknown token '")) + token + '\'');
+      continue;
+    }
+
+    combo.modifiers |= modifierBits;
+    if (usage == 0) {
+      continue;
+    }
+    bool duplicate = false;
+    for (size_t i = 0; i < combo.usageCount; i++) {
+      duplicate |= (combo.usages[i] == usage);
+    }
+    if (duplicate) {
+      continue;
+    }
+    if (combo.usageCount >= HID_REPORT_KEY_SLOTS) {
+      appendError(error, String(F("too many keys at '")) + token + '\'');
+      continue;
+    }
+    combo.usages[combo.usageCount++] = usage;
+  }
+}
+
+static void emitCombo(Emitter& emit, const Combo& combo, uint8_t modsOp, uint8_t keyOp) {
+  if (combo.modifiers != 0) {
+    emit.op(modsOp, combo.modifiers);
+  }
+  for (size_t i = 0; i < combo.usageCount; i++) {
+    emit.op(keyOp, combo.usages[i]);
+  }
+}
+
+static bool parseNumber(const String& text, uint32_t maxValue, uint32_t& value) {
+  if (text.length() == 0) {
+    return false;
+  }
+  for (size_t i = 0; i < (size_t)text.length(); i++) {
+    if (!isDigit(text[i])) {
+      return false;
+    }
+  }
+  const long v = text.toInt();
+  if (v < 0 || (uint32_t)v > maxValue) {
+    return false;
+  }
+  value = (uint32_t)v;
+  return true;
+}
+
+// Steps are separated by ';':
+//   PRESS <combo> | RELEASE <combo> | TAP <combo> | HOLD <ms> <combo>
+//   WAIT <ms> | REPEAT <n> ... END
+static void compileMacro(const String& body, Emitter& emit, String& error) {
+  emit.op(ACTION_OP_MACRO);
+  bool inRepeat = false;
+
+  int start = 0;
+  while (start <= (int)body.length()) {
+    int semiPos = body.indexOf(';', start);
+    if (semiPos == -1) {
+      semiPos = body.length();
+    }
+    String step = body.substring(start, semiPos);
+    start = semiPos + 1;
+    step.trim();
+    if (step.length() == 0) {
+      continue;
+    }
+
+    String verb = step;
+    String arg;
+    const int space = step.indexOf(' ');
+    if (space > 0) {
+      verb = step.substring(0, space);
+      arg = step.substring(space + 1);
+      arg.trim();
+    }
+    verb.toUpperCase();
+
+    uint32_t number = 0;
+    Combo combo;
+    if (verb == F("PRESS") || verb == F("RELEASE") || verb == F("TAP")) {
+      parseCombo(arg, combo, error);
+      if (verb != F("RELEASE")) {
+        emitCombo(emit, combo, ACTION_OP_PRESS_MODS, ACTION_OP_PRESS_KEY);
+        emit.op(ACTION_OP_SYNC);
+      }
+      if (verb != F("PRESS")) {
+        emitCombo(emit, combo, ACTION_OP_RELEASE_MODS, ACTION_OP_RELEASE_KEY);
+        emit.op(ACTION_OP_SYNC);
+      }
+    } else if (verb == F("HOLD")) {
+      String msText = arg;
+      String comboText;
+      const int argSpace = arg.indexOf(' ');
+      if (argSpace > 0) {
+        msText = arg.substring(0, argSpace);
+        comboText = arg.substring(argSpace + 1);
+      }
+      if (!parseNumber(msText, MACRO_MAX_MS, number) || comboText.length() == 0) {
+        appendError(error, String(F("bad step '")) + step + F("' (HOLD <ms> <combo>)"));
+        continue;
+      }
+      parseCombo(comboText, combo, error);
+      emitCombo(emit, combo, ACTION_OP_PRESS_MODS, ACTION_OP_PRESS_KEY);
+      emit.op(ACTION_OP_SYNC);
+      emit.op(ACTION_OP_WAIT, (uint8_t)(number & 0xFF));
+      emit.op((uint8_t)(number >> 8));
+      emitCombo(emit, combo, ACTION_OP_RELEASE_MODS, ACTION_OP_RELEASE_KEY);
+      emit.op(ACTION_OP_SYNC);
+    } else if (verb == F("WAIT")) {
+      if (!parseNumber(arg, MACRO_MAX_MS, number)) {
+        appendError(error, String(F("bad step '")) + step + F("' (WAIT <ms>)"));
+        continue;
+      }
+      emit.op(ACTION_OP_WAIT, (uint8_t)(number & 0xFF));
+      emit.op((uint8_t)(number >> 8));
+    } else if (verb == F("REPEAT")) {
+      if (inRepeat) {
+        appendError(error, F("nested REPEAT"));
+        continue;
+      }
+      if (!parseNumber(arg, 255, number) || number == 0) {
+        appendError(error, String(F("bad step '")) + step + F("' (REPEAT 1..255)"));
+        continue;
+      }
+      emit.op(ACTION_OP_REPEAT, (uint8_t)number);
+      inRepeat = true;
+    } else if (verb == F("END")) {
+      if (!inRepeat) {
+        appendError(error, F("END without REPEAT"));
+        continue;
+      }
+      emit.op(ACTION_OP_LOOP);
+      inRepeat = false;
+    } else {
+      appendError(error, String(F("unknown step '")) + step + '\'');
+    }
+  }
+
+  if (inRepeat) {
+    appendError(error, F("REPEAT without END"));
+    emit.op(ACTION_OP_LOOP);
+  }
+}
+
+bool actionCompile(const String& source, ActionProgram& out, String& error) {
+  out = ActionProgram();
+  error = String();
+  Emitter emit(out);
+
+  if (source.startsWith(ACTION_TYPE_PREFIX)) {
+    const size_t prefixLen = strlen(ACTION_TYPE_PREFIX);
+    const size_t textLen = source.length() - prefixLen;
+    if (textLen > 0) {
+      emit.op(ACTION_OP_TEXT);
+      out.text = source.c_str() + prefixLen;
+      out.textLength = (uint16_t)((textLen > 0xFFFF) ? 0xFFFF : textLen);
+    }
+  } else if (source.startsWith(ACTION_MACRO_PREFIX)) {
+    compileMacro(source.substring(strlen(ACTION_MACRO_PREFIX)), emit, error);
+  } else if (source.startsWith(ACTION_LAYER_PREFIX)) {
+    String arg = source.substring(strlen(ACTION_LAYER_PREFIX));
+    arg.trim();
+    uint32_t layer = 0;
+    if (!parseNumber(arg, KEYMAP_MAX_LAYERS, layer) || layer == 0) {
+      appendError(error, String(F("LAYER needs 1..")) + String((int)KEYMAP_MAX_LAYERS) + F(", got '") + arg + '\'');
+    } else {
+      emit.op(ACTION_OP_LAYER, (uint8_t)(layer - 1));
+    }
+  } else if (source.equalsIgnoreCase(ACTION_MENU)) {
+    emit.op(ACTION_OP_MENU);
+  } else {
+    Combo combo;
+    parseCombo(source, combo, error);
+    emitCombo(emit, combo, ACTION_OP_MODS, ACTION_OP_KEY);
+  }
+
+  if (emit.overflow) {
+    appendError(error, String(F("action too long (max ")) + String((int)ACTION_PROGRAM_BYTES) + F(" bytes compiled)"));
+    // Never run a truncated macro.
+    emit.pc = 0;
+  }
+  emit.end();
+  return error.length() == 0;
+}
+
+void actionApplyHeld(const ActionProgram& program, KeyReport& report) {
+  size_t pc = 0;
+  while (pc + 1 < ACTION_PROGRAM_BYTES) {
+    const uint8_t op = program.code[pc++];
+    switch (op) {
+      case ACTION_OP_MODS:
+        report.modifiers |= program.code[pc++];
+        break;
+      case ACTION_OP_KEY:
+        (void)hidReportAddUsage(report, program.code[pc++]);
+        break;
+      default:
+        // END, TEXT and macros hold nothing.
+        return;
+    }
+  }
+}
+
+bool actionReleaseShared(const ActionProgram& from, const ActionProgram& to, KeyReport& report) {
+  KeyReport held;
+  KeyReport next;
+  hidReportClear(held);
+  hidReportClear(next);
+  actionApplyHeld(from, held);
+  actionApplyHeld(to, next);
+
+  bool released = false;
+  for (size_t i = 0; i < HID_REPORT_KEY_SLOTS; i++) {
+    const uint8_t usage = held.keys[i];
+    // Modifiers don't repeat, so a shared one may stay down.
+    if (usage != 0 && hidReportHasUsage(next, usage) && hidReportHasUsage(report, usage)) {
+      hidReportRemoveUsage(report, usage);
+      released = true;
+    }
+  }
+  return released;
+}
+
+bool actionHasText(const ActionProgram& program) {
+  return program.code[0] == ACTION_OP_TEXT && program.text != nullptr && program.textLength > 0;
+}
+
+bool actionIsMacro(const ActionProgram& program) {
+  return program.code[0] == ACTION_OP_MACRO;
+}
+
+int actionLayer(const ActionProgram& program) {
+  return (program.code[0] == ACTION_OP_LAYER) ? (int)program.code[1] : -1;
+}
+
+bool actionIsMenu(const ActionProgram& program) {
+  return program.code[0] == ACTION_OP_MENU;
+}
@@ -0,0 +1,319 @@
+#include "ble_hosts.h"
+
+#include <Preferences.h>
+#include <esp_gap_ble_api.h>
+
+static constexpr const char* BLE_HOSTS_KEY = "bleHosts";
+static constexpr uint8_t BLE_HOSTS_VERSION = 1;
+
+// Advertising interval while waiting for a host, in 0.625 ms units
+// (20..30 ms): the host's scanner finds us within a few of its scan windows.
+static constexpr uint16_t ADV_MIN_INTERVAL = 0x20;
+static constexpr uint16_t ADV_MAX_INTERVAL = 0x30;
+
+struct BleHostSlot {
+  uint8_t used;
+  uint8_t addrType;  // esp_ble_addr_type_t
+  uint8_t bda[6];
+};
+
+struct BleHostsRecord {
+  uint8_t version;
+  uint8_t active;
+  uint8_t reserved[2];
+  BleHostSlot slots[BLE_HOST_SLOTS];
+};
+
+// Slot table, filter state and stats: guarded by g_lock. The Bluedroid
+// handlers never take it; they only post into the volatile fields below.
+static SemaphoreHandle_t g_lock = nullptr;
+static const char* g_prefsNamespace = nullptr;
+static BleHostsRecord g_rec;
+static bool g_dirty = false;
+static bool g_open = false;
+static bool g_listed = false;            // Whitelist holds g_listedSlot
+static BleHostSlot g_listedSlot;
+static uint32_t g_waitStartMs = 0;       // Since when we're waiting for a host
+static uint32_t g_measureStartMs = 0;
+static bool g_measuring = false;         // Timing a select/boot reconnect
+static uint32_t g_reconnectMs = 0;
+static uint32_t g_reconnectMaxMs = 0;
+static uint32_t g_reconnects = 0;
+static uint32_t g_switches = 0;
+
+// Written by the Bluedroid task.
+static volatile bool g_connected = false;
+static volatile bool g_disconnected = false;  // Since the last service pass
+static esp_bd_addr_t g_peer = {0};
+static volatile bool g_authPending = false;
+static volatile uint32_t g_authMs = 0;
+static volatile uint8_t g_authType = 0;
+static esp_bd_addr_t g_authBda = {0};
+
+static esp_ble_wl_addr_type_t whitelistType(uint8_t addrType) {
+  return (addrType == BLE_ADDR_TYPE_PUBLIC) ? BLE_WL_ADDR_TYPE_PUBLIC : BLE_WL_ADDR_TYPE_RANDOM;
+}
+
+static int findSlot(const uint8_t* bda) {
+  for (size_t i = 0; i < BLE_HOST_SLOTS; i++) {
+    if (g_rec.slots[i].used && memcmp(g_rec.slots[i].bda, bda, sizeof(g_rec.slots[i].bda)) == 0) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+static void printSlot(size_t slot) {
+  Serial.print(F("[ble] host "));
+  Serial.print((int)(slot + 1));
+}
+
+// Points the advertising connect filter at the active slot (or opens it).
+// The whitelist can't change while advertising uses it, so stop first.
+static void applyFilter() {
+  BLEAdvertising* adv = BLEDevice::getAdvertising();
+  adv->stop();
+  if (g_listed) {
+    (void)esp_ble_gap_update_whitelist(false, g_listedSlot.bda, whitelistType(g_listedSlot.addrType));
+    g_listed = false;
+  }
+  const BleHostSlot& slot = g_rec.slots[g_rec.active];
+  if (slot.used && !g_open) {
+    g_listedSlot = slot;
+    g_listed = (esp_ble_gap_update_whitelist(true, g_listedSlot.bda, whitelistType(g_listedSlot.addrType)) == ESP_OK);
+  }
+  adv->setMinInterval(ADV_MIN_INTERVAL);
+  adv->setMaxInterval(ADV_MAX_INTERVAL);
+  // Scan requests stay open so the pad still shows up in host scans.
+  adv->setScanFilter(false, g_listed);
+  if (!g_connected) {
+    adv->start();
+  }
+}
+
+static void startWaiting(uint32_t nowMs) {
+  g_waitStartMs = nowMs;
+  g_measureStartMs = nowMs;
+  g_measuring = (g_rec.slots[g_rec.active].used != 0);
+}
+
+static void saveRecord() {
+  g_dirty = false;
+  if (g_prefsNamespace == nullptr) {
+    return;
+  }
+  Preferences prefs;
+  if (!prefs.begin(g_prefsNamespace, false)) {
+    Serial.println(F("[ble] prefs begin() failed; hosts not saved"));
+    return;
+  }
+  (void)prefs.putBytes(BLE_HOSTS_KEY, &g_rec, sizeof(g_rec));
+  prefs.end();
+}
+
+// A link finished encryption: either a stored host came back or a new one
+// bonded.
+static void onAuthComplete() {
+  const int found = findSlot(g_authBda);
+  if (found >= 0) {
+    if ((size_t)found != g_rec.active) {
+      // Only possible with the filter open (fallback).
+      g_rec.active = (uint8_t)found;
+      g_dirty = true;
+    }
+    printSlot((size_t)found);
+    if (g_measuring) {
+      g_reconnectMs = g_authMs - g_measureStartMs;
+      if (g_reconnectMs > g_reconnectMaxMs) {
+        g_reconnectMaxMs = g_reconnectMs;
+      }
+      g_reconnects++;
+      Serial.print(F(" ready in "));
+      Serial.print(g_reconnectMs);
+      Serial.println(F(" ms"));
+    } else {
+      Serial.println(F(" reconnected"));
+    }
+  } else {
+    // New bond: the selected slot if it's free, else the first free one.
+    size_t target = g_rec.active;
+    if (g_rec.slots[target].used) {
+      target = BLE_HOST_SLOTS;
+      for (size_t i = 0; i < BLE_HOST_SLOTS; i++) {
+        if (!g_rec.slots[i].used) {
+          target = i;
+          break;
+        }
+      }
+    }
+    if (target >= BLE_HOST_SLOTS) {
+      Serial.println(F("[ble] all host slots in use; new bond not stored"));
+    } else {
+      BleHostSlot& slot = g_rec.slots[target];
+      slot.used = 1;
+      slot.addrType = g_authType;
+      memcpy(slot.bda, g_authBda, sizeof(slot.bda));
+      g_rec.active = (uint8_t)target;
+      g_dirty = true;
+      printSlot(target);
+      Serial.println(F(" paired"));
+    }
+  }
+  g_measuring = false;
+
+  // Re-arm the filter for this host's next reconnect.
+  g_open = false;
+  applyFilter();
+}
+
+void bleHostsBegin(const char* prefsNamespace) {
+  if (g_lock == nullptr) {
+    g_lock = xSemaphoreCreateMutex();
+  }
+  g_prefsNamespace = prefsNamespace;
+
+  memset(&g_rec, 0, sizeof(g_rec));
+  g_rec.version = BLE_HOSTS_VERSION;
+  Preferences prefs;
+  if (prefsNamespace != nullptr && prefs.begin(prefsNamespace, false)) {
+    BleHostsRecord rec;
+    if (prefs.getBytes(BLE_HOSTS_KEY, &rec, sizeof(rec)) == sizeof(rec) &&
+        rec.version == BLE_HOSTS_VERSION && rec.active < BLE_HOST_SLOTS) {
+      g_rec = rec;
+    }
+    prefs.end();
+  }
+
+  xSemaphoreTake(g_lock, portMAX_DELAY);
+  startWaiting(millis());
+  applyFilter();
+  printSlot(g_rec.active);
+  Serial.println(g_rec.slots[g_rec.active].used ? F(" selected") : F(" selected (empty, pairing)"));
+  xSemaphoreGive(g_lock);
+}
+
+bool bleHostsSelect(size_t slot) {
+  if (slot >= BLE_HOST_SLOTS || g_lock == nullptr) {
+    return false;
+  }
+  xSemaphoreTake(g_lock, portMAX_DELAY);
+  if (slot == g_rec.active && g_connected) {
+    xSemaphoreGive(g_lock);
+    return true;
+  }
+  if (slot != g_rec.active) {
+    g_rec.active = (uint8_t)slot;
+    g_dirty = true;
+    g_switches++;
+  }
+  g_open = false;
+  startWaiting(millis());
+  applyFilter();
+  if (g_connected) {
+    // BleKeyboard restarts advertising on disconnect; the filter is already set.
+    (void)esp_ble_gap_disconnect(g_peer);
+  }
+  printSlot(slot);
+  Serial.println(g_rec.slots[slot].used ? F(" selected") : F(" selected (empty, pairing)"));
+  xSemaphoreGive(g_lock);
+  return true;
+}
+
+void bleHostsForget(size_t slot) {
+  if (slot >= BLE_HOST_SLOTS || g_lock == nullptr) {
+    return;
+  }
+  xSemaphoreTake(g_lock, portMAX_DELAY);
+  BleHostSlot& entry = g_rec.slots[slot];
+  if (entry.used) {
+    // Also drops the link if this host is connected.
+    (void)esp_ble_remove_bond_device(entry.bda);
+    memset(&entry, 0, sizeof(entry));
+    g_dirty = true;
+    if (slot == g_rec.active) {
+      g_open = false;
+      startWaiting(millis());
+      applyFilter();
+    }
+    printSlot(slot);
+    Serial.println(F(" forgotten"));
+  }
+  xSemaphoreGive(g_lock);
+}
+
+size_t bleHostsActive() {
+  return g_rec.active;
+}
+
+bool bleHostsSlotUsed(size_t slot) {
+  return (slot < BLE_HOST_SLOTS) && (g_rec.slots[slot].used != 0);
+}
+
+void bleHostsService(uint32_t nowMs) {
+  if (g_lock == nullptr) {
+    return;
+  }
+  xSemaphoreTake(g_lock, portMAX_DELAY);
+  if (g_disconnected) {
+    g_disconnected = false;
+    if (!g_measuring) {
+      g_waitStartMs = nowMs;
+    }
+  }
+  if (g_authPending) {
+    g_authPending = false;
+    onAuthComplete();
+  }
+  if (!g_connected && !g_open && g_rec.slots[g_rec.active].used &&
+      (uint32_t)(nowMs - g_waitStartMs) >= BLE_HOST_OPEN_AFTER_MS) {
+    g_open = true;
+    applyFilter();
+    printSlot(g_rec.active);
+    Serial.println(F(" not back; accepting any bonded host"));
+  }
+  if (g_dirty) {
+    saveRecord();
+  }
+  xSemaphoreGive(g_lock);
+}
+
+void bleHostsOnGattsEvent(esp_gatts_cb_event_t event, esp_ble_gatts_cb_param_t* param) {
+  switch (event) {
+    case ESP_GATTS_CONNECT_EVT:
+      memcpy(g_peer, param->connect.remote_bda, sizeof(esp_bd_addr_t));
+      g_connected = true;
+      break;
+    case ESP_GATTS_DISCONNECT_EVT:
+      g_connected = false;
+      g_disconnected = true;
+      break;
+    default:
+      break;
+  }
+}
+
+void bleHostsOnGapEvent(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param) {
+  if (event != ESP_GAP_BLE_AUTH_CMPL_EVT || !param->ble_security.auth_cmpl.success) {
+    return;
+  }
+  // Bonded hosts are reported by identity address, so this matches the slot.
+  memcpy(g_authBda, param->ble_security.auth_cmpl.bd_addr, sizeof(esp_bd_addr_t));
+  g_authType = (uint8_t)param->ble_security.auth_cmpl.addr_type;
+  g_authMs = millis();
+  g_authPending = true;
+}
+
+void bleHostsGetStats(BleHostStats& out) {
+  out.activeSlot = g_rec.active;
+  out.usedMask = 0;
+  for (size_t i = 0; i < BLE_HOST_SLOTS; i++) {
+    if (g_rec.slots[i].used) {
+      out.usedMask |= (uint8_t)(1U << i);
+    }
+  }
+  out.open = g_open;
+  out.reconnectMs = g_reconnectMs;
+  out.reconnectMaxMs = g_reconnectMaxMs;
+  out.reconnects = g_reconnects;
+  out.switches = g_switches;
+}
@@ -0,0 +1,176 @@
+#include "ble_link.h"
+
+#include "ble_hosts.h"
+
+#include <BLEDevice.h>
+#include <esp_gap_ble_api.h>
+
+// Connection intervals are in 1.25 ms units, supervision timeout in 10 ms.
+// Fast: 7.5..15 ms, no slave latency. Hosts clamp to what they support
+// (e.g. Windows ~7.5 ms, macOS/iOS 15 ms).
+static constexpr uint16_t FAST_MIN_INTERVAL = 6;
+static constexpr uint16_t FAST_MAX_INTERVAL = 12;
+static constexpr uint16_t FAST_LATENCY = 0;
+// Low power: 30..50 ms, and the peripheral may skip up to 4 events.
+static constexpr uint16_t IDLE_MIN_INTERVAL = 24;
+static constexpr uint16_t IDLE_MAX_INTERVAL = 40;
+static constexpr uint16_t IDLE_LATENCY = 4;
+static constexpr uint16_t SUPERVISION_TIMEOUT = 400;  // 4 s
+
+static constexpr uint32_t IDLE_AFTER_MS = 30000;
+
+static SemaphoreHandle_t g_notifyDone = nullptr;
+
+static volatile bool g_connected = false;
+static volatile bool g_congested = false;
+static volatile bool g_paramsLogged = true;
+static volatile uint16_t g_interval = 0;   // 1.25 ms units
+static volatile uint16_t g_latency = 0;
+static volatile uint16_t g_timeout = 0;    // 10 ms units
+static volatile uint32_t g_notifySent = 0;
+static volatile uint32_t g_notifyFailed = 0;
+static volatile uint32_t g_congestEvents = 0;
+static volatile uint32_t g_paramUpdates = 0;
+
+static esp_bd_addr_t g_peer = {0};
+static volatile bool g_wantFast = false;   // Set on connect: request fast params
+static bool g_lowPower = false;
+static uint32_t g_lastActiveMs = 0;
+
+static void requestParams(bool fast) {
+  esp_ble_conn_update_params_t params;
+  memcpy(params.bda, g_peer, sizeof(esp_bd_addr_t));
+  params.min_int = fast ? FAST_MIN_INTERVAL : IDLE_MIN_INTERVAL;
+  params.max_int = fast ? FAST_MAX_INTERVAL : IDLE_MAX_INTERVAL;
+  params.latency = fast ? FAST_LATENCY : IDLE_LATENCY;
+  params.timeout = SUPERVISION_TIMEOUT;
+  if (esp_ble_gap_update_conn_params(&params) == ESP_OK) {
+    g_lowPower = !fast;
+  }
+}
+
+static void onGattsEvent(esp_gatts_cb_event_t event, esp_gatt_if_t gattsIf, esp_ble_gatts_cb_param_t* param) {
+  (void)gattsIf;
+  bleHostsOnGattsEvent(event, param);
+  switch (event) {
+    case ESP_GATTS_CONNECT_EVT:
+      memcpy(g_peer, param->connect.remote_bda, sizeof(esp_bd_addr_t));
+      g_connected = true;
+      g_congested = false;
+      g_wantFast = true;
+      break;
+    case ESP_GATTS_DISCONNECT_EVT:
+      g_connected = false;
+      g_congested = false;
+      g_interval = 0;
+      g_paramsLogged = false;
+      break;
+    case ESP_GATTS_CONF_EVT:
+      if (param->conf.status == ESP_GATT_OK) {
+        g_notifySent = g_notifySent + 1;
+      } else {
+        g_notifyFailed = g_notifyFailed + 1;
+      }
+      if (g_notifyDone != nullptr) {
+        xSemaphoreGive(g_notifyDone);
+      }
+      break;
+    case ESP_GATTS_CONGEST_EVT:
+      if (param->congest.congested && !g_congested) {
+        g_congestEvents = g_congestEvents + 1;
+      }
+      g_congested = param->congest.congested;
+      break;
+    default:
+      break;
+  }
+}
+
+static void onGapEvent(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param) {
+  bleHostsOnGapEvent(event, param);
+  if (event != ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT) {
+    return;
+  }
+  if (param->update_conn_params.status == 0) {
+    g_interval = param->update_conn_params.conn_int;
+    g_latency = param->update_conn_params.latency;
+    g_timeout = param->update_conn_params.timeout;
+    g_paramUpdates = g_paramUpdates + 1;
+    g_paramsLogged = false;
+  }
+}
+
+void bleLinkBegin() {
+  if (g_notifyDone == nullptr) {
+    g_notifyDone = xSemaphoreCreateBinary();
+  }
+  BLEDevice::setCustomGattsHandler(onGattsEvent);
+  BLEDevice::setCustomGapHandler(onGapEvent);
+}
+
+void bleLinkArmNotify() {
+  if (g_notifyDone != nullptr) {
+    (void)xSemaphoreTake(g_notifyDone, 0);
+  }
+}
+
+bool bleLinkWaitNotifyDone(uint32_t timeoutMs) {
+  if (g_notifyDone == nullptr) {
+    return false;
+  }
+  return xSemaphoreTake(g_notifyDone, pdMS_TO_TICKS(timeoutMs)) == pdTRUE;
+}
+
+void bleLinkService(uint32_t nowMs, bool active) {
+  if (active) {
+    g_lastActiveMs = nowMs;
+  }
+
+  if (g_connected) {
+    if (g_wantFast || (active && g_lowPower)) {
+      g_wantFast = false;
+      g_lastActiveMs = nowMs;
+      requestParams(true);
+    } else if (!g_lowPower && (uint32_t)(nowMs - g_lastActiveMs) >= IDLE_AFTER_MS) {
+      requestParams(false);
+    }
+  }
+
+  if (!g_paramsLogged) {
+    g_paramsLogged = true;
+    if (g_connected) {
+      Serial.print(F("[ble] interval="));
+      Serial.print((uint32_t)g_interval * 1250UL);
+      Serial.print(F("us latency="));
+      Serial.print((int)g_latency);
+      Serial.print(F(" timeout="));
+      Serial.print((uint32_t)g_timeout * 10UL);
+      Serial.print(F("ms sent="));
+      Serial.print(g_notifySent);
+      Serial.print(F(" failed="));
+      Serial.print(g_notifyFailed);
+      Serial.print(F(" congested="));
+      Serial.println(g_congestEvents);
+    } else {
+      Serial.print(F("[ble] disconnected; sent="));
+      Serial.print(g_notifySent);
+      Serial.print(F(" failed="));
+      Serial.print(g_notifyFailed);
+      Serial.print(F(" congested="));
+      Serial.println(g_congestEvents);
+    }
+  }
+}
+
+void bleLinkGetStats(BleLinkStats& out) {
+  out.connected = g_connected;
+  out.lowPower = g_lowPower;
+  out.congested = g_congested;
+  out.intervalUs = (uint32_t)g_interval * 1250UL;
+  out.latency = g_latency;
+  out.timeoutMs = (uint16_t)(g_timeout * 10U);
+  out.notifySent = g_notifySent;
+  out.notifyFailed = g_notifyFailed;
+  out.congestEvents = g_congestEvents;
+  out.paramUpdates = g_paramUpdates;
+}
@@ -0,0 +1,115 @@
+#include "combo.h"
+
+static uint8_t bitCount(uint8_t mask) {
+  uint8_t count = 0;
+  for (; mask != 0; mask &= (uint8_t)(mask - 1)) {
+    count++;
+  }
+  return count;
+}
+
+void ComboEngine::configure(size_t combo, uint8_t keyMask, uint16_t window) {
+  if (combo >= MAX_COMBOS) {
+    return;
+  }
+  if (window < COMBO_WINDOW_MIN_MS) window = COMBO_WINDOW_MIN_MS;
+  if (window > COMBO_WINDOW_MAX_MS) window = COMBO_WINDOW_MAX_MS;
+  comboKeys[combo] = (bitCount(keyMask) >= 2) ? keyMask : 0;
+  windowMs[combo] = window;
+
+  memberMask = 0;
+  for (size_t c = 0; c < MAX_COMBOS; c++) {
+    memberMask |= comboKeys[c];
+  }
+}
+
+// Held-back keys go out as plain presses.
+void ComboEngine::flush() {
+  pressedOut |= buffered;
+  buffered = 0;
+}
+
+// Fire a completed chord unless a bigger one can still complete in time;
+// give up once nothing can.
+void ComboEngine::decide(uint32_t nowMs) {
+  if (buffered == 0) {
+    return;
+  }
+  const uint32_t elapsed = nowMs - firstPressMs;
+  const uint32_t chordMs = lastPressMs - firstPressMs;
+  int complete = -1;
+  bool growing = false;
+  for (size_t c = 0; c < MAX_COMBOS; c++) {
+    if (comboKeys[c] == 0 || (buffered & (uint8_t)~comboKeys[c])) {
+      continue;
+    }
+    if (comboKeys[c] == buffered) {
+      if (chordMs <= windowMs[c]) {
+        complete = (int)c;
+      }
+    } else if (elapsed < windowMs[c]) {
+      growing = true;
+    }
+  }
+
+  if (growing) {
+    return;
+  }
+  if (complete >= 0) {
+    active |= (uint8_t)(1U << complete);
+    fired |= (uint8_t)(1U << complete);
+    consumed |= buffered;
+    buffered = 0;
+    return;
+  }
+  flush();
+}
+
+void ComboEngine::update(uint32_t nowMs, uint8_t pressedMask, uint8_t releasedMask) {
+  pressedOut = 0;
+  releasedOut = deferredRelease;
+  deferredRelease = 0;
+  fired = 0;
+
+  for (size_t i = 0; i < 8; i++) {
+    const uint8_t bit = (uint8_t)(1U << i);
+    if (!(releasedMask & bit)) {
+      continue;
+    }
+    if (consumed & bit) {
+      // First key up ends the combo; the rest stay swallowed.
+      consumed &= (uint8_t)~bit;
+      for (size_t c = 0; c < MAX_COMBOS; c++) {
+        if (comboKeys[c] & bit) {
+          active &= (uint8_t)~(1U << c);
+        }
+      }
+    } else if (buffered & bit) {
+      // Tapped alone: press now, release next frame so it still registers.
+      flush();
+      deferredRelease |= bit;
+    } else {
+      releasedOut |= bit;
+    }
+  }
+
+  for (size_t i = 0; i < 8; i++) {
+    const uint8_t bit = (uint8_t)(1U << i);
+    if (!(pressedMask & bit)) {
+      continue;
+    }
+    if (!(memberMask & bit)) {
+      // Not in any combo: no delay. Anything held back was pressed first.
+      flush();
+      pressedOut |= bit;
+      continue;
+    }
+    if (buffered == 0) {
+      firstPressMs = nowMs;
+    }
+    buffered |= bit;
+    lastPressMs = nowMs;
+  }
+
+  decide(nowMs);
+}
@@ -2,6 +2,13 @@
 
 #include <Preferences.h>
 
+#include "ble_link.h"
+#include "ble_hosts.h"
+#include "hid_output.h"
+#include "hid_transport.h"
+#include "gamepad.h"
+#include "midi_out.h"
+
 static String jsonEscape(const String& input) {
   String out;
   out.reserve(input.length() + 8);
@@ -56,6 +63,11 @@ static String buildDiagHtml() {
   html += F("<h3>Live Readings</h3>");
   html += F("<pre id='j' style='white-space:pre-wrap'></pre>");
 
+  html += F("<h3>Scan Benchmark</h3>");
+  html += F("<p>Runs the acquisition task for 1 s serialized (one chip at a time) and 1 s interleaved (both chips at once).</p>");
+  html += F("<button onclick='bench()'>Run</button>");
+  html += F("<pre id='bench'></pre>");
+
   html += F("<h3>LED Test</h3>");
   html += F("<div style='margin:10px 0'>");
   html += F("<label>Strip: ");
@@ -76,6 +88,7 @@ static String buildDiagHtml() {
   html += F("<script>");
   html += F("function hexToRgb(h){h=h.replace('#','');return {r:parseInt(h.slice(0,2),16),g:parseInt(h.slice(2,4),16),b:parseInt(h.slice(4,6),16)};}");
   html += F("async function poll(){try{const r=await fetch('/api/diag');const j=await r.json();document.getElementById('j').textContent=JSON.stringify(j,null,2);}catch(e){document.getElementById('j').textContent='(error fetching /api/diag)';}setTimeout(poll,400);} poll();");
+  html += F("async function bench(){const el=document.getElementById('bench');el.textContent='running...';try{const r=await fetch('/api/scanbench');el.textContent=JSON.stringify(await r.json(),null,2);}catch(e){el.textContent='(error)';}}");
   html += F("async function post(url, body){await fetch(url,{method:'POST',headers:{'Content-Type':'application/x-www-form-urlencoded'},body});}");
   html += F("async function clearLeds(){const s=document.getElementById('strip').value;await post('/api/led/clear','strip='+encodeURIComponent(s));}");
   html += F("async function setLed(){const s=document.getElementById('strip').value;const idx=document.getElementById('idx').value||0;const rgb=hexToRgb(document.getElementById('col').value);const body='strip='+encodeURIComponent(s)+'&idx='+encodeURIComponent(idx)+'&r='+rgb.r+'&g='+rgb.g+'&b='+rgb.b;await post('/api/led/set',body);}");
@@ -86,11 +99,53 @@ static String buildDiagHtml() {
   return html;
 }
 
+static uint32_t benchFramesPerSecond(AdsScanMode mode, uint32_t windowMs) {
+  // The acquisition task owns the bus; switch its mode and count frames.
+  sensorAcqSetScanMode(mode);
+  delay(50); // let the in-flight frame finish in the old mode
+  SensorSnapshot snap;
+  sensorAcqRead(snap);
+  const uint32_t startFrame = snap.frame;
+  const uint32_t startUs = snap.timestampUs;
+  delay(windowMs);
+  sensorAcqRead(snap);
+  const uint32_t elapsedUs = snap.timestampUs - startUs;
+  if (elapsedUs == 0) return 0;
+  return (uint32_t)((uint64_t)(snap.frame - startFrame) * 1000000ULL / elapsedUs);
+}
+
+static void writeScanBenchJson(WebServer& server) {
+  static constexpr uint32_t kWindowMs = 1000;
+  const AdsScanMode previous = sensorAcqScanMode();
+  // Measure at the fastest data rate, not whatever the governor picked.
+  const bool governor = sensorAcqRateGovernor();
+  sensorAcqSetRateGovernor(false);
+  const uint32_t serializedFps = benchFramesPerSecond(AdsScanMode::Serialized, kWindowMs);
+  const uint32_t interleavedFps = benchFramesPerSecond(AdsScanMode::Interleaved, kWindowMs);
+  sensorAcqSetScanMode(previous);
+  sensorAcqSetRateGovernor(governor);
+
+  String json;
+  json.reserve(128);
+  json += F("{\"windowMs\":");
+  json += String(kWindowMs);
+  json += F(",\"serializedFps\":");
+  json += String(serializedFps);
+  json += F(",\"interleavedFps\":");
+  json += String(interleavedFps);
+  json += '}';
+  server.send(200, "application/json", json);
+}
+
 static void writeDiagJson(WebServer& server, const DiagnosticsContext& ctx) {
   String json;
   json.reserve(2048);
   json += '{';
 
+  // One acquisition frame for every sensor value below.
+  SensorSnapshot snap;
+  sensorAcqRead(snap);
+
   json += F("\"millis\":");
   json += String((uint32_t)millis());
 
@@ -117,12 +172,141 @@ static void writeDiagJson(WebServer& server, const DiagnosticsContext& ctx) {
   if (ctx.knob != nullptr) {
     json += F(",\"knob\":{");
     json += F("\"rawAngle\":");
-    json += String((int)ctx.knob->readRawAngle());
+    json += String((int)snap.knobRaw);
     json += F(",\"mapped\":");
     json += String((int)ctx.knob->scanMapAngle(1024, 255, 1));
     json += '}';
   }
 
+  // Frame scan
+  json += F(",\"scan\":{");
+  json += F("\"frame\":");
+  json += String(snap.frame);
+  json += F(",\"timestampUs\":");
+  json += String(snap.timestampUs);
+  json += F(",\"frameUs\":");
+  json += String(adsPipelineFrameTimeUs());
+  json += F(",\"fps\":");
+  json += String(sensorAcqFramesPerSecond());
+  json += F(",\"interleaved\":");
+  json += (sensorAcqScanMode() == AdsScanMode::Interleaved) ? F("true") : F("false");
+  json += F(",\"filter\":");
+  json += String((int)sensorAcqFilterMode());
+  json += F(",\"filterStrength\":");
+  json += String((int)sensorAcqFilterStrength());
+  SensorAcqRateStats rate;
+  sensorAcqGetRateStats(rate);
+  json += F(",\"adsSps\":");
+  json += String((int)rate.samplesPerSecond);
+  json += F(",\"adsIdle\":");
+  json += rate.idle ? F("true") : F("false");
+  json += F(",\"rateGovernor\":");
+  json += sensorAcqRateGovernor() ? F("true") : F("false");
+  json += F(",\"rateToIdle\":");
+  json += String(rate.toIdle);
+  json += F(",\"rateToActive\":");
+  json += String(rate.toActive);
+  json += F(",\"idleMs\":");
+  json += String(rate.idleMs);
+  json += '}';
+
+  // HID output queue
+  HidOutputStats hid;
+  hidOutputGetStats(hid);
+  const HidTransportKind transport = hidTransportActive();
+  json += F(",\"hid\":{");
+  json += F("\"transport\":\"");
+  json += (transport == HidTransportKind::Usb) ? F("usb") : (transport == HidTransportKind::Ble) ? F("ble") : F("none");
+  json += F("\",\"queued\":");
+  json += String(hid.queued);
+  json += F(",\"sent\":");
+  json += String(hid.sent);
+  json += F(",\"depth\":");
+  json += String((int)hid.depth);
+  json += F(",\"highWater\":");
+  json += String((int)hid.highWater);
+  json += F(",\"reportRetries\":");
+  json += String(hid.reportRetries);
+  json += F(",\"textDropped\":");
+  json += String(hid.textDropped);
+  json += F(",\"macrosRunning\":");
+  json += String((int)hid.macrosRunning);
+  json += F(",\"macrosDropped\":");
+  json += String(hid.macrosDropped);
+  json += F(",\"typedChars\":");
+  json += String(hid.typedChars);
+  json += F(",\"typeCps\":");
+  json += String(hid.typeCps);
+  GamepadStats pad;
+  gamepadGetStats(pad);
+  json += F(",\"gamepadPosted\":");
+  json += String(pad.posted);
+  json += F(",\"gamepadSent\":");
+  json += String(pad.sent);
+  json += F(",\"gamepadFailed\":");
+  json += String(pad.failed);
+  json += F(",\"gamepadHz\":");
+  json += String((int)pad.rateHz);
+  json += '}';
+
+  // BLE-MIDI (only running in MIDI mode)
+  MidiOutStats midi;
+  midiOutGetStats(midi);
+  json += F(",\"midi\":{");
+  json += F("\"subscribed\":");
+  json += midi.subscribed ? F("true") : F("false");
+  json += F(",\"sent\":");
+  json += String(midi.sent);
+  json += F(",\"packets\":");
+  json += String(midi.packets);
+  json += F(",\"dropped\":");
+  json += String(midi.dropped);
+  json += F(",\"lastVelocity\":");
+  json += String((int)midi.lastVelocity);
+  json += '}';
+
+  // BLE link
+  BleLinkStats ble;
+  bleLinkGetStats(ble);
+  json += F(",\"ble\":{");
+  json += F("\"connected\":");
+  json += (ble.connected ? F("true") : F("false"));
+  json += F(",\"intervalUs\":");
+  json += String(ble.intervalUs);
+  json += F(",\"latency\":");
+  json += String((int)ble.latency);
+  json += F(",\"timeoutMs\":");
+  json += String((int)ble.timeoutMs);
+  json += F(",\"lowPower\":");
+  json += (ble.lowPower ? F("true") : F("false"));
+  json += F(",\"notifySent\":");
+  json += String(ble.notifySent);
+  json += F(",\"notifyFailed\":");
+  json += String(ble.notifyFailed);
+  json += F(",\"congested\":");
+  json += (ble.congested ? F("true") : F("false"));
+  json += F(",\"congestEvents\":");
+  json += String(ble.congestEvents);
+  json += F(",\"paramUpdates\":");
+  json += String(ble.paramUpdates);
+  BleHostStats hosts;
+  bleHostsGetStats(hosts);
+  json += F(",\"hostSlot\":");
+  json += String((int)hosts.activeSlot + 1);
+  json += F(",\"hostsPaired\":");
+  json += String((int)hosts.usedMask);
+  json += F(",\"hostFilterOpen\":");
+  json += (hosts.open ? F("true") : F("false"));
+  json += F(",\"reconnectMs\":");
+  json += String(hosts.reconnectMs);
+  json += F(",\"reconnectMaxMs\":");
+  json += String(hosts.reconnectMaxMs);
+  json += F(",\"reconnects\":");
+  json += String(hosts.reconnects);
+  json += F(",\"hostSwitches\":");
+  json += String(hosts.switches);
+  json += '}';
+
   // Hall sensors
   json += F(",\"hall\":[");
   for (size_t i = 0; i < ctx.hallCount; i++) {
@@ -135,8 +319,10 @@ static void writeDiagJson(WebServer& server, const DiagnosticsContext& ctx) {
       continue;
     }
 
-    const uint32_t raw = (uint32_t)h->rawRead();
+    h->latch(snap);
     const bool pressed = (h->checkTrig(0) != 0);
+    const uint32_t raw = (uint32_t)h->currentVal;
+    h->unlatch();
 
     json += '{';
     json += F("\"idx\":");
@@ -147,6 +333,9 @@ static void writeDiagJson(WebServer& server, const DiagnosticsContext& ctx) {
     json += String((int)h->adcCh);
     json += F(",\"raw\":");
     json += String((int)raw);
+    json += F(",\"unfiltered\":");
+    json += String((int)((h->adcSel >= 1 && h->adcSel <= (int)SENSOR_ADC_COUNT && h->adcCh >= 0 && h->adcCh < (int)SENSOR_ADC_CHANNELS)
+                         ? snap.hallUnfiltered[h->adcSel - 1][h->adcCh] : 0));
     json += F(",\"min\":");
     json += String((int)h->getMin());
     json += F(",\"max\":");
@@ -188,6 +377,11 @@ void diagnosticsWebRegisterRoutes(WebServer& server, const DiagnosticsContext& c
     writeDiagJson(server, ctx);
   });
 
+  // Serialized vs interleaved frame rate on the real bus
+  server.on("/api/scanbench", HTTP_GET, [&server]() {
+    writeScanBenchJson(server);
+  });
+
   // LED controls
   server.on("/api/led/clear", HTTP_POST, [&server, ctx]() {
     const String strip = server.hasArg("strip") ? server.arg("strip") : "screen";
@@ -0,0 +1,100 @@
+#include "gamepad.h"
+
+#include "hid_usb.h"
+
+static constexpr uint32_t GAMEPAD_TASK_STACK = 2048;
+static constexpr UBaseType_t GAMEPAD_TASK_PRIORITY = 1;  // Same as the HID worker
+
+static QueueHandle_t g_mailbox = nullptr;  // Depth 1: newest report wins
+static TaskHandle_t g_gamepadTask = nullptr;
+static GamepadReport g_lastPosted;
+static bool g_havePosted = false;
+
+static volatile uint32_t g_posted = 0;
+static volatile uint32_t g_sent = 0;
+static volatile uint32_t g_failed = 0;
+static volatile uint16_t g_rateHz = 0;
+
+bool gamepadReportChanged(const GamepadReport& last, const GamepadReport& next, uint16_t deadband) {
+  if (last.buttons != next.buttons) {
+    return true;
+  }
+  for (size_t i = 0; i < GAMEPAD_AXES; i++) {
+    const uint16_t a = last.axes[i];
+    const uint16_t b = next.axes[i];
+    if (a == b) {
+      continue;
+    }
+    const uint16_t diff = (a > b) ? (uint16_t)(a - b) : (uint16_t)(b - a);
+    // Always land exactly on the ends, however small the last step.
+    if (diff > deadband || b == 0 || b == GAMEPAD_AXIS_MAX) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void gamepadTask(void* parameters) {
+  (void)parameters;
+  GamepadReport report;
+  uint32_t windowStartMs = millis();
+  uint32_t windowSent = 0;
+  for (;;) {
+    if (xQueueReceive(g_mailbox, &report, pdMS_TO_TICKS(1000)) == pdTRUE) {
+      // Blocks until the host has taken the previous report.
+      if (hidUsbSendGamepad(report)) {
+        g_sent = g_sent + 1;
+        windowSent++;
+      } else {
+        g_failed = g_failed + 1;
+      }
+    }
+    const uint32_t nowMs = millis();
+    if (nowMs - windowStartMs >= 1000) {
+      g_rateHz = (uint16_t)((windowSent > 0xFFFF) ? 0xFFFF : windowSent);
+      windowSent = 0;
+      windowStartMs = nowMs;
+    }
+  }
+}
+
+void gamepadOutputStart() {
+  if (g_gamepadTask != nullptr) {
+    return;
+  }
+  g_mailbox = xQueueCreate(1, sizeof(GamepadReport));
+  if (g_mailbox == nullptr) {
+    Serial.println(F("[hid] gamepad queue alloc failed"));
+    return;
+  }
+  xTaskCreatePinnedToCore(
+    gamepadTask,
+    "gamepad",
+    GAMEPAD_TASK_STACK,
+    NULL,
+    GAMEPAD_TASK_PRIORITY,
+    &g_gamepadTask,
+    ARDUINO_RUNNING_CORE
+  );
+}
+
+bool gamepadOutputPost(const GamepadReport& report) {
+  if (g_mailbox == nullptr) {
+    return false;
+  }
+  if (g_havePosted && !gamepadReportChanged(g_lastPosted, report, GAMEPAD_DEADBAND)) {
+    return false;
+  }
+  (void)xQueueOverwrite(g_mailbox, &report);
+  g_lastPosted = report;
+  g_havePosted = true;
+  g_posted = g_posted + 1;
+  return true;
+}
+
+void gamepadGetStats(GamepadStats& out) {
+  out.posted = g_posted;
+  out.sent = g_sent;
+  out.failed = g_failed;
+  out.rateHz = g_rateHz;
+}
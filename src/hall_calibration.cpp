@@ -0,0 +1,134 @@
+#include <Arduino.h>
+#include <Preferences.h>
+
+#include "hall_calibration.h"
+
+static constexpr const char* HALL_CAL_KEY = "hallCal";
+
+struct HallCalibrationRecord {
+  uint16_t version;
+  uint16_t keyCount;
+  uint16_t minVal[HALL_CAL_MAX_KEYS];
+  uint16_t maxVal[HALL_CAL_MAX_KEYS];  // min == max == 0: key not calibrated
+  uint16_t reserved[2];
+  uint32_t crc;  // CRC-32 of every field above
+};
+
+// Last record known to be in flash; used to skip redundant writes.
+static HallCalibrationRecord g_stored;
+static bool g_storedValid = false;
+
+static uint32_t crc32(const uint8_t* data, size_t len) {
+  uint32_t crc = 0xFFFFFFFFUL;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320UL & (0UL - (crc & 1UL)));
+    }
+  }
+  return ~crc;
+}
+
+static uint32_t recordCrc(const HallCalibrationRecord& rec) {
+  return crc32(reinterpret_cast<const uint8_t*>(&rec), offsetof(HallCalibrationRecord, crc));
+}
+
+static bool rangeUsable(uint16_t minVal, uint16_t maxVal) {
+  return (maxVal > minVal) && ((unsigned int)(maxVal - minVal) >= MxgicHall::MIN_CAL_SPAN);
+}
+
+// Returns the number of keys with a calibration in the record.
+static size_t buildRecord(HallCalibrationRecord& rec, MxgicHall** hall, size_t hallCount) {
+  memset(&rec, 0, sizeof(rec));
+  rec.version = HALL_CAL_VERSION;
+  rec.keyCount = (uint16_t)hallCount;
+  size_t calibratedCount = 0;
+  for (size_t i = 0; i < hallCount; i++) {
+    // Ranges that cali() only widened on noise are not worth keeping.
+    if (!hall[i]->isCalibrated()) {
+      continue;
+    }
+    rec.minVal[i] = (uint16_t)hall[i]->getMin();
+    rec.maxVal[i] = (uint16_t)hall[i]->getMax();
+    calibratedCount++;
+  }
+  rec.crc = recordCrc(rec);
+  return calibratedCount;
+}
+
+bool hallCalibrationLoadFromPrefs(const char* prefsNamespace, MxgicHall** hall, size_t hallCount) {
+  if (prefsNamespace == nullptr || hall == nullptr || hallCount == 0 || hallCount > HALL_CAL_MAX_KEYS) {
+    return false;
+  }
+
+  Preferences prefs;
+  if (!prefs.begin(prefsNamespace, false)) {
+    Serial.println(F("[cal] begin() failed; not loaded"));
+    return false;
+  }
+
+  HallCalibrationRecord rec;
+  const size_t got = prefs.getBytes(HALL_CAL_KEY, &rec, sizeof(rec));
+  prefs.end();
+
+  if (got != sizeof(rec)) {
+    Serial.println(F("[cal] no stored calibration"));
+    return false;
+  }
+  if (rec.version != HALL_CAL_VERSION || rec.keyCount != hallCount || rec.crc != recordCrc(rec)) {
+    Serial.println(F("[cal] stored calibration invalid; ignoring"));
+    return false;
+  }
+
+  g_stored = rec;
+  g_storedValid = true;
+
+  size_t loaded = 0;
+  for (size_t i = 0; i < hallCount; i++) {
+    if (!rangeUsable(rec.minVal[i], rec.maxVal[i])) {
+      Serial.print(F("[cal] btn"));
+      Serial.print((int)i);
+      Serial.println(F(" not calibrated"));
+      continue;
+    }
+    hall[i]->setCalibration(rec.minVal[i], rec.maxVal[i]);
+    loaded++;
+  }
+
+  Serial.print(F("[cal] loaded calibration for "));
+  Serial.print((int)loaded);
+  Serial.println(F(" keys"));
+  return loaded > 0;
+}
+
+bool hallCalibrationSaveIfChanged(const char* prefsNamespace, MxgicHall** hall, size_t hallCount) {
+  if (prefsNamespace == nullptr || hall == nullptr || hallCount == 0 || hallCount > HALL_CAL_MAX_KEYS) {
+    return false;
+  }
+
+  HallCalibrationRecord rec;
+  if (buildRecord(rec, hall, hallCount) == 0) {
+    return false;
+  }
+  if (g_storedValid && memcmp(&rec, &g_stored, sizeof(rec)) == 0) {
+    return false;
+  }
+
+  Preferences prefs;
+  if (!prefs.begin(prefsNamespace, false)) {
+    Serial.println(F("[cal] begin() failed; not saved"));
+    return false;
+  }
+  const size_t put = prefs.putBytes(HALL_CAL_KEY, &rec, sizeof(rec));
+  prefs.end();
+
+  if (put != sizeof(rec)) {
+    Serial.println(F("[cal] write failed"));
+    return false;
+  }
+
+  g_stored = rec;
+  g_storedValid = true;
+  Serial.println(F("[cal] saved calibration"));
+  return true;
+}
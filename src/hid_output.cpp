@@ -0,0 +1,184 @@
+#include "hid_output.h"
+
+#include "hid_report.h"
+#include "hid_typing.h"
+#include "macro_engine.h"
+#include "hid_transport.h"
+#include "ble_link.h"
+#include "ble_hosts.h"
+
+static constexpr uint32_t HID_TASK_STACK = 4096;
+static constexpr UBaseType_t HID_TASK_PRIORITY = 1;  // Below infiniteScan (2)
+static constexpr uint32_t LINK_SERVICE_MS = 1000;
+
+enum class HidEventType : uint8_t {
+  Report = 0,
+  Text = 1,
+  Macro = 2,
+};
+
+struct HidEvent {
+  HidEventType type;
+  KeyReport report;
+  const char* text;
+  uint16_t length;
+  const ActionProgram* program;
+};
+
+static QueueHandle_t g_queue = nullptr;
+static TaskHandle_t g_hidTask = nullptr;
+
+static volatile uint32_t g_queued = 0;
+static volatile uint32_t g_sent = 0;
+static volatile uint32_t g_reportRetries = 0;
+static volatile uint32_t g_textDropped = 0;
+static volatile uint32_t g_macrosDropped = 0;
+static volatile uint8_t g_macrosRunning = 0;
+static volatile uint8_t g_highWater = 0;
+static volatile uint32_t g_typedChars = 0;
+static volatile uint32_t g_typeCps = 0;
+
+static void noteDepth() {
+  const uint8_t depth = (uint8_t)uxQueueMessagesWaiting(g_queue);
+  if (depth > g_highWater) {
+    g_highWater = depth;
+  }
+}
+
+// Types text over the held keys; the caller restores them afterwards.
+static void typeText(HidSink& sink, const char* text, size_t length, const KeyReport& held) {
+  const uint32_t startMs = millis();
+  const size_t typed = hidTypeText(sink, text, length, held);
+  const uint32_t elapsedMs = millis() - startMs;
+  g_typedChars = g_typedChars + typed;
+  if (typed > 0) {
+    g_typeCps = (uint32_t)((uint64_t)typed * 1000ULL / ((elapsedMs > 0) ? elapsedMs : 1));
+  }
+}
+
+static void hidOutputTask(void* parameters) {
+  (void)parameters;
+  HidSink& sink = hidTransportSink();
+  MacroEngine engine;
+  uint32_t sleepMs = MacroEngine::IDLE;
+  HidEvent ev;
+  for (;;) {
+    // Wake at least every LINK_SERVICE_MS so the link can drop to low power.
+    const uint32_t waitMs = (sleepMs < LINK_SERVICE_MS) ? sleepMs : LINK_SERVICE_MS;
+    const bool gotEvent = (xQueueReceive(g_queue, &ev, pdMS_TO_TICKS(waitMs)) == pdTRUE);
+    bleLinkService(millis(), gotEvent || engine.runningCount() > 0);
+    bleHostsService(millis());
+    if (hidTransportUpdate()) {
+      // New host hasn't seen the held keys yet.
+      engine.invalidate();
+    }
+    if (gotEvent) {
+      if (ev.type == HidEventType::Report) {
+        engine.setBaseReport(ev.report);
+      } else if (ev.type == HidEventType::Macro) {
+        if (!engine.start(ev.program, millis())) {
+          g_macrosDropped = g_macrosDropped + 1;
+        }
+      } else {
+        typeText(sink, ev.text, ev.length, engine.currentReport());
+        // Typing sends its own reports; restore held keys.
+        engine.invalidate();
+      }
+      g_sent = g_sent + 1;
+    }
+
+    sleepMs = engine.run(millis(), sink);
+    g_macrosRunning = (uint8_t)engine.runningCount();
+  }
+}
+
+void hidOutputStart(BleKeyboard& keyboard) {
+  if (g_hidTask != nullptr) {
+    return;
+  }
+  hidTransportBegin(keyboard);
+  g_queue = xQueueCreate(HID_OUTPUT_QUEUE_DEPTH, sizeof(HidEvent));
+  if (g_queue == nullptr) {
+    Serial.println(F("[hid] queue alloc failed"));
+    return;
+  }
+  xTaskCreatePinnedToCore(
+    hidOutputTask,
+    "hidOutput",
+    HID_TASK_STACK,
+    NULL,
+    HID_TASK_PRIORITY,
+    &g_hidTask,
+    ARDUINO_RUNNING_CORE
+  );
+}
+
+bool hidOutputQueueReport(const KeyReport& report) {
+  if (g_queue == nullptr) {
+    return false;
+  }
+  HidEvent ev;
+  ev.type = HidEventType::Report;
+  ev.report = report;
+  ev.text = nullptr;
+  ev.length = 0;
+  ev.program = nullptr;
+  if (xQueueSend(g_queue, &ev, 0) != pdTRUE) {
+    g_reportRetries = g_reportRetries + 1;
+    return false;
+  }
+  g_queued = g_queued + 1;
+  noteDepth();
+  return true;
+}
+
+bool hidOutputQueueText(const char* text, size_t length) {
+  if (g_queue == nullptr || text == nullptr || length == 0) {
+    return false;
+  }
+  HidEvent ev;
+  ev.type = HidEventType::Text;
+  hidReportClear(ev.report);
+  ev.text = text;
+  ev.length = (uint16_t)((length > 0xFFFF) ? 0xFFFF : length);
+  ev.program = nullptr;
+  if (xQueueSend(g_queue, &ev, 0) != pdTRUE) {
+    g_textDropped = g_textDropped + 1;
+    return false;
+  }
+  g_queued = g_queued + 1;
+  noteDepth();
+  return true;
+}
+
+bool hidOutputQueueMacro(const ActionProgram* program) {
+  if (g_queue == nullptr || program == nullptr) {
+    return false;
+  }
+  HidEvent ev;
+  ev.type = HidEventType::Macro;
+  hidReportClear(ev.report);
+  ev.text = nullptr;
+  ev.length = 0;
+  ev.program = program;
+  if (xQueueSend(g_queue, &ev, 0) != pdTRUE) {
+    g_macrosDropped = g_macrosDropped + 1;
+    return false;
+  }
+  g_queued = g_queued + 1;
+  noteDepth();
+  return true;
+}
+
+void hidOutputGetStats(HidOutputStats& out) {
+  out.queued = g_queued;
+  out.sent = g_sent;
+  out.reportRetries = g_reportRetries;
+  out.textDropped = g_textDropped;
+  out.macrosDropped = g_macrosDropped;
+  out.macrosRunning = g_macrosRunning;
+  out.depth = (g_queue != nullptr) ? (uint8_t)uxQueueMessagesWaiting(g_queue) : 0;
+  out.highWater = g_highWater;
+  out.typedChars = g_typedChars;
+  out.typeCps = g_typeCps;
+}
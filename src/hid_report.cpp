@@ -0,0 +1,168 @@
+#include "hid_report.h"
+
+static constexpr uint8_t MODIFIER_FIRST = 0x80;  // KEY_LEFT_CTRL
+static constexpr uint8_t RAW_KEY_OFFSET = 136;   // KEY_* codes >= 136 are usage + 136
+
+// US layout: ASCII -> HID usage ID, HID_ASCII_SHIFT set when Shift is needed.
+static constexpr uint8_t HID_ASCII_SHIFT = 0x80;
+static const uint8_t kAsciiToUsage[128] = {
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // 0x00
+  0x2A, 0x2B, 0x28, 0x00, 0x00, 0x00, 0x00, 0x00,  // 0x08 \b \t \n
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // 0x10
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // 0x18
+  0x2C, 0x9E, 0xB4, 0xA0, 0xA1, 0xA2, 0xA4, 0x34,  // 0x20  !"#$%&'
+  0xA6, 0xA7, 0xA5, 0xAE, 0x36, 0x2D, 0x37, 0x38,  // 0x28 ()*+,-./
+  0x27, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24,  // 0x30 01234567
+  0x25, 0x26, 0xB3, 0x33, 0xB6, 0x2E, 0xB7, 0xB8,  // 0x38 89:;<=>?
+  0x9F, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8A,  // 0x40 @ABCDEFG
+  0x8B, 0x8C, 0x8D, 0x8E, 0x8F, 0x90, 0x91, 0x92,  // 0x48 HIJKLMNO
+  0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A,  // 0x50 PQRSTUVW
+  0x9B, 0x9C, 0x9D, 0x2F, 0x31, 0x30, 0xA3, 0xAD,  // 0x58 XYZ[\]^_
+  0x35, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A,  // 0x60 `abcdefg
+  0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10, 0x11, 0x12,  // 0x68 hijklmno
+  0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A,  // 0x70 pqrstuvw
+  0x1B, 0x1C, 0x1D, 0xAF, 0xB1, 0xB0, 0xB5, 0x00,  // 0x78 xyz{|}~
+};
+
+// ASCII -> HID usage (0 if not typeable), `shift` set when Shift is needed.
+static uint8_t usageForAscii(char c, bool& shift) {
+  const uint8_t code = ((uint8_t)c < 128) ? kAsciiToUsage[(uint8_t)c] : 0;
+  shift = (code & HID_ASCII_SHIFT) != 0;
+  return (uint8_t)(code & ~HID_ASCII_SHIFT);
+}
+
+bool hidUsageForAscii(char c, uint8_t& usage, bool& shift) {
+  usage = usageForAscii(c, shift);
+  return usage != 0;
+}
+
+uint8_t hidKeyCodeForToken(const String& tokenUpper) {
+  if (tokenUpper.length() == 0) {
+    return 0;
+  }
+
+  if (tokenUpper == F("CTRL") || tokenUpper == F("CONTROL")) return KEY_LEFT_CTRL;
+  if (tokenUpper == F("SHIFT")) return KEY_LEFT_SHIFT;
+  if (tokenUpper == F("ALT")) return KEY_LEFT_ALT;
+  if (tokenUpper == F("GUI") || tokenUpper == F("WIN") || tokenUpper == F("CMD")) return KEY_LEFT_GUI;
+
+  if (tokenUpper == F("ENTER") || tokenUpper == F("RETURN")) return KEY_RETURN;
+  if (tokenUpper == F("TAB")) return KEY_TAB;
+  if (tokenUpper == F("ESC") || tokenUpper == F("ESCAPE")) return KEY_ESC;
+  if (tokenUpper == F("BACKSPACE") || tokenUpper == F("BKSP")) return KEY_BACKSPACE;
+  if (tokenUpper == F("DELETE") || tokenUpper == F("DEL")) return KEY_DELETE;
+  if (tokenUpper == F("SPACE")) return ' ';
+
+  if (tokenUpper == F("UP")) return KEY_UP_ARROW;
+  if (tokenUpper == F("DOWN")) return KEY_DOWN_ARROW;
+  if (tokenUpper == F("LEFT")) return KEY_LEFT_ARROW;
+  if (tokenUpper == F("RIGHT")) return KEY_RIGHT_ARROW;
+
+  if (tokenUpper == F("NUM_MINUS")) return KEY_NUM_MINUS;
+  if (tokenUpper == F("NUM_PLUS")) return KEY_NUM_PLUS;
+  if (tokenUpper == F("NUM_ENTER")) return KEY_NUM_ENTER;
+
+  // F1..F12 are consecutive codes.
+  if (tokenUpper.length() >= 2 && tokenUpper.length() <= 3 && tokenUpper[0] == 'F' && isDigit(tokenUpper[1])) {
+    const int fnum = tokenUpper.substring(1).toInt();
+    if ((tokenUpper.length() == 2 || isDigit(tokenUpper[2])) && fnum >= 1 && fnum <= 12) {
+      return (uint8_t)(KEY_F1 + (fnum - 1));
+    }
+    return 0;
+  }
+
+  if (tokenUpper.length() == 1) {
+    char c = tokenUpper[0];
+    if (c >= 'A' && c <= 'Z') {
+      c = (char)(c - 'A' + 'a');
+    }
+    bool shift = false;
+    return (usageForAscii(c, shift) != 0) ? (uint8_t)c : 0;
+  }
+
+  return 0;
+}
+
+void hidReportClear(KeyReport& report) {
+  memset(&report, 0, sizeof(KeyReport));
+}
+
+bool hidReportIsEmpty(const KeyReport& report) {
+  if (report.modifiers != 0) {
+    return false;
+  }
+  for (size_t i = 0; i < HID_REPORT_KEY_SLOTS; i++) {
+    if (report.keys[i] != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool hidReportEquals(const KeyReport& a, const KeyReport& b) {
+  return memcmp(&a, &b, sizeof(KeyReport)) == 0;
+}
+
+bool hidKeyToUsage(uint8_t key, uint8_t& modifierBits, uint8_t& usage) {
+  modifierBits = 0;
+  usage = 0;
+  if (key >= RAW_KEY_OFFSET) {
+    usage = (uint8_t)(key - RAW_KEY_OFFSET);
+    return true;
+  }
+  if (key >= MODIFIER_FIRST) {
+    modifierBits = (uint8_t)(1U << (key - MODIFIER_FIRST));
+    return true;
+  }
+  bool shift = false;
+  usage = usageForAscii((char)key, shift);
+  if (usage == 0) {
+    return false;
+  }
+  if (shift) {
+    modifierBits = 0x02;
+  }
+  return true;
+}
+
+bool hidReportAddUsage(KeyReport& report, uint8_t usage) {
+  for (size_t i = 0; i < HID_REPORT_KEY_SLOTS; i++) {
+    if (report.keys[i] == usage) {
+      return true;
+    }
+  }
+  for (size_t i = 0; i < HID_REPORT_KEY_SLOTS; i++) {
+    if (report.keys[i] == 0) {
+      report.keys[i] = usage;
+      return true;
+    }
+  }
+  return false;
+}
+
+void hidReportRemoveUsage(KeyReport& report, uint8_t usage) {
+  for (size_t i = 0; i < HID_REPORT_KEY_SLOTS; i++) {
+    if (report.keys[i] == usage) {
+      report.keys[i] = 0;
+    }
+  }
+}
+
+bool hidReportHasUsage(const KeyReport& report, uint8_t usage) {
+  for (size_t i = 0; i < HID_REPORT_KEY_SLOTS; i++) {
+    if (report.keys[i] == usage) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool hidReportAddKey(KeyReport& report, uint8_t key) {
+  uint8_t modifierBits = 0;
+  uint8_t usage = 0;
+  if (!hidKeyToUsage(key, modifierBits, usage)) {
+    return false;
+  }
+  report.modifiers |= modifierBits;
+  return (usage == 0) || hidReportAddUsage(report, usage);
+}
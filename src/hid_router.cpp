@@ -0,0 +1,49 @@
+#include "hid_router.h"
+
+HidSink* HidRouter::current() {
+  switch (route) {
+    case HidTransportKind::Usb: return &usb;
+    case HidTransportKind::Ble: return &ble;
+    default: return nullptr;
+  }
+}
+
+void HidRouter::sendReport(const KeyReport& report) {
+  HidSink* sink = current();
+  if (sink != nullptr) {
+    sink->sendReport(report);
+  }
+}
+
+bool HidRouter::isConnected() {
+  return current() != nullptr;
+}
+
+void HidRouter::waitSent(uint32_t timeoutMs) {
+  HidSink* sink = current();
+  if (sink != nullptr) {
+    sink->waitSent(timeoutMs);
+  }
+}
+
+bool HidRouter::update() {
+  HidTransportKind next = HidTransportKind::None;
+  if (usb.isConnected()) {
+    next = HidTransportKind::Usb;
+  } else if (ble.isConnected()) {
+    next = HidTransportKind::Ble;
+  }
+  if (next == route) {
+    return false;
+  }
+
+  // Don't leave keys stuck down on the host we're leaving.
+  HidSink* old = current();
+  if (old != nullptr && old->isConnected()) {
+    KeyReport empty;
+    hidReportClear(empty);
+    old->sendReport(empty);
+  }
+  route = next;
+  return true;
+}
@@ -0,0 +1,66 @@
+#include "hid_transport.h"
+
+#include "ble_link.h"
+#include "hid_usb.h"
+
+class BleHidSink : public HidSink {
+  public:
+    void sendReport(const KeyReport& report) override {
+      if (keyboard == nullptr) {
+        return;
+      }
+      KeyReport copy = report;
+      bleLinkArmNotify();
+      keyboard->sendReport(&copy);
+    }
+
+    bool isConnected() override {
+      return keyboard != nullptr && keyboard->isConnected();
+    }
+
+    void waitSent(uint32_t timeoutMs) override {
+      (void)bleLinkWaitNotifyDone(timeoutMs);
+    }
+
+    BleKeyboard* keyboard = nullptr;
+};
+
+class UsbHidSink : public HidSink {
+  public:
+    void sendReport(const KeyReport& report) override {
+      // USB sendReport already waits for the host to take the previous report.
+      (void)hidUsbSendReport(report.modifiers, report.keys);
+    }
+
+    bool isConnected() override {
+      return hidUsbMounted();
+    }
+};
+
+static BleHidSink g_ble;
+static UsbHidSink g_usb;
+static HidRouter g_sink(g_usb, g_ble);
+
+void hidTransportBegin(BleKeyboard& keyboard) {
+  g_ble.keyboard = &keyboard;
+  hidUsbBegin();
+  (void)hidTransportUpdate();
+}
+
+HidSink& hidTransportSink() {
+  return g_sink;
+}
+
+bool hidTransportUpdate() {
+  if (!g_sink.update()) {
+    return false;
+  }
+  const HidTransportKind next = g_sink.active();
+  Serial.print(F("[hid] transport="));
+  Serial.println((next == HidTransportKind::Usb) ? F("usb") : (next == HidTransportKind::Ble) ? F("ble") : F("none"));
+  return true;
+}
+
+HidTransportKind hidTransportActive() {
+  return g_sink.active();
+}
@@ -0,0 +1,128 @@
+#include "hid_typing.h"
+
+// Distinct keys packed into one report while typing. Hosts register keys in
+// report order; drop this to 1 for a host that doesn't.
+static constexpr size_t TYPE_KEYS_PER_REPORT = HID_REPORT_KEY_SLOTS;
+
+static void sendPaced(HidSink& sink, const KeyReport& report) {
+  sink.sendReport(report);
+  sink.waitSent(HID_TYPE_NOTIFY_TIMEOUT_MS);
+}
+
+static bool reportsShareKey(const KeyReport& a, const KeyReport& b) {
+  for (size_t i = 0; i < HID_REPORT_KEY_SLOTS; i++) {
+    for (size_t k = 0; a.keys[i] != 0 && k < HID_REPORT_KEY_SLOTS; k++) {
+      if (a.keys[i] == b.keys[k]) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+static size_t usageCount(const KeyReport& report) {
+  size_t count = 0;
+  for (size_t i = 0; i < HID_REPORT_KEY_SLOTS; i++) {
+    count += (report.keys[i] != 0) ? 1 : 0;
+  }
+  return count;
+}
+
+// Held usages the text never types. They stay down in every typed report so
+// the host sees no release and re-press of them. Held modifiers are not kept:
+// they would change what the text types.
+static KeyReport keptUsages(const char* text, size_t length, const KeyReport& held) {
+  KeyReport keep;
+  hidReportClear(keep);
+  for (size_t i = 0; i < HID_REPORT_KEY_SLOTS; i++) {
+    const uint8_t usage = held.keys[i];
+    bool typed = false;
+    for (size_t idx = 0; usage != 0 && !typed && idx < length; idx++) {
+      uint8_t textUsage = 0;
+      bool shift = false;
+      typed = hidUsageForAscii(text[idx], textUsage, shift) && textUsage == usage;
+    }
+    if (usage != 0 && !typed) {
+      (void)hidReportAddUsage(keep, usage);
+    }
+  }
+  return keep;
+}
+
+// Typed keys plus the kept held usages, as the host should see them.
+static KeyReport withKept(const KeyReport& chunk, const KeyReport& keep) {
+  KeyReport report = chunk;
+  for (size_t i = 0; i < HID_REPORT_KEY_SLOTS; i++) {
+    if (keep.keys[i] != 0) {
+      (void)hidReportAddUsage(report, keep.keys[i]);
+    }
+  }
+  return report;
+}
+
+// A release report is only needed between chunks that share a key or change
+// shift, so typical text costs ~1 report per 6 chars. The held report counts
+// as the chunk before the first one. "Release" leaves the kept held usages
+// down.
+size_t hidTypeText(HidSink& sink, const char* text, size_t length, const KeyReport& held) {
+  if (!sink.isConnected()) {
+    return 0;
+  }
+
+  KeyReport keep = keptUsages(text, length, held);
+  size_t perReport = HID_REPORT_KEY_SLOTS - usageCount(keep);
+  if (perReport > TYPE_KEYS_PER_REPORT) {
+    perReport = TYPE_KEYS_PER_REPORT;
+  }
+  if (perReport == 0) {
+    // Held keys fill every slot; they have to go up while typing.
+    hidReportClear(keep);
+    perReport = TYPE_KEYS_PER_REPORT;
+  }
+
+  KeyReport chunk;
+  KeyReport prev = held;
+  hidReportClear(chunk);
+  size_t inChunk = 0;
+  size_t typed = 0;
+
+  for (size_t idx = 0; idx <= length; idx++) {
+    uint8_t usage = 0;
+    bool shift = false;
+    const bool last = (idx == length);
+    if (!last && !hidUsageForAscii(text[idx], usage, shift)) {
+      continue;
+    }
+
+    const uint8_t modifiers = shift ? 0x02 : 0x00;
+    bool inReport = false;
+    for (size_t k = 0; k < HID_REPORT_KEY_SLOTS; k++) {
+      inReport |= (chunk.keys[k] == usage);
+    }
+    const bool flush = (inChunk > 0) &&
+                       (last || modifiers != chunk.modifiers || inReport || inChunk >= perReport);
+    if (flush) {
+      if (!hidReportIsEmpty(prev) && (prev.modifiers != chunk.modifiers || reportsShareKey(chunk, prev))) {
+        sendPaced(sink, keep);
+      }
+      sendPaced(sink, withKept(chunk, keep));
+      prev = chunk;
+      typed += inChunk;
+      hidReportClear(chunk);
+      inChunk = 0;
+    }
+    if (last) {
+      break;
+    }
+
+    if (inChunk == 0) {
+      chunk.modifiers = modifiers;
+    }
+    (void)hidReportAddUsage(chunk, usage);
+    inChunk++;
+  }
+  if (typed > 0) {
+    sendPaced(sink, keep);
+  }
+  return typed;
+}
@@ -0,0 +1,143 @@
+#include "hid_usb.h"
+
+#if defined(ARDUINO_USB_MODE) && (ARDUINO_USB_MODE == 0)
+
+#include <USB.h>
+#include <USBHID.h>
+#include <USBHIDKeyboard.h>
+
+// 7 absolute 12-bit axes (keys on X..Rz, knob on Slider) and 6 buttons.
+static const uint8_t GAMEPAD_REPORT_DESCRIPTOR[] = {
+  HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),
+  HID_USAGE(HID_USAGE_DESKTOP_GAMEPAD),
+  HID_COLLECTION(HID_COLLECTION_APPLICATION),
+    HID_REPORT_ID(HID_REPORT_ID_GAMEPAD)
+    HID_USAGE(HID_USAGE_DESKTOP_X),
+    HID_USAGE(HID_USAGE_DESKTOP_Y),
+    HID_USAGE(HID_USAGE_DESKTOP_Z),
+    HID_USAGE(HID_USAGE_DESKTOP_RX),
+    HID_USAGE(HID_USAGE_DESKTOP_RY),
+    HID_USAGE(HID_USAGE_DESKTOP_RZ),
+    HID_USAGE(HID_USAGE_DESKTOP_SLIDER),
+    HID_LOGICAL_MIN(0),
+    HID_LOGICAL_MAX_N(GAMEPAD_AXIS_MAX, 2),
+    HID_REPORT_SIZE(16),
+    HID_REPORT_COUNT(GAMEPAD_AXES),
+    HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+    HID_USAGE_PAGE(HID_USAGE_PAGE_BUTTON),
+    HID_USAGE_MIN(1),
+    HID_USAGE_MAX(GAMEPAD_KEY_AXES),
+    HID_LOGICAL_MIN(0),
+    HID_LOGICAL_MAX(1),
+    HID_REPORT_SIZE(1),
+    HID_REPORT_COUNT(GAMEPAD_KEY_AXES),
+    HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+    HID_REPORT_SIZE(8 - GAMEPAD_KEY_AXES),
+    HID_REPORT_COUNT(1),
+    HID_INPUT(HID_CONSTANT),
+  HID_COLLECTION_END,
+};
+
+struct __attribute__((packed)) UsbGamepadReport {
+  uint16_t axes[GAMEPAD_AXES];
+  uint8_t buttons;
+};
+
+class UsbGamepad : public USBHIDDevice {
+  public:
+    UsbGamepad() {
+      USBHID::addDevice(this, sizeof(GAMEPAD_REPORT_DESCRIPTOR));
+    }
+
+    uint16_t _onGetDescriptor(uint8_t* buffer) override {
+      memcpy(buffer, GAMEPAD_REPORT_DESCRIPTOR, sizeof(GAMEPAD_REPORT_DESCRIPTOR));
+      return sizeof(GAMEPAD_REPORT_DESCRIPTOR);
+    }
+
+    bool send(const GamepadReport& report) {
+      UsbGamepadReport out;
+      memcpy(out.axes, report.axes, sizeof(out.axes));
+      out.buttons = report.buttons;
+      return hid.SendReport(HID_REPORT_ID_GAMEPAD, &out, sizeof(out));
+    }
+
+    USBHID hid;
+};
+
+// Must be globals: HID devices register with the USB stack when constructed,
+// before the descriptor is built.
+static USBHIDKeyboard g_usbKeyboard;
+static UsbGamepad g_usbGamepad;
+static volatile bool g_mounted = false;
+
+static void onUsbEvent(void* arg, esp_event_base_t base, int32_t id, void* data) {
+  (void)arg;
+  (void)data;
+  if (base != ARDUINO_USB_EVENTS) {
+    return;
+  }
+  switch (id) {
+    case ARDUINO_USB_STARTED_EVENT:
+    case ARDUINO_USB_RESUME_EVENT:
+      g_mounted = true;
+      break;
+    case ARDUINO_USB_STOPPED_EVENT:
+    case ARDUINO_USB_SUSPEND_EVENT:
+      g_mounted = false;
+      break;
+    default:
+      break;
+  }
+}
+
+void hidUsbBegin() {
+  USB.onEvent(onUsbEvent);
+  g_usbKeyboard.begin();
+  g_usbGamepad.hid.begin();
+  USB.begin();
+}
+
+bool hidUsbMounted() {
+  return g_mounted;
+}
+
+bool hidUsbSendReport(uint8_t modifiers, const uint8_t keys[6]) {
+  if (!g_mounted) {
+    return false;
+  }
+  KeyReport report;
+  report.modifiers = modifiers;
+  report.reserved = 0;
+  memcpy(report.keys, keys, sizeof(report.keys));
+  g_usbKeyboard.sendReport(&report);
+  return true;
+}
+
+bool hidUsbSendGamepad(const GamepadReport& report) {
+  if (!g_mounted) {
+    return false;
+  }
+  return g_usbGamepad.send(report);
+}
+
+#else
+
+void hidUsbBegin() {
+}
+
+bool hidUsbMounted() {
+  return false;
+}
+
+bool hidUsbSendReport(uint8_t modifiers, const uint8_t keys[6]) {
+  (void)modifiers;
+  (void)keys;
+  return false;
+}
+
+bool hidUsbSendGamepad(const GamepadReport& report) {
+  (void)report;
+  return false;
+}
+
+#endif
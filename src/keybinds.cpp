@@ -2,6 +2,10 @@
 #include <Preferences.h>
 
 #include "keybinds.h"
+#include "actions.h"
+#include "tap_hold.h"
+#include "combo.h"
+#include "socd.h"
 #include "mysecret.h"
 
 static String defaultActionForButton(size_t idx) {
@@ -16,8 +20,66 @@ static String defaultActionForButton(size_t idx) {
   }
 }
 
-String keybindsKeyForButton(size_t idx) {
-  return String("btn") + String((int)idx);
+String keybindsKeyForButton(size_t idx, size_t layer) {
+  if (layer == 0) {
+    return String("btn") + String((int)idx);
+  }
+  return String("l") + String((int)layer) + String("btn") + String((int)idx);
+}
+
+String keybindsKeyForHold(size_t idx, size_t layer) {
+  if (layer == 0) {
+    return String("hold") + String((int)idx);
+  }
+  return String("l") + String((int)layer) + String("hold") + String((int)idx);
+}
+
+String keybindsKeyForTapHoldMode(size_t idx) {
+  return String("thm") + String((int)idx);
+}
+
+String keybindsKeyForTapHoldTerm(size_t idx) {
+  return String("tht") + String((int)idx);
+}
+
+String keybindsKeyForComboKeys(size_t idx) {
+  return String("cbk") + String((int)idx);
+}
+
+String keybindsKeyForComboAction(size_t idx) {
+  return String("cba") + String((int)idx);
+}
+
+String keybindsKeyForComboWindow(size_t idx) {
+  return String("cbw") + String((int)idx);
+}
+
+String keybindsKeyForSocdKeys(size_t idx) {
+  return String("socdk") + String((int)idx);
+}
+
+String keybindsKeyForSocdPolicy(size_t idx) {
+  return String("socdm") + String((int)idx);
+}
+
+String keybindsKeyForRapidTrigger(size_t idx) {
+  return String("rt") + String((int)idx);
+}
+
+String keybindsKeyForActuationPress(size_t idx) {
+  return String("ap") + String((int)idx);
+}
+
+String keybindsKeyForActuationRelease(size_t idx) {
+  return String("ar") + String((int)idx);
+}
+
+String keybindsKeyForDepthAction(size_t idx, size_t point) {
+  return String("d") + String((int)point + 2) + String("a") + String((int)idx);
+}
+
+String keybindsKeyForDepthPercent(size_t idx, size_t point) {
+  return String("d") + String((int)point + 2) + String("p") + String((int)idx);
 }
 
 static const char* keybindsKeyForMeterStyle() {
@@ -101,7 +163,613 @@ void keybindsSaveLedBrightnessToPrefs(const char* prefsNamespace, uint8_t bright
   Serial.println((int)b);
 }
 
-void keybindsLoadFromPrefs(const char* prefsNamespace, String* actions, size_t actionCount) {
+static uint8_t clampHallFilterMode(int value) {
+  if (value < 0 || value > 3) return 3;
+  return (uint8_t)value;
+}
+
+static uint8_t clampHallFilterStrength(int value) {
+  if (value < 1) return 1;
+  if (value > 4) return 4;
+  return (uint8_t)value;
+}
+
+void keybindsLoadHallFilterFromPrefs(const char* prefsNamespace, uint8_t& mode, uint8_t& strength) {
+  mode = 3;
+  strength = 2;
+
+  Preferences prefs;
+  if (!prefs.begin(prefsNamespace, false)) {
+    Serial.println(F("[prefs] begin() failed; hallFilter=3/2"));
+    return;
+  }
+
+  // Missing keys keep the defaults; nothing to initialize.
+  mode = clampHallFilterMode((int)prefs.getUChar("hallFilter", mode));
+  strength = clampHallFilterStrength((int)prefs.getUChar("hallFilterK", strength));
+  prefs.end();
+}
+
+void keybindsSaveHallFilterToPrefs(const char* prefsNamespace, uint8_t mode, uint8_t strength) {
+  Preferences prefs;
+  if (!prefs.begin(prefsNamespace, false)) {
+    Serial.println(F("[prefs] begin() failed; hallFilter not saved"));
+    return;
+  }
+
+  mode = clampHallFilterMode((int)mode);
+  strength = clampHallFilterStrength((int)strength);
+  prefs.putUChar("hallFilter", mode);
+  prefs.putUChar("hallFilterK", strength);
+  prefs.end();
+  Serial.print(F("[prefs] saved hallFilter="));
+  Serial.print((int)mode);
+  Serial.print('/');
+  Serial.println((int)strength);
+}
+
+static uint8_t clampRapidTrigger(int value) {
+  if (value < 0) return 0;
+  if (value > 50) return 50;
+  return (uint8_t)value;
+}
+
+void keybindsLoadRapidTriggerFromPrefs(const char* prefsNamespace, uint8_t* percents, size_t count) {
+  if (percents == nullptr || count == 0) {
+    return;
+  }
+  for (size_t i = 0; i < count; i++) {
+    percents[i] = 0;
+  }
+
+  Preferences prefs;
+  if (!prefs.begin(prefsNamespace, false)) {
+    Serial.println(F("[prefs] begin() failed; rapid trigger off"));
+    return;
+  }
+
+  // Missing keys simply mean "off"; nothing to initialize.
+  for (size_t i = 0; i < count; i++) {
+    const String key = keybindsKeyForRapidTrigger(i);
+    percents[i] = clampRapidTrigger((int)prefs.getUChar(key.c_str(), 0));
+  }
+  prefs.end();
+}
+
+void keybindsSaveRapidTriggerToPrefs(const char* prefsNamespace, const uint8_t* percents, size_t count) {
+  if (percents == nullptr || count == 0) {
+    return;
+  }
+
+  Preferences prefs;
+  if (!prefs.begin(prefsNamespace, false)) {
+    Serial.println(F("[prefs] begin() failed; rapid trigger not saved"));
+    return;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    const String key = keybindsKeyForRapidTrigger(i);
+    prefs.putUChar(key.c_str(), clampRapidTrigger((int)percents[i]));
+  }
+  prefs.end();
+  Serial.println(F("[prefs] saved rapid trigger"));
+}
+
+static uint8_t clampActuationPress(int value) {
+  if (value <= 0) return 0;
+  if (value < (int)KEY_ACTUATION_MIN_PERCENT) return KEY_ACTUATION_MIN_PERCENT;
+  if (value > (int)KEY_ACTUATION_MAX_PERCENT) return KEY_ACTUATION_MAX_PERCENT;
+  return (uint8_t)value;
+}
+
+static uint8_t clampActuationRelease(int value, uint8_t press) {
+  if (press == 0) return 0;
+  if (value < 1 || value >= (int)press) return (press > 10) ? (uint8_t)(press - 10) : 1;
+  return (uint8_t)value;
+}
+
+void keybindsLoadActuationFromPrefs(const char* prefsNamespace, uint8_t* pressPercents, uint8_t* releasePercents, size_t count) {
+  if (pressPercents == nullptr || releasePercents == nullptr || count == 0) {
+    return;
+  }
+  for (size_t i = 0; i < count; i++) {
+    pressPercents[i] = 0;
+    releasePercents[i] = 0;
+  }
+
+  Preferences prefs;
+  if (!prefs.begin(prefsNamespace, false)) {
+    Serial.println(F("[prefs] begin() failed; fixed actuation"));
+    return;
+  }
+
+  // Missing keys mean "fixed threshold"; nothing to initialize.
+  for (size_t i = 0; i < count; i++) {
+    pressPercents[i] = clampActuationPress((int)prefs.getUChar(keybindsKeyForActuationPress(i).c_str(), 0));
+    releasePercents[i] = clampActuationRelease((int)prefs.getUChar(keybindsKeyForActuationRelease(i).c_str(), 0), pressPercents[i]);
+  }
+  prefs.end();
+}
+
+void keybindsSaveActuationToPrefs(const char* prefsNamespace, const uint8_t* pressPercents, const uint8_t* releasePercents, size_t count) {
+  if (pressPercents == nullptr || releasePercents == nullptr || count == 0) {
+    return;
+  }
+
+  Preferences prefs;
+  if (!prefs.begin(prefsNamespace, false)) {
+    Serial.println(F("[prefs] begin() failed; actuation not saved"));
+    return;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    const uint8_t press = clampActuationPress((int)pressPercents[i]);
+    prefs.putUChar(keybindsKeyForActuationPress(i).c_str(), press);
+    prefs.putUChar(keybindsKeyForActuationRelease(i).c_str(), clampActuationRelease((int)releasePercents[i], press));
+  }
+  prefs.end();
+  Serial.println(F("[prefs] saved actuation points"));
+}
+
+static uint8_t defaultDepthPercent(size_t point) {
+  return (point == 0) ? 70 : 95;
+}
+
+static uint8_t clampDepthPercent(int value, size_t point) {
+  if (value < (int)KEY_DEPTH_PERCENT_MIN || value > (int)KEY_DEPTH_PERCENT_MAX) return defaultDepthPercent(point);
+  return (uint8_t)value;
+}
+
+void keybindsLoadDepthFromPrefs(const char* prefsNamespace, String* actions, uint8_t* percents, size_t count, ActionProgram* compiled) {
+  if (actions == nullptr || percents == nullptr || count == 0) {
+    return;
+  }
+  for (size_t point = 0; point < KEY_DEPTH_POINTS; point++) {
+    for (size_t i = 0; i < count; i++) {
+      actions[point * count + i] = String();
+      percents[point * count + i] = defaultDepthPercent(point);
+    }
+  }
+
+  Preferences prefs;
+  if (!prefs.begin(prefsNamespace, false)) {
+    Serial.println(F("[prefs] begin() failed; no depth actions"));
+    return;
+  }
+
+  // Missing keys mean "single actuation point"; nothing to initialize.
+  for (size_t point = 0; point < KEY_DEPTH_POINTS; point++) {
+    for (size_t i = 0; i < count; i++) {
+      const size_t slot = point * count + i;
+      actions[slot] = prefs.getString(keybindsKeyForDepthAction(i, point).c_str(), "");
+      percents[slot] = clampDepthPercent((int)prefs.getUChar(keybindsKeyForDepthPercent(i, point).c_str(), defaultDepthPercent(point)), point);
+    }
+  }
+  prefs.end();
+
+  for (size_t point = 0; point < KEY_DEPTH_POINTS; point++) {
+    for (size_t i = 0; i < count; i++) {
+      const size_t slot = point * count + i;
+      if (actions[slot].length() == 0) {
+        continue;
+      }
+      Serial.print(F("[prefs] "));
+      Serial.print(keybindsKeyForDepthAction(i, point));
+      Serial.print(F("@"));
+      Serial.print((int)percents[slot]);
+      Serial.print(F("%="));
+      Serial.println(actions[slot]);
+      if (compiled != nullptr) {
+        String error;
+        if (!actionCompile(actions[slot], compiled[slot], error)) {
+          Serial.print(F("[prefs] "));
+          Serial.print(keybindsKeyForDepthAction(i, point));
+          Serial.print(F(": "));
+          Serial.println(error);
+        }
+      }
+    }
+  }
+}
+
+void keybindsSaveDepthToPrefs(const char* prefsNamespace, const String* actions, const uint8_t* percents, size_t count) {
+  if (actions == nullptr || percents == nullptr || count == 0) {
+    return;
+  }
+
+  Preferences prefs;
+  if (!prefs.begin(prefsNamespace, false)) {
+    Serial.println(F("[prefs] begin() failed; depth actions not saved"));
+    return;
+  }
+
+  for (size_t point = 0; point < KEY_DEPTH_POINTS; point++) {
+    for (size_t i = 0; i < count; i++) {
+      const size_t slot = point * count + i;
+      prefs.putString(keybindsKeyForDepthAction(i, point).c_str(), actions[slot]);
+      prefs.putUChar(keybindsKeyForDepthPercent(i, point).c_str(), clampDepthPercent((int)percents[slot], point));
+    }
+  }
+  prefs.end();
+  Serial.println(F("[prefs] saved depth actions"));
+}
+
+static uint8_t clampTapHoldMode(int value) {
+  if (value < 0 || value >= (int)TAP_HOLD_MODE_COUNT) return 0;
+  return (uint8_t)value;
+}
+
+static uint16_t clampTapHoldTerm(int value) {
+  if (value < (int)TAP_HOLD_TERM_MIN_MS) return TAP_HOLD_TERM_MIN_MS;
+  if (value > (int)TAP_HOLD_TERM_MAX_MS) return TAP_HOLD_TERM_MAX_MS;
+  return (uint16_t)value;
+}
+
+void keybindsLoadTapHoldFromPrefs(const char* prefsNamespace, uint8_t* modes, uint16_t* termsMs, size_t count) {
+  if (modes == nullptr || termsMs == nullptr || count == 0) {
+    return;
+  }
+  for (size_t i = 0; i < count; i++) {
+    modes[i] = 0;
+    termsMs[i] = TAP_HOLD_TERM_DEFAULT_MS;
+  }
+
+  Preferences prefs;
+  if (!prefs.begin(prefsNamespace, false)) {
+    Serial.println(F("[prefs] begin() failed; tap-hold defaults"));
+    return;
+  }
+
+  // Missing keys keep the defaults; nothing to initialize.
+  for (size_t i = 0; i < count; i++) {
+    modes[i] = clampTapHoldMode((int)prefs.getUChar(keybindsKeyForTapHoldMode(i).c_str(), 0));
+    termsMs[i] = clampTapHoldTerm((int)prefs.getUShort(keybindsKeyForTapHoldTerm(i).c_str(), TAP_HOLD_TERM_DEFAULT_MS));
+  }
+  prefs.end();
+}
+
+void keybindsSaveTapHoldToPrefs(const char* prefsNamespace, const uint8_t* modes, const uint16_t* termsMs, size_t count) {
+  if (modes == nullptr || termsMs == nullptr || count == 0) {
+    return;
+  }
+
+  Preferences prefs;
+  if (!prefs.begin(prefsNamespace, false)) {
+    Serial.println(F("[prefs] begin() failed; tap-hold not saved"));
+    return;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    prefs.putUChar(keybindsKeyForTapHoldMode(i).c_str(), clampTapHoldMode((int)modes[i]));
+    prefs.putUShort(keybindsKeyForTapHoldTerm(i).c_str(), clampTapHoldTerm((int)termsMs[i]));
+  }
+  prefs.end();
+  Serial.println(F("[prefs] saved tap-hold"));
+}
+
+// Same order as the hall keys (0..5).
+static const char* const BUTTON_NAMES[] = {"LT", "RT", "LM", "RM", "LB", "RB"};
+static constexpr size_t BUTTON_NAME_COUNT = sizeof(BUTTON_NAMES) / sizeof(BUTTON_NAMES[0]);
+
+bool keybindsParseComboKeys(const String& source, uint8_t& keyMask, String& error) {
+  keyMask = 0;
+  error = String();
+  int start = 0;
+  while (start <= (int)source.length()) {
+    int end = source.indexOf('+', start);
+    if (end < 0) {
+      end = source.length();
+    }
+    String token = source.substring(start, end);
+    token.trim();
+    token.toUpperCase();
+    start = end + 1;
+    if (token.length() == 0) {
+      continue;
+    }
+    size_t idx = 0;
+    while (idx < BUTTON_NAME_COUNT && !token.equals(BUTTON_NAMES[idx])) {
+      idx++;
+    }
+    if (idx == BUTTON_NAME_COUNT) {
+      error = String(F("unknown key '")) + token + F("' (use LT RT LM RM LB RB)");
+      return false;
+    }
+    keyMask |= (uint8_t)(1U << idx);
+  }
+  return true;
+}
+
+String keybindsComboKeysToString(uint8_t keyMask) {
+  String out;
+  for (size_t idx = 0; idx < BUTTON_NAME_COUNT; idx++) {
+    if (keyMask & (1U << idx)) {
+      if (out.length() > 0) {
+        out += '+';
+      }
+      out += BUTTON_NAMES[idx];
+    }
+  }
+  return out;
+}
+
+static uint16_t clampComboWindow(int value) {
+  if (value < (int)COMBO_WINDOW_MIN_MS) return COMBO_WINDOW_MIN_MS;
+  if (value > (int)COMBO_WINDOW_MAX_MS) return COMBO_WINDOW_MAX_MS;
+  return (uint16_t)value;
+}
+
+void keybindsLoadCombosFromPrefs(const char* prefsNamespace, uint8_t* keyMasks, String* actions, uint16_t* windowsMs, size_t count, ActionProgram* compiled) {
+  if (keyMasks == nullptr || actions == nullptr || windowsMs == nullptr || count == 0) {
+    return;
+  }
+  for (size_t i = 0; i < count; i++) {
+    keyMasks[i] = 0;
+    actions[i] = String();
+    windowsMs[i] = COMBO_WINDOW_DEFAULT_MS;
+  }
+
+  Preferences prefs;
+  if (!prefs.begin(prefsNamespace, false)) {
+    Serial.println(F("[prefs] begin() failed; no combos"));
+    return;
+  }
+
+  // Missing keys mean "no combo"; nothing to initialize.
+  for (size_t i = 0; i < count; i++) {
+    keyMasks[i] = prefs.getUChar(keybindsKeyForComboKeys(i).c_str(), 0);
+    actions[i] = prefs.getString(keybindsKeyForComboAction(i).c_str(), "");
+    windowsMs[i] = clampComboWindow((int)prefs.getUShort(keybindsKeyForComboWindow(i).c_str(), COMBO_WINDOW_DEFAULT_MS));
+  }
+  prefs.end();
+
+  for (size_t i = 0; i < count; i++) {
+    if (keyMasks[i] == 0) {
+      continue;
+    }
+    Serial.print(F("[prefs] combo "));
+    Serial.print(keybindsComboKeysToString(keyMasks[i]));
+    Serial.print(F("="));
+    Serial.println(actions[i]);
+    if (compiled != nullptr) {
+      String error;
+      if (!actionCompile(actions[i], compiled[i], error)) {
+        Serial.print(F("[prefs] "));
+        Serial.print(keybindsKeyForComboAction(i));
+        Serial.print(F(": "));
+        Serial.println(error);
+      }
+    }
+  }
+}
+
+void keybindsSaveCombosToPrefs(const char* prefsNamespace, const uint8_t* keyMasks, const String* actions, const uint16_t* windowsMs, size_t count) {
+  if (keyMasks == nullptr || actions == nullptr || windowsMs == nullptr || count == 0) {
+    return;
+  }
+
+  Preferences prefs;
+  if (!prefs.begin(prefsNamespace, false)) {
+    Serial.println(F("[prefs] begin() failed; combos not saved"));
+    return;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    prefs.putUChar(keybindsKeyForComboKeys(i).c_str(), keyMasks[i]);
+    prefs.putString(keybindsKeyForComboAction(i).c_str(), actions[i]);
+    prefs.putUShort(keybindsKeyForComboWindow(i).c_str(), clampComboWindow((int)windowsMs[i]));
+  }
+  prefs.end();
+  Serial.println(F("[prefs] saved combos"));
+}
+
+static uint8_t clampSocdPolicy(int value) {
+  if (value < 0 || value >= (int)SOCD_POLICY_COUNT) return 0;
+  return (uint8_t)value;
+}
+
+void keybindsLoadSocdFromPrefs(const char* prefsNamespace, uint8_t* keyMasks, uint8_t* policies, size_t count) {
+  if (keyMasks == nullptr || policies == nullptr || count == 0) {
+    return;
+  }
+  for (size_t i = 0; i < count; i++) {
+    keyMasks[i] = 0;
+    policies[i] = 0;
+  }
+
+  Preferences prefs;
+  if (!prefs.begin(prefsNamespace, false)) {
+    Serial.println(F("[prefs] begin() failed; no SOCD pairs"));
+    return;
+  }
+
+  // Missing keys mean "no pair"; nothing to initialize.
+  for (size_t i = 0; i < count; i++) {
+    keyMasks[i] = prefs.getUChar(keybindsKeyForSocdKeys(i).c_str(), 0);
+    policies[i] = clampSocdPolicy((int)prefs.getUChar(keybindsKeyForSocdPolicy(i).c_str(), 0));
+  }
+  prefs.end();
+
+  for (size_t i = 0; i < count; i++) {
+    if (keyMasks[i] == 0 || policies[i] == 0) {
+      continue;
+    }
+    Serial.print(F("[prefs] socd "));
+    Serial.print(keybindsComboKeysToString(keyMasks[i]));
+    Serial.print(F(" policy="));
+    Serial.println((int)policies[i]);
+  }
+}
+
+void keybindsSaveSocdToPrefs(const char* prefsNamespace, const uint8_t* keyMasks, const uint8_t* policies, size_t count) {
+  if (keyMasks == nullptr || policies == nullptr || count == 0) {
+    return;
+  }
+
+  Preferences prefs;
+  if (!prefs.begin(prefsNamespace, false)) {
+    Serial.println(F("[prefs] begin() failed; SOCD pairs not saved"));
+    return;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    prefs.putUChar(keybindsKeyForSocdKeys(i).c_str(), keyMasks[i]);
+    prefs.putUChar(keybindsKeyForSocdPolicy(i).c_str(), clampSocdPolicy((int)policies[i]));
+  }
+  prefs.end();
+  Serial.println(F("[prefs] saved SOCD pairs"));
+}
+
+static uint8_t clampLayerCount(int value) {
+  if (value < 1) return 1;
+  if (value > (int)KEYMAP_MAX_LAYERS) return (uint8_t)KEYMAP_MAX_LAYERS;
+  return (uint8_t)value;
+}
+
+void keybindsLoadLayersFromPrefs(const char* prefsNamespace, uint8_t& layerCount, bool& knobSelect) {
+  layerCount = 1;
+  knobSelect = true;
+
+  Preferences prefs;
+  if (!prefs.begin(prefsNamespace, false)) {
+    Serial.println(F("[prefs] begin() failed; layers=1"));
+    return;
+  }
+
+  // Missing keys keep the defaults; nothing to initialize.
+  layerCount = clampLayerCount((int)prefs.getUChar("layers", layerCount));
+  knobSelect = prefs.getUChar("layerKnob", knobSelect ? 1 : 0) != 0;
+  prefs.end();
+}
+
+void keybindsSaveLayersToPrefs(const char* prefsNamespace, uint8_t layerCount, bool knobSelect) {
+  Preferences prefs;
+  if (!prefs.begin(prefsNamespace, false)) {
+    Serial.println(F("[prefs] begin() failed; layers not saved"));
+    return;
+  }
+
+  layerCount = clampLayerCount((int)layerCount);
+  prefs.putUChar("layers", layerCount);
+  prefs.putUChar("layerKnob", knobSelect ? 1 : 0);
+  prefs.end();
+  Serial.print(F("[prefs] saved layers="));
+  Serial.print((int)layerCount);
+  Serial.println(knobSelect ? F(" (knob)") : F(""));
+}
+
+bool keybindsLoadGamepadFromPrefs(const char* prefsNamespace) {
+  Preferences prefs;
+  if (!prefs.begin(prefsNamespace, false)) {
+    Serial.println(F("[prefs] begin() failed; gamepad off"));
+    return false;
+  }
+
+  // Missing key means off; nothing to initialize.
+  const bool enabled = prefs.getUChar("gamepad", 0) != 0;
+  prefs.end();
+  return enabled;
+}
+
+void keybindsSaveGamepadToPrefs(const char* prefsNamespace, bool enabled) {
+  Preferences prefs;
+  if (!prefs.begin(prefsNamespace, false)) {
+    Serial.println(F("[prefs] begin() failed; gamepad not saved"));
+    return;
+  }
+
+  prefs.putUChar("gamepad", enabled ? 1 : 0);
+  prefs.end();
+  Serial.print(F("[prefs] saved gamepad="));
+  Serial.println(enabled ? F("on") : F("off"));
+}
+
+bool keybindsLoadRateGovernorFromPrefs(const char* prefsNamespace) {
+  Preferences prefs;
+  if (!prefs.begin(prefsNamespace, false)) {
+    Serial.println(F("[prefs] begin() failed; rate governor on"));
+    return true;
+  }
+
+  // Missing key means on; nothing to initialize.
+  const bool enabled = prefs.getUChar("adsGov", 1) != 0;
+  prefs.end();
+  return enabled;
+}
+
+void keybindsSaveRateGovernorToPrefs(const char* prefsNamespace, bool enabled) {
+  Preferences prefs;
+  if (!prefs.begin(prefsNamespace, false)) {
+    Serial.println(F("[prefs] begin() failed; rate governor not saved"));
+    return;
+  }
+
+  prefs.putUChar("adsGov", enabled ? 1 : 0);
+  prefs.end();
+  Serial.print(F("[prefs] saved adsGov="));
+  Serial.println(enabled ? F("on") : F("off"));
+}
+
+static uint8_t clampByte(int value, int lo, int hi, uint8_t fallback) {
+  return (value < lo || value > hi) ? fallback : (uint8_t)value;
+}
+
+void keybindsLoadMidiFromPrefs(const char* prefsNamespace, bool& enabled, uint8_t& channel, uint8_t& baseNote, uint8_t& knobCc) {
+  enabled = false;
+  channel = 1;
+  baseNote = 60;
+  knobCc = 1;
+
+  Preferences prefs;
+  if (!prefs.begin(prefsNamespace, false)) {
+    Serial.println(F("[prefs] begin() failed; midi off"));
+    return;
+  }
+
+  // Missing keys keep the defaults; nothing to initialize.
+  enabled = prefs.getUChar("midi", 0) != 0;
+  channel = clampByte((int)prefs.getUChar("midiCh", channel), 1, 16, channel);
+  baseNote = clampByte((int)prefs.getUChar("midiNote", baseNote), 0, 121, baseNote);
+  knobCc = clampByte((int)prefs.getUChar("midiCC", knobCc), 0, 119, knobCc);
+  prefs.end();
+}
+
+void keybindsSaveMidiToPrefs(const char* prefsNamespace, bool enabled, uint8_t channel, uint8_t baseNote, uint8_t knobCc) {
+  Preferences prefs;
+  if (!prefs.begin(prefsNamespace, false)) {
+    Serial.println(F("[prefs] begin() failed; midi not saved"));
+    return;
+  }
+
+  prefs.putUChar("midi", enabled ? 1 : 0);
+  prefs.putUChar("midiCh", clampByte((int)channel, 1, 16, 1));
+  prefs.putUChar("midiNote", clampByte((int)baseNote, 0, 121, 60));
+  prefs.putUChar("midiCC", clampByte((int)knobCc, 0, 119, 1));
+  prefs.end();
+  Serial.print(F("[prefs] saved midi="));
+  Serial.println(enabled ? F("on") : F("off"));
+}
+
+typedef String (*ActionKeyFn)(size_t idx, size_t layer);
+
+static void compileActions(const String* actions, size_t actionCount, ActionProgram* compiled, size_t layer, ActionKeyFn keyFor) {
+  if (compiled == nullptr) {
+    return;
+  }
+  for (size_t i = 0; i < actionCount; i++) {
+    String error;
+    if (!actionCompile(actions[i], compiled[i], error)) {
+      Serial.print(F("[prefs] "));
+      Serial.print(keyFor(i, layer));
+      Serial.print(F(": "));
+      Serial.println(error);
+    }
+  }
+}
+
+// Shared by tap (btnN) and hold (holdN) actions. Only layer-1 tap actions
+// have defaults; everything else starts empty.
+static void loadActions(const char* prefsNamespace, String* actions, size_t actionCount, ActionProgram* compiled, size_t layer, ActionKeyFn keyFor, bool withDefaults) {
   if (actions == nullptr || actionCount == 0) {
     return;
   }
@@ -109,22 +777,27 @@ void keybindsLoadFromPrefs(const char* prefsNamespace, String* actions, size_t a
   Preferences prefs;
   if (!prefs.begin(prefsNamespace, false)) {
     for (size_t i = 0; i < actionCount; i++) {
-      actions[i] = defaultActionForButton(i);
+      actions[i] = withDefaults ? defaultActionForButton(i) : String();
     }
     Serial.println(F("[prefs] begin() failed; using defaults"));
+    compileActions(actions, actionCount, compiled, layer, keyFor);
     return;
   }
 
   bool wroteAnyDefaults = false;
   for (size_t i = 0; i < actionCount; i++) {
-    const String key = keybindsKeyForButton(i);
+    const String key = keyFor(i, layer);
 
     // Only auto-fill defaults when the key does not exist.
     // This preserves intentionally-empty strings.
     if (!prefs.isKey(key.c_str())) {
-      actions[i] = defaultActionForButton(i);
-      prefs.putString(key.c_str(), actions[i]);
-      wroteAnyDefaults = true;
+      if (withDefaults) {
+        actions[i] = defaultActionForButton(i);
+        prefs.putString(key.c_str(), actions[i]);
+        wroteAnyDefaults = true;
+      } else {
+        actions[i] = String();
+      }
       continue;
     }
 
@@ -137,14 +810,15 @@ void keybindsLoadFromPrefs(const char* prefsNamespace, String* actions, size_t a
     Serial.println(F("[prefs] initialized missing keys with defaults"));
   }
   for (size_t i = 0; i < actionCount; i++) {
-    Serial.print(F("[prefs] btn"));
-    Serial.print((int)i);
+    Serial.print(F("[prefs] "));
+    Serial.print(keyFor(i, layer));
     Serial.print(F("="));
     Serial.println(actions[i]);
   }
+  compileActions(actions, actionCount, compiled, layer, keyFor);
 }
 
-void keybindsSaveToPrefs(const char* prefsNamespace, const String* actions, size_t actionCount) {
+static void saveActions(const char* prefsNamespace, const String* actions, size_t actionCount, size_t layer, ActionKeyFn keyFor) {
   if (actions == nullptr || actionCount == 0) {
     return;
   }
@@ -156,10 +830,29 @@ void keybindsSaveToPrefs(const char* prefsNamespace, const String* actions, size
   }
 
   for (size_t i = 0; i < actionCount; i++) {
-    const String key = keybindsKeyForButton(i);
+    const String key = keyFor(i, layer);
     prefs.putString(key.c_str(), actions[i]);
   }
 
   prefs.end();
-  Serial.println(F("[prefs] saved keybinds"));
+}
+
+void keybindsLoadFromPrefs(const char* prefsNamespace, String* actions, size_t actionCount, ActionProgram* compiled, size_t layer) {
+  loadActions(prefsNamespace, actions, actionCount, compiled, layer, keybindsKeyForButton, layer == 0);
+}
+
+void keybindsSaveToPrefs(const char* prefsNamespace, const String* actions, size_t actionCount, size_t layer) {
+  saveActions(prefsNamespace, actions, actionCount, layer, keybindsKeyForButton);
+  Serial.print(F("[prefs] saved keybinds, layer "));
+  Serial.println((int)layer + 1);
+}
+
+void keybindsLoadHoldFromPrefs(const char* prefsNamespace, String* actions, size_t actionCount, ActionProgram* compiled, size_t layer) {
+  loadActions(prefsNamespace, actions, actionCount, compiled, layer, keybindsKeyForHold, false);
+}
+
+void keybindsSaveHoldToPrefs(const char* prefsNamespace, const String* actions, size_t actionCount, size_t layer) {
+  saveActions(prefsNamespace, actions, actionCount, layer, keybindsKeyForHold);
+  Serial.print(F("[prefs] saved hold actions, layer "));
+  Serial.println((int)layer + 1);
 }
@@ -2,9 +2,13 @@
 #include <Adafruit_ADS1X15.h>
 #include <AS5600.h>
 
+#include "mxgicAdsPipeline.h"
+
 // Global device instances (defined once here)
 Adafruit_ADS1115 ads1;
 Adafruit_ADS1115 ads2;
+MxgicAdsPipeline adsPipe1;
+MxgicAdsPipeline adsPipe2;
 AS5600 as5600;
 
 // Display globals/assets
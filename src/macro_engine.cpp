@@ -0,0 +1,183 @@
+#include "macro_engine.h"
+
+#include "hid_report.h"
+
+// Upper bound on steps per run() for one macro, so a REPEAT block without
+// WAITs can't monopolize the caller.
+static constexpr size_t MAX_STEPS_PER_RUN = 128;
+
+bool MacroEngine::start(const ActionProgram* program, uint32_t nowMs) {
+  if (program == nullptr || !actionIsMacro(*program)) {
+    return false;
+  }
+  for (size_t i = 0; i < MAX_RUNNING; i++) {
+    Slot& slot = slots[i];
+    if (slot.program != nullptr) {
+      continue;
+    }
+    slot = Slot();
+    slot.program = program;
+    slot.pc = 1;  // Skip ACTION_OP_MACRO
+    slot.wakeMs = nowMs;
+    return true;
+  }
+  return false;
+}
+
+void MacroEngine::setBaseReport(const KeyReport& report) {
+  if (!hidReportEquals(report, base)) {
+    base = report;
+    dirty = true;
+  }
+}
+
+void MacroEngine::invalidate() {
+  dirty = true;
+}
+
+size_t MacroEngine::runningCount() const {
+  size_t count = 0;
+  for (size_t i = 0; i < MAX_RUNNING; i++) {
+    if (slots[i].program != nullptr) {
+      count++;
+    }
+  }
+  return count;
+}
+
+void MacroEngine::pressUsage(Slot& slot, uint8_t usage) {
+  for (size_t i = 0; i < HID_REPORT_KEY_SLOTS; i++) {
+    if (slot.usages[i] == usage) {
+      return;
+    }
+  }
+  for (size_t i = 0; i < HID_REPORT_KEY_SLOTS; i++) {
+    if (slot.usages[i] == 0) {
+      slot.usages[i] = usage;
+      return;
+    }
+  }
+}
+
+void MacroEngine::releaseUsage(Slot& slot, uint8_t usage) {
+  for (size_t i = 0; i < HID_REPORT_KEY_SLOTS; i++) {
+    if (slot.usages[i] == usage) {
+      slot.usages[i] = 0;
+    }
+  }
+}
+
+// Sends the merged report if it changed; returns true when it did.
+bool MacroEngine::emit(HidSink& sink) {
+  KeyReport report = base;
+  for (size_t i = 0; i < MAX_RUNNING; i++) {
+    const Slot& slot = slots[i];
+    if (slot.program == nullptr) {
+      continue;
+    }
+    report.modifiers |= slot.modifiers;
+    for (size_t k = 0; k < HID_REPORT_KEY_SLOTS; k++) {
+      if (slot.usages[k] != 0) {
+        (void)hidReportAddUsage(report, slot.usages[k]);
+      }
+    }
+  }
+  const bool send = dirty || !hidReportEquals(report, lastSent);
+  if (send) {
+    sink.sendReport(report);
+    lastSent = report;
+  }
+  dirty = false;
+  return send;
+}
+
+void MacroEngine::step(Slot& slot, uint32_t nowMs, HidSink& sink) {
+  const uint8_t* code = slot.program->code;
+  for (size_t n = 0; n < MAX_STEPS_PER_RUN; n++) {
+    if (slot.pc >= ACTION_PROGRAM_BYTES) {
+      slot.program = nullptr;
+      return;
+    }
+    const uint8_t op = code[slot.pc++];
+    switch (op) {
+      case ACTION_OP_PRESS_MODS:
+        slot.modifiers |= code[slot.pc++];
+        break;
+      case ACTION_OP_PRESS_KEY:
+        pressUsage(slot, code[slot.pc++]);
+        break;
+      case ACTION_OP_RELEASE_MODS:
+        slot.modifiers &= (uint8_t)~code[slot.pc++];
+        break;
+      case ACTION_OP_RELEASE_KEY:
+        releaseUsage(slot, code[slot.pc++]);
+        break;
+      case ACTION_OP_SYNC:
+        if (emit(sink)) {
+          sink.waitSent(MACRO_SYNC_TIMEOUT_MS);
+        }
+        break;
+      case ACTION_OP_WAIT: {
+        const uint16_t ms = (uint16_t)(code[slot.pc] | (code[slot.pc + 1] << 8));
+        slot.pc += 2;
+        // Schedule from the previous wake time so repeated waits don't drift.
+        slot.wakeMs += ms;
+        if ((int32_t)(slot.wakeMs - nowMs) > 0) {
+          return;
+        }
+        break;
+      }
+      case ACTION_OP_REPEAT:
+        slot.repeatLeft = (uint8_t)(code[slot.pc++] - 1);
+        slot.repeatPc = slot.pc;
+        slot.passMs = slot.wakeMs;
+        break;
+      case ACTION_OP_LOOP:
+        if (slot.repeatLeft > 0) {
+          slot.repeatLeft--;
+          slot.pc = slot.repeatPc;
+          // A pass without WAIT sleeps at least MACRO_REPEAT_MIN_MS before
+          // the next; passes with WAITs keep their drift-free schedule.
+          if (slot.wakeMs == slot.passMs) {
+            slot.wakeMs = nowMs + MACRO_REPEAT_MIN_MS;
+          }
+          slot.passMs = slot.wakeMs;
+          if ((int32_t)(slot.wakeMs - nowMs) > 0) {
+            return;
+          }
+        }
+        break;
+      case ACTION_OP_END:
+      default:
+        // Anything a macro leaves pressed is released when it ends.
+        slot.program = nullptr;
+        return;
+    }
+  }
+  // Step budget used up; continue on the next run().
+  slot.wakeMs = nowMs;
+}
+
+uint32_t MacroEngine::run(uint32_t nowMs, HidSink& sink) {
+  for (size_t i = 0; i < MAX_RUNNING; i++) {
+    Slot& slot = slots[i];
+    if (slot.program != nullptr && (int32_t)(nowMs - slot.wakeMs) >= 0) {
+      step(slot, nowMs, sink);
+    }
+  }
+  emit(sink);
+
+  uint32_t sleepMs = IDLE;
+  for (size_t i = 0; i < MAX_RUNNING; i++) {
+    const Slot& slot = slots[i];
+    if (slot.program == nullptr) {
+      continue;
+    }
+    const int32_t dueIn = (int32_t)(slot.wakeMs - nowMs);
+    const uint32_t wait = (dueIn > 0) ? (uint32_t)dueIn : 0;
+    if (wait < sleepMs) {
+      sleepMs = wait;
+    }
+  }
+  return sleepMs;
+}
@@ -6,6 +6,7 @@
 #include <AS5600.h>
 #include <BleKeyboard.h>
 #include <EEPROM.h>
+#include <atomic>
 #include "kronosDisplay.h"
 #include "mxgicHall.h"
 #include "mxgicDebounce.h"
@@ -17,6 +18,20 @@
 #include "wifi_config.h"
 #include "diagnostics_web.h"
 #include "timer_led_meter.h"
+#include "sensor_acq.h"
+#include "hall_calibration.h"
+#include "hid_report.h"
+#include "hid_output.h"
+#include "actions.h"
+#include "ble_link.h"
+#include "ble_hosts.h"
+#include "tap_hold.h"
+#include "combo.h"
+#include "socd.h"
+#include "gamepad.h"
+#include "midi_velocity.h"
+#include "midi_out.h"
+#include "hid_transport.h"
 //#include "ledMation.h"
 
 // EEPROM PROGRAMMING FOR STATE MEMORY
@@ -32,6 +47,14 @@ static constexpr uint8_t SDA0_Pin = 18;   // ESP32 SDA PIN
 static constexpr uint8_t SCL0_Pin = 17;   // ESP32 SCL PIN
 static constexpr uint8_t BUTTON_PIN = 8;
 
+// ADS1115 ALERT/RDY lines (conversion-ready interrupts).
+// -1 = not wired; the sampler then polls the config register instead.
+static constexpr int8_t ADS1_ALERT_PIN = -1;
+static constexpr int8_t ADS2_ALERT_PIN = -1;
+
+// Both ADS1115s convert the same channel index at once (3 conversion periods per frame).
+static constexpr AdsScanMode HALL_SCAN_MODE = AdsScanMode::Interleaved;
+
 // OLED Display 
 static constexpr uint16_t SCREEN_WIDTH = 128; // OLED width,  in pixels
 static constexpr uint16_t SCREEN_HEIGHT = 64; // OLED height, in pixels
@@ -63,6 +86,11 @@ unsigned long previousMillis3 = 0UL;
 unsigned long currentMillis3 = 0UL; 
 static constexpr unsigned long interval3 = 500UL; // Adjust this to change delay time
 
+// Layer screen shown after a layer change
+static constexpr unsigned long LAYER_SCREEN_MS = 1000UL;
+uint8_t shownLayer = 0;
+unsigned long layerShownMillis = 0UL;
+
 // Hall Effect Buttons Objects
 MxgicHall LTBTN , RTBTN, LMBTN, RMBTN, LBBTN, RBBTN;
 
@@ -96,8 +124,6 @@ bool toggle = false;
 // WiFi Keybind Configuration
 // ----------------------------
 
-static void bleTypeString(const String& input);
-
 static constexpr const char* WIFI_AP_SSID = "KRONOS-CONFIG";
 static constexpr const char* PREFS_NAMESPACE = "kronos";
 
@@ -133,129 +159,352 @@ static bool hallHeldForMs(MxgicHall& hallBtn, uint16_t holdMs) {
   return true;
 }
 
-String hallActions[HALL_BUTTON_COUNT];
-
-static bool pressKeyToken(const String& tokenUpper) {
-  if (tokenUpper.length() == 0) {
-    return false;
+// Keymap: one compiled table per layer, so resolving a key is a plain index.
+String hallActions[KEYMAP_MAX_LAYERS][HALL_BUTTON_COUNT];
+ActionProgram hallPrograms[KEYMAP_MAX_LAYERS][HALL_BUTTON_COUNT];  // Compiled from hallActions at boot
+// Hold side of dual-role keys; an empty program makes the key a plain key.
+String hallHoldActions[KEYMAP_MAX_LAYERS][HALL_BUTTON_COUNT];
+ActionProgram holdPrograms[KEYMAP_MAX_LAYERS][HALL_BUTTON_COUNT];
+static TapHoldEngine g_tapHold;
+// Multi-point actuation: actions for depth 2 and 3 of each key, indexed
+// [point * HALL_BUTTON_COUNT + idx]. Empty = the point is unused.
+String depthActions[KEY_DEPTH_POINTS * HALL_BUTTON_COUNT];
+ActionProgram depthPrograms[KEY_DEPTH_POINTS * HALL_BUTTON_COUNT];
+// Extra depth each key reached this frame, and the one its action last fired for.
+static uint8_t g_keyDepth[HALL_BUTTON_COUNT] = {};
+static uint8_t g_keyDepthFired[HALL_BUTTON_COUNT] = {};
+// Chords across hall keys; not tied to a layer.
+String comboActions[ComboEngine::MAX_COMBOS];
+ActionProgram comboPrograms[ComboEngine::MAX_COMBOS];
+static ComboEngine g_combos;
+// Opposing key pairs; resolved before anything else sees the keys.
+static SocdResolver g_socd;
+// Set by a MENU action in the scan task; loop() opens the timer menu.
+static volatile bool g_menuRequested = false;
+// Set by loop() while a menu or the timer-over screen is up: the scan keeps
+// running (so menus never touch the hall keys themselves) but sends nothing.
+static volatile bool g_menuOpen = false;
+// Debounced press edges (bit per hall key) the scan saw since a menu last
+// took them.
+static std::atomic<uint8_t> g_menuPressEdges{0};
+static uint8_t g_layerCount = 1;
+static bool g_layerKnob = true;
+// Gamepad mode: on USB the keys are analog axes instead of keybinds.
+static bool g_gamepadMode = false;
+// MIDI mode: keys play velocity-sensitive notes, the knob sends a CC.
+static bool g_midiMode = false;
+static uint8_t g_midiBaseNote = 60;
+static uint8_t g_midiKnobCc = 1;
+static MidiVelocityTracker g_midiKeys[HALL_BUTTON_COUNT];
+static uint16_t g_midiKnobSentAngle = 0;
+static int16_t g_midiKnobSent = -1;  // Last CC value sent, -1 = none yet
+// Knob counts (of 4096) the knob must move before its CC changes; one CC
+// step is 32 counts.
+static constexpr uint16_t MIDI_KNOB_DEADBAND = 24;
+static volatile uint8_t g_activeLayer = 0;
+// Layer each key was pressed on; a held key keeps it until release.
+static uint8_t g_keyLayer[HALL_BUTTON_COUNT] = {};
+static uint8_t g_knobLayer = 0;
+// Knob counts (of 4096) past a sector edge before the knob layer changes.
+static constexpr uint16_t KNOB_LAYER_DEADBAND = 80;
+
+// Debounced press edge for one hall key. Rapid-trigger keys already have
+// travel hysteresis, so they are accepted on the first sample.
+static bool hallPressedEdge(size_t idx) {
+  if (hall[idx]->rapidTriggerEnabled()) {
+    return debounceHall[idx]->debounce(hall[idx]->checkTrig(2), 1);
   }
+  return debounceHall[idx]->debounce(hall[idx]->checkTrig(0) != 0);
+}
 
-  if (tokenUpper == F("CTRL") || tokenUpper == F("CONTROL")) { bleKeyboard.press(KEY_LEFT_CTRL); return true; }
-  if (tokenUpper == F("SHIFT")) { bleKeyboard.press(KEY_LEFT_SHIFT); return true; }
-  if (tokenUpper == F("ALT")) { bleKeyboard.press(KEY_LEFT_ALT); return true; }
-  if (tokenUpper == F("GUI") || tokenUpper == F("WIN") || tokenUpper == F("CMD")) { bleKeyboard.press(KEY_LEFT_GUI); return true; }
-
-  if (tokenUpper == F("ENTER") || tokenUpper == F("RETURN")) { bleKeyboard.press(KEY_RETURN); return true; }
-  if (tokenUpper == F("TAB")) { bleKeyboard.press(KEY_TAB); return true; }
-  if (tokenUpper == F("ESC") || tokenUpper == F("ESCAPE")) { bleKeyboard.press(KEY_ESC); return true; }
-  if (tokenUpper == F("BACKSPACE") || tokenUpper == F("BKSP")) { bleKeyboard.press(KEY_BACKSPACE); return true; }
-  if (tokenUpper == F("DELETE") || tokenUpper == F("DEL")) { bleKeyboard.press(KEY_DELETE); return true; }
-  if (tokenUpper == F("SPACE")) { bleKeyboard.press(' '); return true; }
-
-  if (tokenUpper == F("UP")) { bleKeyboard.press(KEY_UP_ARROW); return true; }
-  if (tokenUpper == F("DOWN")) { bleKeyboard.press(KEY_DOWN_ARROW); return true; }
-  if (tokenUpper == F("LEFT")) { bleKeyboard.press(KEY_LEFT_ARROW); return true; }
-  if (tokenUpper == F("RIGHT")) { bleKeyboard.press(KEY_RIGHT_ARROW); return true; }
+// Debounced key state of the previous frame (bit per hall key).
+static uint8_t g_keyStateMask = 0;
+
+// Last held-combo report handed to the HID worker. Pending = it changed
+// but the queue was full, so retry with the current state next frame.
+static KeyReport g_hidReport = {};
+static bool g_hidReportPending = false;
+// Tap keys (and their depth in g_keyDepthFired) that g_hidReport was built from.
+static uint8_t g_hidReportTapMask = 0;
+
+// Updates every hall key against the latched frame. Returns the debounced
+// state mask; `pressedMask` / `releasedMask` get this frame's edges.
+static uint8_t scanHallKeys(uint8_t& pressedMask, uint8_t& releasedMask) {
+  uint8_t state = 0;
+  pressedMask = 0;
+  for (size_t idx = 0; idx < HALL_BUTTON_COUNT; idx++) {
+    if (hallPressedEdge(idx)) {
+      pressedMask |= (uint8_t)(1U << idx);
+    }
+    g_keyDepth[idx] = hall[idx]->checkDepth();
+    if (debounceHall[idx]->isPressed()) {
+      state |= (uint8_t)(1U << idx);
+    }
+  }
+  releasedMask = (uint8_t)(g_keyStateMask & ~state);
+  g_keyStateMask = state;
+  return state;
+}
 
-  if (tokenUpper == F("NUM_MINUS")) { bleKeyboard.press(KEY_NUM_MINUS); return true; }
-  if (tokenUpper == F("NUM_PLUS")) { bleKeyboard.press(KEY_NUM_PLUS); return true; }
-  if (tokenUpper == F("NUM_ENTER")) { bleKeyboard.press(KEY_NUM_ENTER); return true; }
+// Knob position split into g_layerCount equal sectors. The current sector
+// is widened by a dead band so a knob resting on an edge doesn't flicker.
+static uint8_t knobLayer(uint16_t angle) {
+  const int32_t lo = (int32_t)g_knobLayer * 4096 / g_layerCount;
+  const int32_t hi = (int32_t)(g_knobLayer + 1) * 4096 / g_layerCount;
+  if ((int32_t)angle >= lo - KNOB_LAYER_DEADBAND && (int32_t)angle < hi + KNOB_LAYER_DEADBAND) {
+    return g_knobLayer;
+  }
+  g_knobLayer = (uint8_t)(((uint32_t)angle * g_layerCount) >> 12);
+  return g_knobLayer;
+}
 
-  if (tokenUpper.length() == 2 && tokenUpper[0] == 'F' && isDigit(tokenUpper[1])) {
-    const int fnum = tokenUpper[1] - '0';
-    switch (fnum) {
-      case 1: bleKeyboard.press(KEY_F1); return true;
-      case 2: bleKeyboard.press(KEY_F2); return true;
-      case 3: bleKeyboard.press(KEY_F3); return true;
-      case 4: bleKeyboard.press(KEY_F4); return true;
-      case 5: bleKeyboard.press(KEY_F5); return true;
-      case 6: bleKeyboard.press(KEY_F6); return true;
-      case 7: bleKeyboard.press(KEY_F7); return true;
-      case 8: bleKeyboard.press(KEY_F8); return true;
-      case 9: bleKeyboard.press(KEY_F9); return true;
-      default: break;
+// Active layer: the highest LAYER: key or combo acting now, else the
+// knob's (when enabled), else layer 1.
+static uint8_t resolveLayer() {
+  const uint8_t tapMask = g_tapHold.tapMask();
+  const uint8_t holdMask = g_tapHold.holdMask();
+  const uint8_t comboMask = g_combos.activeMask();
+  int layer = -1;
+  for (size_t c = 0; c < ComboEngine::MAX_COMBOS; c++) {
+    if (comboMask & (1U << c)) {
+      const int momentary = actionLayer(comboPrograms[c]);
+      if (momentary > layer && momentary < (int)g_layerCount) {
+        layer = momentary;
+      }
     }
   }
-  if (tokenUpper.length() == 3 && tokenUpper[0] == 'F' && tokenUpper[1] == '1' && isDigit(tokenUpper[2])) {
-    const int fnum = 10 + (tokenUpper[2] - '0');
-    switch (fnum) {
-      case 10: bleKeyboard.press(KEY_F10); return true;
-      case 11: bleKeyboard.press(KEY_F11); return true;
-      case 12: bleKeyboard.press(KEY_F12); return true;
-      default: break;
+  for (size_t idx = 0; idx < HALL_BUTTON_COUNT; idx++) {
+    int momentary = -1;
+    if (tapMask & (1U << idx)) {
+      momentary = actionLayer(hallPrograms[g_keyLayer[idx]][idx]);
+    } else if (holdMask & (1U << idx)) {
+      momentary = actionLayer(holdPrograms[g_keyLayer[idx]][idx]);
     }
-  }
-
-  if (tokenUpper.length() == 1) {
-    char c = tokenUpper[0];
-    if (c >= 'A' && c <= 'Z') {
-      c = (char)(c - 'A' + 'a');
+    if (momentary > layer && momentary < (int)g_layerCount) {
+      layer = momentary;
     }
-    bleKeyboard.press(c);
-    return true;
   }
+  if (layer >= 0) {
+    return (uint8_t)layer;
+  }
+  if (g_layerKnob && g_layerCount > 1) {
+    return knobLayer(hallKnob.readRawAngle());
+  }
+  return 0;
+}
 
-  return false;
+// Tap-hold callback: a key starting to act binds to the layer active at
+// that moment and keeps it until release.
+static bool activateKey(size_t idx) {
+  g_keyLayer[idx] = resolveLayer();
+  return holdPrograms[g_keyLayer[idx]][idx].code[0] != ACTION_OP_END;
 }
 
-static void executeConfiguredAction(const String& action) {
-  if (action.startsWith(ACTION_TYPE_PREFIX)) {
-    bleTypeString(action.substring(strlen(ACTION_TYPE_PREFIX)));
-    return;
+// SOCD callback for deeper-press-wins pairs.
+static uint16_t keyTravel(size_t idx) {
+  return hall[idx]->linearTravel();
+}
+
+static_assert(HALL_BUTTON_COUNT == GAMEPAD_KEY_AXES, "one gamepad axis per hall key");
+static_assert(KEY_DEPTH_POINTS == HALL_DEPTH_POINTS, "one hall depth threshold per depth action");
+
+// Program of a key acting as tap at `depth`: that depth's action, else the
+// normal one. Unused points are never reached (see setup()).
+static const ActionProgram& tapProgram(size_t idx, uint8_t depth) {
+  if (depth > 0) {
+    return depthPrograms[(depth - 1) * HALL_BUTTON_COUNT + idx];
   }
+  return hallPrograms[g_keyLayer[idx]][idx];
+}
 
-  int start = 0;
-  while (start < action.length()) {
-    int plusPos = action.indexOf('+', start);
-    if (plusPos == -1) {
-      plusPos = action.length();
-    }
-    String token = action.substring(start, plusPos);
-    token.trim();
-    token.toUpperCase();
-    (void)pressKeyToken(token);
-    start = plusPos + 1;
+// One gamepad frame: linearized key travel, debounced key state as buttons,
+// knob angle. The deadband filter in gamepadOutputPost() decides if it goes out.
+static void postGamepadFrame(uint8_t heldMask) {
+  GamepadReport pad;
+  for (size_t idx = 0; idx < HALL_BUTTON_COUNT; idx++) {
+    const uint16_t travel = hall[idx]->linearTravel();
+    pad.axes[idx] = (travel > GAMEPAD_AXIS_MAX) ? GAMEPAD_AXIS_MAX : travel;
   }
+  pad.axes[GAMEPAD_KEY_AXES] = (uint16_t)(hallKnob.readRawAngle() & GAMEPAD_AXIS_MAX);
+  pad.buttons = heldMask;
+  (void)gamepadOutputPost(pad);
 }
 
+// One MIDI frame. Velocity timing uses the acquisition timestamp of the
+// frame, not the time this task got to it.
+static void playMidiFrame(uint32_t timestampUs) {
+  for (size_t idx = 0; idx < HALL_BUTTON_COUNT; idx++) {
+    const uint8_t note = (uint8_t)(g_midiBaseNote + idx);
+    uint8_t velocity = 0;
+    uint32_t strikeUs = 0;
+    switch (g_midiKeys[idx].update(hall[idx]->linearTravel(), timestampUs, velocity, strikeUs)) {
+      case MidiVelocityTracker::NoteOn:
+        (void)midiOutNoteOn(note, velocity, strikeUs);
+        break;
+      case MidiVelocityTracker::NoteOff:
+        (void)midiOutNoteOff(note, timestampUs);
+        break;
+      default:
+        break;
+    }
+  }
 
+  const uint16_t angle = hallKnob.readRawAngle();
+  const int16_t value = (int16_t)(angle >> 5);
+  const uint16_t moved = (angle > g_midiKnobSentAngle) ? (uint16_t)(angle - g_midiKnobSentAngle)
+                                                       : (uint16_t)(g_midiKnobSentAngle - angle);
+  if (value != g_midiKnobSent && (g_midiKnobSent < 0 || moved > MIDI_KNOB_DEADBAND || value == 0 || value == 127)) {
+    if (midiOutControlChange(g_midiKnobCc, (uint8_t)value, timestampUs)) {
+      g_midiKnobSent = value;
+      g_midiKnobSentAngle = angle;
+    }
+  }
+}
 
-static void bleTypeString(const String& input) {
-  for (int idx = 0; idx < input.length(); idx++) {
-    bleKeyboard.print(input[idx]);
-    bleKeyboard.releaseAll();
-    delay(10);
+// Press-edge side of an action: text, macros and the menu.
+static void fireEdgeAction(const ActionProgram& program) {
+  if (actionHasText(program)) {
+    (void)hidOutputQueueText(program.text, program.textLength);
+  } else if (actionIsMacro(program)) {
+    (void)hidOutputQueueMacro(&program);
+  } else if (actionIsMenu(program)) {
+    g_menuRequested = true;
   }
 }
 
 // Task Function
 void infiniteScan(void * parameters) {
+  SensorSnapshot frame;
   for(;;) {
     if(initializedK){
-      if (debounceHall[0]->debounce(LTBTN.checkTrig(0) != 0)) {
-        executeConfiguredAction(hallActions[0]);
+      // One acquisition frame per pass; every key below sees the same frame.
+      if (!sensorAcqWaitFrame(pdMS_TO_TICKS(10))) {
+        continue;
+      }
+      sensorAcqRead(frame);
+      for (size_t idx = 0; idx < HALL_BUTTON_COUNT; idx++) {
+        hall[idx]->latch(frame);
+      }
+
+      // Every key is sampled and debounced every frame.
+      uint8_t pressedMask = 0;
+      uint8_t releasedMask = 0;
+      const uint8_t scannedMask = scanHallKeys(pressedMask, releasedMask);
+      g_menuPressEdges.fetch_or(pressedMask);
+      const bool menuOpen = g_menuOpen;
+      // Opposing pairs are resolved on the frame that sees the second press.
+      g_socd.update(scannedMask, pressedMask, releasedMask, keyTravel);
+      const uint8_t heldMask = g_socd.heldMask();
+      const bool gamepad = g_gamepadMode && hidTransportActive() == HidTransportKind::Usb;
+      // Gamepad and MIDI modes replace keybinds; an open menu owns the keys.
+      const bool keybindsOff = gamepad || g_midiMode || menuOpen;
+      // Held keys (and the analog modes) keep the ADCs at their fastest rate.
+      sensorAcqSetKeysHeld(scannedMask != 0 || keybindsOff);
+      if (g_midiMode && !menuOpen) {
+        playMidiFrame(frame.timestampUs);
       }
-      else if (debounceHall[1]->debounce(RTBTN.checkTrig(0) != 0)) {
-        executeConfiguredAction(hallActions[1]);
+
+      // Plain keys act on this frame. Combo keys wait for the rest of
+      // their chord, dual-role keys (and keys pressed behind them) until tap
+      // or hold is decided.
+      const uint32_t nowMs = millis();
+      g_combos.update(nowMs, g_socd.pressedMask(), g_socd.releasedMask());
+      g_tapHold.update(nowMs, g_combos.pressedMask(), g_combos.releasedMask(), activateKey);
+      const uint8_t tapMask = g_tapHold.tapMask();
+      const uint8_t holdMask = g_tapHold.holdMask();
+      const uint8_t comboMask = g_combos.activeMask();
+      g_activeLayer = resolveLayer();
+
+      // Combos are held for as long as their hall key is down; the report
+      // only goes out when the held set actually changes.
+      KeyReport report;
+      hidReportClear(report);
+      for (size_t idx = 0; idx < HALL_BUTTON_COUNT; idx++) {
+        if (tapMask & (1U << idx)) {
+          actionApplyHeld(tapProgram(idx, g_keyDepth[idx]), report);
+        } else if (holdMask & (1U << idx)) {
+          actionApplyHeld(holdPrograms[g_keyLayer[idx]][idx], report);
+        }
       }
-      else if (debounceHall[2]->debounce(LMBTN.checkTrig(0) != 0)) {
-        executeConfiguredAction(hallActions[2]);
+      for (size_t c = 0; c < ComboEngine::MAX_COMBOS; c++) {
+        if (comboMask & (1U << c)) {
+          actionApplyHeld(comboPrograms[c], report);
+        }
       }
-      else if (debounceHall[3]->debounce(RMBTN.checkTrig(0) != 0)) {
-        executeConfiguredAction(hallActions[3]);
+      // Without keybinds the engines keep running (so nothing is stuck when
+      // gamepad mode drops back to keyboard) but the keyboard stays released.
+      if (keybindsOff) {
+        hidReportClear(report);
       }
-      else if (debounceHall[4]->debounce(LBBTN.checkTrig(0) != 0)) {
-        executeConfiguredAction(hallActions[4]);
+      if (gamepad) {
+        postGamepadFrame(menuOpen ? 0 : heldMask);
       }
-      else if (debounceHall[5]->debounce(RBBTN.checkTrig(0) != 0)) {
-        executeConfiguredAction(hallActions[5]);
+      // A key changing depth swaps programs in place, e.g. CTRL+Z -> CTRL+SHIFT+Z.
+      // Release what both hold for one report so the host sees a fresh press.
+      if (!keybindsOff) {
+        KeyReport bridge = g_hidReport;
+        bool bridged = false;
+        for (size_t idx = 0; idx < HALL_BUTTON_COUNT; idx++) {
+          const uint8_t bit = (uint8_t)(1U << idx);
+          if ((tapMask & g_hidReportTapMask & bit) && g_keyDepth[idx] != g_keyDepthFired[idx]) {
+            bridged |= actionReleaseShared(tapProgram(idx, g_keyDepthFired[idx]),
+                                           tapProgram(idx, g_keyDepth[idx]), bridge);
+          }
+        }
+        if (bridged && hidOutputQueueReport(bridge)) {
+          g_hidReport = bridge;
+        }
+      }
+      g_hidReportTapMask = keybindsOff ? 0 : tapMask;
+      // Output goes through the HID worker; scanning never waits on BLE.
+      if (g_hidReportPending || !hidReportEquals(report, g_hidReport)) {
+        g_hidReportPending = !hidOutputQueueReport(report);
+        g_hidReport = report;
+      }
+
+      const uint8_t tapEdges = keybindsOff ? 0 : g_tapHold.tapEdges();
+      const uint8_t holdEdges = keybindsOff ? 0 : g_tapHold.holdEdges();
+      for (size_t idx = 0; idx < HALL_BUTTON_COUNT; idx++) {
+        const uint8_t bit = (uint8_t)(1U << idx);
+        if (!((tapEdges | holdEdges) & bit)) {
+          continue;
+        }
+        fireEdgeAction((tapEdges & bit) ? hallPrograms[g_keyLayer[idx]][idx]
+                                        : holdPrograms[g_keyLayer[idx]][idx]);
+      }
+      // Going deeper fires the edge side of the depth reached; going back
+      // up re-arms it.
+      for (size_t idx = 0; idx < HALL_BUTTON_COUNT; idx++) {
+        const uint8_t depth = (tapMask & (1U << idx)) ? g_keyDepth[idx] : 0;
+        if (depth > g_keyDepthFired[idx] && !keybindsOff) {
+          fireEdgeAction(depthPrograms[(depth - 1) * HALL_BUTTON_COUNT + idx]);
+        }
+        g_keyDepthFired[idx] = depth;
+      }
+      const uint8_t comboEdges = keybindsOff ? 0 : g_combos.firedMask();
+      for (size_t c = 0; c < ComboEngine::MAX_COMBOS; c++) {
+        if (comboEdges & (1U << c)) {
+          fireEdgeAction(comboPrograms[c]);
+        }
       }
-      bleKeyboard.releaseAll();
       //if (buttonG.debounce(digitalRead(BUTTON_PIN) == HIGH)) {
       //  bleKeyboard.print("LOVE YOU!");
       //}
+
+      // Menus and screens outside the scan read the newest snapshot.
+      for (size_t idx = 0; idx < HALL_BUTTON_COUNT; idx++) {
+        hall[idx]->unlatch();
+      }
+    }
+    else {
+      // Paused (calibration): let go of whatever the scan was holding, or it
+      // stays down on the host and auto-repeats. Retried while the queue is full.
+      if (g_hidReportPending || !hidReportIsEmpty(g_hidReport)) {
+        hidReportClear(g_hidReport);
+        g_hidReportPending = !hidOutputQueueReport(g_hidReport);
+      }
+      vTaskDelay(pdMS_TO_TICKS(1));
     }
-    vTaskDelay(pdMS_TO_TICKS(1));
   }
 }
 
@@ -304,11 +553,12 @@ enum class ScreenId : int {
   SensorReadings = 3,
   CalibrationPrompt = 4,
   CalibrationMinMax = 5,
-  Layer1 = 6,
+  Layer = 6,
   TimerSet = 7,
   TimerSetAck = 8,
   TimerLeft = 9,
   TimerOver = 10,
+  HostSelect = 11,
 };
 
 static void renderUnusedScreen() {
@@ -341,16 +591,26 @@ static void renderBootWithLogo() {
 static void renderSensorReadings() {
   currentMillis3 = millis();
   if (currentMillis3 - previousMillis3 >= interval3) {
+    SensorSnapshot snap;
+    sensorAcqRead(snap);
+    uint16_t raw[HALL_BUTTON_COUNT];
+    for (size_t idx = 0; idx < HALL_BUTTON_COUNT; idx++) {
+      raw[idx] = snap.hallRaw[hall[idx]->adcSel - 1][hall[idx]->adcCh];
+    }
+    angleHall = snap.knobRaw;
     oled.clearDisplay();
     oled.setTextSize(1);         // set text size
     oled.setCursor(0, 0);
     oled.print(F("Sensor Readings:")); //Using oled.print(F()) due to it not taking up RAM
     oled.print(F("Hall Angle: ")); oled.println(angleHall);
-    oled.print(F("LT: "));oled.print(hall[0]->currentVal);oled.print(F(" RT: "));oled.println(hall[1]->currentVal);
-    oled.print(F("LM: "));oled.print(hall[2]->currentVal);oled.print(F(" RM: "));oled.println(hall[3]->currentVal);
-    oled.print(F("LB: "));oled.print(hall[4]->currentVal);oled.print(F(" RB: "));oled.println(hall[5]->currentVal);
+    oled.print(F("LT: "));oled.print(raw[0]);oled.print(F(" RT: "));oled.println(raw[1]);
+    oled.print(F("LM: "));oled.print(raw[2]);oled.print(F(" RM: "));oled.println(raw[3]);
+    oled.print(F("LB: "));oled.print(raw[4]);oled.print(F(" RB: "));oled.println(raw[5]);
     oled.print(F("Button: ")); oled.println(digitalRead(BUTTON_PIN)); oled.print(F(" ")); oled.print(duration); oled.println(F(" us"));
     oled.print(hall[0]->precision);
+    if (g_layerCount > 1) {
+      oled.print(F("  Layer ")); oled.print((int)g_activeLayer + 1);
+    }
     oled.display();
     previousMillis3 = currentMillis3;
   }
@@ -374,16 +634,18 @@ static void renderCalibrationMinMax(int misc) {
   oled.display();
 }
 
-static void renderLayer1() {
+static void renderLayer(int layer) {
   currentMillis2 = millis();
   if (currentMillis2 - previousMillis2 >= interval2) {
     oled.clearDisplay();
     oled.setTextSize(1);
     oled.drawBitmap(0, 0, myLogo, 128, 64, WHITE);
     oled.setCursor(0, 0);
-    oled.print("Layer 1");
+    oled.print(F("Layer "));
+    oled.print(layer + 1);
     oled.display();
-    previousMillis3 = currentMillis3;
+    previousMillis2 = currentMillis2;
+    previousMillis3 = 0UL; // Redraw sensor readings as soon as this is gone
   }
 }
 
@@ -447,6 +709,28 @@ static void renderTimerOverScreen() {
   oled.display();
 }
 
+// BLE host slots; `slot` is the highlighted one, `*` marks the active one.
+static void renderHostSelect(int slot) {
+  BleHostStats stats;
+  bleHostsGetStats(stats);
+  oled.clearDisplay();
+  oled.setTextSize(1);
+  oled.setCursor(0, 0);
+  oled.println(F("BLE HOST"));
+  for (size_t idx = 0; idx < BLE_HOST_SLOTS; idx++) {
+    oled.print(((int)idx == slot) ? F("> ") : F("  "));
+    oled.print((int)(idx + 1));
+    oled.print(bleHostsSlotUsed(idx) ? F(" paired") : F(" empty"));
+    oled.println((idx == stats.activeSlot) ? F(" *") : F(""));
+  }
+  oled.print(F("Reconnect: "));
+  oled.print(stats.reconnectMs);
+  oled.println(F(" ms"));
+  oled.println();
+  oled.println(F("LT:Go RT:Back RB:Del"));
+  oled.display();
+}
+
 void screenRender(ScreenId screen, int timer, int misc = 0, const String& optText = "NULL") {
   (void)optText;
   switch (screen) {
@@ -474,8 +758,8 @@ void screenRender(ScreenId screen, int timer, int misc = 0, const String& optTex
       renderCalibrationMinMax(misc);
     break;
 
-    case ScreenId::Layer1:
-      renderLayer1();
+    case ScreenId::Layer:
+      renderLayer(misc);
     break;
 
     case ScreenId::TimerSet:
@@ -494,6 +778,10 @@ void screenRender(ScreenId screen, int timer, int misc = 0, const String& optTex
       renderTimerOverScreen();
     break;
 
+    case ScreenId::HostSelect:
+      renderHostSelect(misc);
+    break;
+
     default:
       // Intentionally no-op for unknown screens
     break;
@@ -511,6 +799,8 @@ void initializeKronos(){
 
   while (currentHall < numBtns) {
     calibrationComplete = false;
+    // Fixed threshold until this key has a fresh range.
+    hall[currentHall]->beginCalibration();
     while(!calibrationComplete) {
       while(hall[currentHall]->checkTrig(0) == 0) {
         displayText = "PRESS BTN" + String(currentHall+1);
@@ -535,6 +825,7 @@ void initializeKronos(){
           displayText = "HALL " + String(currentHall+1) + "CHK";
           screenRender(ScreenId::CalibrationMinMax, 0, currentHall);
           delay(500);
+          hall[currentHall]->finishCalibration();
           arrayCalibrationComplete = true;
           calibrationComplete = true;
           currentHall++;
@@ -547,11 +838,23 @@ void initializeKronos(){
   }
 }
 
-bool timerMenuKeyScan(unsigned long timerMenuMs) {
-  if (LTBTN.checkTrig(0) != 0) {
-    return true;
+// Menus run in loop() and never call checkTrig(): the scan task owns the
+// hall keys. They take the press edges it published instead.
+static uint8_t menuTakePressEdges() {
+  return g_menuPressEdges.exchange(0);
+}
+
+static uint8_t hallBit(const MxgicHall& key) {
+  for (size_t idx = 0; idx < HALL_BUTTON_COUNT; idx++) {
+    if (hall[idx] == &key) {
+      return (uint8_t)(1U << idx);
+    }
   }
-  if (RTBTN.checkTrig(0) != 0) {
+  return 0;
+}
+
+bool timerMenuKeyScan(unsigned long timerMenuMs) {
+  if (menuTakePressEdges() & (hallBit(LTBTN) | hallBit(RTBTN))) {
     return true;
   }
   if ((digitalRead(BUTTON_PIN) == LOW) && (timerMenuMs > 1000UL)) {
@@ -560,24 +863,49 @@ bool timerMenuKeyScan(unsigned long timerMenuMs) {
 
   return false;
 }
+// Host picker: the knob highlights a slot, LT switches to it, RB forgets
+// its host (re-pair), RT backs out.
+static void hostMenu() {
+  // The RB press that opened the picker must not count.
+  (void)menuTakePressEdges();
+  for (;;) {
+    const size_t slot = hallKnob.scanMapAngle(BLE_HOST_SLOTS, 255, 1);
+    const uint8_t edges = menuTakePressEdges();
+    const bool ltPressedEdge = (edges & hallBit(LTBTN)) != 0;
+    const bool rtPressedEdge = (edges & hallBit(RTBTN)) != 0;
+    const bool rbPressedEdge = (edges & hallBit(RBBTN)) != 0;
+
+    screenRender(ScreenId::HostSelect, 0, (int)slot);
+    if (ltPressedEdge) {
+      bleHostsSelect(slot);
+      delay(500);
+      return;
+    }
+    if (rbPressedEdge) {
+      bleHostsForget(slot);
+    }
+    if (rtPressedEdge) {
+      return;
+    }
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+}
+
 bool timerMenu (){
   unsigned long menuEnteredTime = millis();
   unsigned long menuNowTime = 0UL;
   unsigned long menuTimeDiff = 0UL;
   int timePrint = 0;
-  bool prevLT = false;
-  bool prevRT = false;
-  initializedK = false;
+  // Presses from before the menu (e.g. a MENU combo) must not count; keys
+  // still held give no new edge until pressed again.
+  (void)menuTakePressEdges();
   for(;;){
     menuNowTime = millis();
     menuTimeDiff = menuNowTime - menuEnteredTime;
 
-    const bool curLT = (LTBTN.checkTrig(0) != 0);
-    const bool curRT = (RTBTN.checkTrig(0) != 0);
-    const bool ltPressedEdge = curLT && !prevLT;
-    const bool rtPressedEdge = curRT && !prevRT;
-    prevLT = curLT;
-    prevRT = curRT;
+    const uint8_t edges = menuTakePressEdges();
+    const bool ltPressedEdge = (edges & hallBit(LTBTN)) != 0;
+    const bool rtPressedEdge = (edges & hallBit(RTBTN)) != 0;
 
     if (maintimer.timerRunning == 1 ) {
       // Show time left
@@ -644,6 +972,29 @@ bool timerMenu (){
         timerLedMeterClear();
         return false;
       }
+
+      // LM / RM / LB jump straight to BLE host 1 / 2 / 3; RB opens the picker.
+      MxgicHall* hostKeys[BLE_HOST_SLOTS + 1] = {&LMBTN, &RMBTN, &LBBTN, &RBBTN};
+      uint8_t hostEdges = 0;
+      for (size_t idx = 0; idx <= BLE_HOST_SLOTS; idx++) {
+        if (edges & hallBit(*hostKeys[idx])) {
+          hostEdges |= (uint8_t)(1U << idx);
+        }
+      }
+      for (size_t idx = 0; idx < BLE_HOST_SLOTS; idx++) {
+        if (hostEdges & (1U << idx)) {
+          timerLedMeterClear();
+          bleHostsSelect(idx);
+          screenRender(ScreenId::HostSelect, 0, (int)idx);
+          delay(500);
+          return false;
+        }
+      }
+      if (hostEdges & (1U << BLE_HOST_SLOTS)) {
+        timerLedMeterClear();
+        hostMenu();
+        return false;
+      }
     }
     vTaskDelay(pdMS_TO_TICKS(10));
   }
@@ -653,19 +1004,24 @@ bool timerEnd(){
   screenRender(ScreenId::TimerOver, 0, 0, "Timer Set!");
   solidColor2(leds_75, NUM_LEDS_SCREENARRAY , CRGB::Red);
   delay(1000);
+  g_menuOpen = true;
+  (void)menuTakePressEdges();
   for(;;){
     screenRender(ScreenId::TimerOver, 0, 0, "Timer Set!");
-    if (LTBTN.checkTrig(0)){ // Check if left button was pressed 
+    const uint8_t edges = menuTakePressEdges();
+    if (edges & hallBit(LTBTN)){ // Check if left button was pressed 
       solidColor2(leds_75, NUM_LEDS_SCREENARRAY , CRGB::Black);
       maintimer.reset();
       timerLedMeterClear(true);
+      g_menuOpen = false;
       return true;
     }
-    else if (RTBTN.checkTrig(0)){
+    else if (edges & hallBit(RTBTN)){
       solidColor2(leds_75, NUM_LEDS_SCREENARRAY , CRGB::Black);
       maintimer.reset();
       timerLedMeterClear(true);
       timerMenu();
+      g_menuOpen = false;
       return true;
     }
     delay (25);
@@ -707,6 +1063,10 @@ void setup() {
 
   // Initializing BLE Keyboard
   bleKeyboard.begin();
+  bleLinkBegin();
+  bleHostsBegin(PREFS_NAMESPACE);
+  hidOutputStart(bleKeyboard);
+  gamepadOutputStart();
 
   // Initializing Button
   pinMode(BUTTON_PIN, INPUT_PULLUP);
@@ -743,6 +1103,7 @@ void setup() {
 
   // Maximize sample rate to reduce per-read blocking time.
   // Default rates are much slower and can make button presses feel laggy.
+  // The acquisition task lowers it while the pad is idle (rate governor).
   ads1.setDataRate(RATE_ADS1115_860SPS);
 
   if (!ads2.begin(0x49)) {
@@ -752,8 +1113,37 @@ void setup() {
 
   ads2.setDataRate(RATE_ADS1115_860SPS);
 
+  // Start the pipelined samplers (channels were registered by setChannel()).
+  if (!adsPipe1.begin(ads1, 0x48, ADS1_ALERT_PIN)) {
+    Serial.println("Failed to start ADS1115 pipeline at 0x48");
+    for(;;);
+  }
+  if (!adsPipe2.begin(ads2, 0x49, ADS2_ALERT_PIN)) {
+    Serial.println("Failed to start ADS1115 pipeline at 0x49");
+    for(;;);
+  }
+
+  // Initialize AS5600 Hall Effect Sensor
+  as5600.begin();
+
+  // Hall noise filter runs inside the acquisition task, before publishing.
+  {
+    uint8_t filterMode = 3;
+    uint8_t filterStrength = 2;
+    keybindsLoadHallFilterFromPrefs(PREFS_NAMESPACE, filterMode, filterStrength);
+    sensorAcqSetFilter((HallFilterMode)filterMode, filterStrength);
+  }
+  sensorAcqSetRateGovernor(keybindsLoadRateGovernorFromPrefs(PREFS_NAMESPACE));
+
+  // From here on only the acquisition task talks to the ADS1115s/AS5600;
+  // everything else reads its snapshot.
+  sensorAcqStart(HALL_SCAN_MODE);
+
+  // Restore per-key min/max (one NVS read) so keys are calibrated immediately.
+  hallCalibrationLoadFromPrefs(PREFS_NAMESPACE, hall, HALL_BUTTON_COUNT);
+
   // Hold the selected hall "button" at boot to enter WiFi configuration mode.
-  // ADS1115 must be initialized before hallBtn.checkTrig().
+  // The acquisition task must be running before hallBtn.checkTrig().
   if (WIFI_CONFIG_HALL_INDEX < HALL_BUTTON_COUNT) {
     enterWifiConfig = hallHeldForMs(*hall[WIFI_CONFIG_HALL_INDEX], WIFI_CONFIG_HOLD_MS);
   }
@@ -786,14 +1176,86 @@ void setup() {
 
   // If requested, enter WiFi config mode now that the screen + ADS are initialized.
   if (enterWifiConfig) {
-    startWifiConfigPortal(WIFI_AP_SSID, PREFS_NAMESPACE, oled, hallActions, HALL_BUTTON_COUNT, &diagCtx);
+    startWifiConfigPortal(WIFI_AP_SSID, PREFS_NAMESPACE, oled, &hallActions[0][0], HALL_BUTTON_COUNT, &diagCtx);
   }
 
-  // Load configured keybinds (defaults preserved on first boot)
-  keybindsLoadFromPrefs(PREFS_NAMESPACE, hallActions, HALL_BUTTON_COUNT);
-
-  // Initialize AS5600 Hall Effect Sensor
-  as5600.begin();
+  // Load configured keymap layers (defaults preserved on first boot)
+  keybindsLoadLayersFromPrefs(PREFS_NAMESPACE, g_layerCount, g_layerKnob);
+  g_gamepadMode = keybindsLoadGamepadFromPrefs(PREFS_NAMESPACE);
+  {
+    uint8_t midiChannel = 1;
+    keybindsLoadMidiFromPrefs(PREFS_NAMESPACE, g_midiMode, midiChannel, g_midiBaseNote, g_midiKnobCc);
+    if (g_midiMode) {
+      midiOutBegin(midiChannel);
+    }
+  }
+  for (size_t layer = 0; layer < g_layerCount; layer++) {
+    keybindsLoadFromPrefs(PREFS_NAMESPACE, hallActions[layer], HALL_BUTTON_COUNT, hallPrograms[layer], layer);
+    keybindsLoadHoldFromPrefs(PREFS_NAMESPACE, hallHoldActions[layer], HALL_BUTTON_COUNT, holdPrograms[layer], layer);
+  }
+  // A blank tap or hold on an upper layer does what it does on layer 1.
+  for (size_t layer = 1; layer < g_layerCount; layer++) {
+    for (size_t idx = 0; idx < HALL_BUTTON_COUNT; idx++) {
+      if (hallActions[layer][idx].length() == 0) {
+        hallPrograms[layer][idx] = hallPrograms[0][idx];
+      }
+      if (hallHoldActions[layer][idx].length() == 0) {
+        holdPrograms[layer][idx] = holdPrograms[0][idx];
+      }
+    }
+  }
+  {
+    uint8_t comboKeys[ComboEngine::MAX_COMBOS];
+    uint16_t comboWindowMs[ComboEngine::MAX_COMBOS];
+    keybindsLoadCombosFromPrefs(PREFS_NAMESPACE, comboKeys, comboActions, comboWindowMs, ComboEngine::MAX_COMBOS, comboPrograms);
+    for (size_t c = 0; c < ComboEngine::MAX_COMBOS; c++) {
+      g_combos.configure(c, comboKeys[c], comboWindowMs[c]);
+    }
+  }
+  {
+    uint8_t socdKeys[SocdResolver::MAX_PAIRS];
+    uint8_t socdPolicy[SocdResolver::MAX_PAIRS];
+    keybindsLoadSocdFromPrefs(PREFS_NAMESPACE, socdKeys, socdPolicy, SocdResolver::MAX_PAIRS);
+    for (size_t p = 0; p < SocdResolver::MAX_PAIRS; p++) {
+      g_socd.configure(p, socdKeys[p], (SocdPolicy)socdPolicy[p]);
+    }
+  }
+  {
+    uint8_t tapHoldMode[HALL_BUTTON_COUNT];
+    uint16_t tapHoldTermMs[HALL_BUTTON_COUNT];
+    keybindsLoadTapHoldFromPrefs(PREFS_NAMESPACE, tapHoldMode, tapHoldTermMs, HALL_BUTTON_COUNT);
+    for (size_t idx = 0; idx < HALL_BUTTON_COUNT; idx++) {
+      g_tapHold.configure(idx, (TapHoldMode)tapHoldMode[idx], tapHoldTermMs[idx]);
+    }
+  }
+  {
+    uint8_t depthPercent[KEY_DEPTH_POINTS * HALL_BUTTON_COUNT];
+    keybindsLoadDepthFromPrefs(PREFS_NAMESPACE, depthActions, depthPercent, HALL_BUTTON_COUNT, depthPrograms);
+    for (size_t idx = 0; idx < HALL_BUTTON_COUNT; idx++) {
+      // A point without an action gets no threshold, which also ends the list.
+      uint8_t points[KEY_DEPTH_POINTS];
+      for (size_t point = 0; point < KEY_DEPTH_POINTS; point++) {
+        const size_t slot = point * HALL_BUTTON_COUNT + idx;
+        points[point] = (depthActions[slot].length() > 0) ? depthPercent[slot] : 0;
+      }
+      hall[idx]->setDepthPoints(points);
+    }
+  }
+  {
+    uint8_t rapidTrigger[HALL_BUTTON_COUNT];
+    keybindsLoadRapidTriggerFromPrefs(PREFS_NAMESPACE, rapidTrigger, HALL_BUTTON_COUNT);
+    for (size_t idx = 0; idx < HALL_BUTTON_COUNT; idx++) {
+      hall[idx]->setRapidTrigger(rapidTrigger[idx]);
+    }
+  }
+  {
+    uint8_t actuationPress[HALL_BUTTON_COUNT];
+    uint8_t actuationRelease[HALL_BUTTON_COUNT];
+    keybindsLoadActuationFromPrefs(PREFS_NAMESPACE, actuationPress, actuationRelease, HALL_BUTTON_COUNT);
+    for (size_t idx = 0; idx < HALL_BUTTON_COUNT; idx++) {
+      hall[idx]->setActuation(actuationPress[idx], actuationRelease[idx]);
+    }
+  }
 
   // LED Strip Animation
   ledCycle(leds_75, NUM_LEDS_SCREENARRAY);
@@ -802,7 +1264,7 @@ void setup() {
 
   // Set Precision variables for all 6 hall effect sensors
   int setPrecisionTemp = 3;
-  for(size_t idx = 1; idx < HALL_BUTTON_COUNT; idx++) { // 6 Hall Effect Sensors
+  for(size_t idx = 0; idx < HALL_BUTTON_COUNT; idx++) { // 6 Hall Effect Sensors
     hall[idx]->setPrecision(setPrecisionTemp);
   }
 
@@ -847,6 +1309,7 @@ void setup() {
    */
   if (LTBTN.checkTrig(0)){
         initializeKronos();
+        hallCalibrationSaveIfChanged(PREFS_NAMESPACE, hall, HALL_BUTTON_COUNT);
   }
     initializedK = true;
     scanEnabled = true;
@@ -881,19 +1344,32 @@ void loop() {
     );
   }
 
-  if(digitalRead(BUTTON_PIN) == HIGH) { // if button is not pressed
+  if(digitalRead(BUTTON_PIN) == HIGH && !g_menuRequested) { // if button is not pressed
     if (maintimer.timeOver() && (maintimer.timerRunning == 1) ){ // if timer is over
       timerEnd(); 
     }
     else{ 
-      screenRender(ScreenId::SensorReadings, 0, 0);
+      // Flash the layer name for a moment whenever the layer changes.
+      const uint8_t layer = g_activeLayer;
+      if (layer != shownLayer) {
+        shownLayer = layer;
+        layerShownMillis = millis();
+      }
+      if (g_layerCount > 1 && (millis() - layerShownMillis) < LAYER_SCREEN_MS) {
+        screenRender(ScreenId::Layer, 0, layer);
+      }
+      else {
+        screenRender(ScreenId::SensorReadings, 0, 0);
+      }
       vTaskDelay(pdMS_TO_TICKS(5));
     }
   }
-  else { // if button is pressed
+  else { // if button is pressed (or a MENU action asked for the menu)
+    g_menuRequested = false;
+    g_menuOpen = true;
     timerMenu();
     vTaskDelay(pdMS_TO_TICKS(50));
-    initializedK = true; // re-initializing Kronos to allow for infinite scan
+    g_menuOpen = false; // keybinds back on
   }
   duration = micros() - start;
 
@@ -0,0 +1,167 @@
+#include "midi_out.h"
+
+#include <BLEDevice.h>
+#include <BLE2902.h>
+
+static constexpr const char* MIDI_SERVICE_UUID = "03b80e5a-ede8-4b33-a751-6ce34ec4c700";
+static constexpr const char* MIDI_CHARACTERISTIC_UUID = "7772e5db-3868-4112-a1a9-f2669d106bf3";
+static constexpr uint32_t MIDI_TASK_STACK = 3072;
+static constexpr UBaseType_t MIDI_TASK_PRIORITY = 1;  // Same as the HID worker
+// Header + (timestamp + 3 bytes) per message within the default 20-byte ATT payload.
+static constexpr size_t MIDI_PACKET_BYTES = 20;
+static constexpr size_t MIDI_MESSAGE_BYTES = 4;
+// How long midiOutBegin() waits for BleKeyboard's task to create its server.
+static constexpr uint32_t MIDI_SERVER_WAIT_MS = 2000;
+
+struct MidiMessage {
+  uint8_t bytes[3];
+  uint32_t timestampUs;
+};
+
+static QueueHandle_t g_queue = nullptr;
+static TaskHandle_t g_midiTask = nullptr;
+static BLECharacteristic* g_characteristic = nullptr;
+static BLE2902* g_cccd = nullptr;
+static uint8_t g_channel = 0;  // 0-based
+
+static volatile uint32_t g_sent = 0;
+static volatile uint32_t g_packets = 0;
+static volatile uint32_t g_dropped = 0;
+static volatile uint8_t g_lastVelocity = 0;
+
+static bool subscribed() {
+  return g_cccd != nullptr && g_cccd->getNotifications();
+}
+
+static void midiTask(void* parameters) {
+  (void)parameters;
+  uint8_t packet[MIDI_PACKET_BYTES];
+  MidiMessage msg;
+  for (;;) {
+    if (xQueueReceive(g_queue, &msg, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+    // Everything waiting goes out in one packet while it shares the
+    // header's upper timestamp bits.
+    const uint16_t ms = (uint16_t)((msg.timestampUs / 1000U) & 0x1FFF);
+    const uint8_t high = (uint8_t)(ms >> 7);
+    size_t len = 0;
+    size_t count = 0;
+    packet[len++] = (uint8_t)(0x80 | high);
+    for (;;) {
+      const uint16_t msgMs = (uint16_t)((msg.timestampUs / 1000U) & 0x1FFF);
+      packet[len++] = (uint8_t)(0x80 | (msgMs & 0x7F));
+      memcpy(&packet[len], msg.bytes, sizeof(msg.bytes));
+      len += sizeof(msg.bytes);
+      count++;
+      if (len + MIDI_MESSAGE_BYTES > MIDI_PACKET_BYTES) {
+        break;
+      }
+      MidiMessage next;
+      if (xQueuePeek(g_queue, &next, 0) != pdTRUE ||
+          (uint8_t)(((next.timestampUs / 1000U) & 0x1FFF) >> 7) != high) {
+        break;
+      }
+      (void)xQueueReceive(g_queue, &msg, 0);
+    }
+
+    if (!subscribed()) {
+      g_dropped = g_dropped + count;
+      continue;
+    }
+    g_characteristic->setValue(packet, len);
+    g_characteristic->notify();
+    g_sent = g_sent + count;
+    g_packets = g_packets + 1;
+  }
+}
+
+void midiOutBegin(uint8_t channel) {
+  if (g_midiTask != nullptr) {
+    return;
+  }
+  g_channel = (uint8_t)((channel >= 1 && channel <= 16) ? channel - 1 : 0);
+
+  // The service goes on the keyboard's own server: BLEDevice hands GATT
+  // events only to the last server created, so a second one would cut
+  // BleKeyboard off from connect/disconnect (and its re-advertising).
+  BLEServer* server = BLEDevice::getServer();
+  for (uint32_t waited = 0; server == nullptr && waited < MIDI_SERVER_WAIT_MS; waited += 10) {
+    vTaskDelay(pdMS_TO_TICKS(10));
+    server = BLEDevice::getServer();
+  }
+  if (server == nullptr) {
+    Serial.println(F("[midi] keyboard BLE server not up, MIDI off"));
+    return;
+  }
+  BLEService* service = server->createService(MIDI_SERVICE_UUID);
+  g_characteristic = service->createCharacteristic(
+    MIDI_CHARACTERISTIC_UUID,
+    BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_WRITE_NR | BLECharacteristic::PROPERTY_NOTIFY);
+  g_cccd = new BLE2902();
+  g_characteristic->addDescriptor(g_cccd);
+  service->start();
+
+  // The keyboard's advertising packet is full; MIDI hosts find the service
+  // UUID in the scan response.
+  BLEAdvertising* advertising = BLEDevice::getAdvertising();
+  BLEAdvertisementData scanResponse;
+  scanResponse.setCompleteServices(BLEUUID(MIDI_SERVICE_UUID));
+  advertising->setScanResponse(true);
+  advertising->setScanResponseData(scanResponse);
+  advertising->start();
+
+  g_queue = xQueueCreate(MIDI_OUT_QUEUE_DEPTH, sizeof(MidiMessage));
+  if (g_queue == nullptr) {
+    Serial.println(F("[midi] queue alloc failed"));
+    return;
+  }
+  xTaskCreatePinnedToCore(
+    midiTask,
+    "midiOut",
+    MIDI_TASK_STACK,
+    NULL,
+    MIDI_TASK_PRIORITY,
+    &g_midiTask,
+    ARDUINO_RUNNING_CORE
+  );
+  Serial.print(F("[midi] BLE-MIDI on channel "));
+  Serial.println((int)g_channel + 1);
+}
+
+static bool queueMessage(uint8_t status, uint8_t data1, uint8_t data2, uint32_t timestampUs) {
+  if (g_queue == nullptr) {
+    return false;
+  }
+  MidiMessage msg;
+  msg.bytes[0] = (uint8_t)(status | g_channel);
+  msg.bytes[1] = (uint8_t)(data1 & 0x7F);
+  msg.bytes[2] = (uint8_t)(data2 & 0x7F);
+  msg.timestampUs = timestampUs;
+  if (xQueueSend(g_queue, &msg, 0) != pdTRUE) {
+    g_dropped = g_dropped + 1;
+    return false;
+  }
+  return true;
+}
+
+bool midiOutNoteOn(uint8_t note, uint8_t velocity, uint32_t timestampUs) {
+  g_lastVelocity = velocity;
+  return queueMessage(0x90, note, velocity, timestampUs);
+}
+
+bool midiOutNoteOff(uint8_t note, uint32_t timestampUs) {
+  return queueMessage(0x80, note, 0, timestampUs);
+}
+
+bool midiOutControlChange(uint8_t controller, uint8_t value, uint32_t timestampUs) {
+  return queueMessage(0xB0, controller, value, timestampUs);
+}
+
+void midiOutGetStats(MidiOutStats& out) {
+  out.subscribed = subscribed();
+  out.sent = g_sent;
+  out.packets = g_packets;
+  out.dropped = g_dropped;
+  out.lastVelocity = g_lastVelocity;
+}
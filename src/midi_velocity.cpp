@@ -0,0 +1,69 @@
+#include "midi_velocity.h"
+
+#include <math.h>
+
+// Time at which travel crossed `threshold` between two samples, assuming a
+// straight line between them.
+static uint32_t crossingUs(uint16_t fromTravel, uint32_t fromUs, uint16_t toTravel, uint32_t toUs, uint16_t threshold) {
+  if (toTravel == fromTravel) {
+    return toUs;
+  }
+  const int32_t span = (int32_t)toTravel - (int32_t)fromTravel;
+  const int32_t part = (int32_t)threshold - (int32_t)fromTravel;
+  const uint32_t dt = toUs - fromUs;
+  return fromUs + (uint32_t)(((int64_t)dt * part) / span);
+}
+
+uint8_t MidiVelocityTracker::velocityForUs(uint32_t us) {
+  if (us <= MIDI_FASTEST_US) {
+    return 127;
+  }
+  if (us >= MIDI_SLOWEST_US) {
+    return 1;
+  }
+  // Equal velocity steps for equal ratios of speed, like a piano action.
+  const float span = logf((float)MIDI_SLOWEST_US / (float)MIDI_FASTEST_US);
+  const float pos = logf((float)MIDI_SLOWEST_US / (float)us) / span;
+  const int velocity = 1 + (int)(pos * 126.0f + 0.5f);
+  return (uint8_t)((velocity > 127) ? 127 : velocity);
+}
+
+MidiVelocityTracker::Event MidiVelocityTracker::update(uint16_t travel, uint32_t timestampUs, uint8_t& velocity, uint32_t& strikeUs) {
+  const uint16_t prevTravel = haveLast ? lastTravel : 0;
+  const uint32_t prevUs = haveLast ? lastUs : timestampUs;
+  lastTravel = travel;
+  lastUs = timestampUs;
+  haveLast = true;
+
+  if (sounding) {
+    if (travel < MIDI_RELEASE_TRAVEL) {
+      sounding = false;
+      moving = (travel >= MIDI_START_TRAVEL);
+      startUs = timestampUs;
+      return NoteOff;
+    }
+    return None;
+  }
+
+  if (travel < MIDI_START_TRAVEL) {
+    moving = false;
+    return None;
+  }
+  if (!moving) {
+    moving = true;
+    startUs = (prevTravel < MIDI_START_TRAVEL)
+                ? crossingUs(prevTravel, prevUs, travel, timestampUs, MIDI_START_TRAVEL)
+                : timestampUs;
+  }
+  if (travel < MIDI_STRIKE_TRAVEL) {
+    return None;
+  }
+
+  strikeUs = (prevTravel < MIDI_STRIKE_TRAVEL)
+               ? crossingUs(prevTravel, prevUs, travel, timestampUs, MIDI_STRIKE_TRAVEL)
+               : timestampUs;
+  velocity = velocityForUs(strikeUs - startUs);
+  sounding = true;
+  moving = false;
+  return NoteOn;
+}
@@ -0,0 +1,316 @@
+#include "mxgicAdsPipeline.h"
+
+// Nominal conversion time per ADS1115 data-rate code (8..860 SPS).
+static const uint32_t kConvTimeUs[8] = {125000, 62500, 31250, 15625, 7813, 4000, 2106, 1163};
+
+static const uint16_t kMuxForChannel[MxgicAdsPipeline::CHANNEL_COUNT] = {
+  ADS1X15_REG_CONFIG_MUX_SINGLE_0,
+  ADS1X15_REG_CONFIG_MUX_SINGLE_1,
+  ADS1X15_REG_CONFIG_MUX_SINGLE_2,
+  ADS1X15_REG_CONFIG_MUX_SINGLE_3,
+};
+
+static uint32_t g_frameTimeUs = 0;
+static uint32_t g_frameCount = 0;
+
+void IRAM_ATTR MxgicAdsPipeline::onAlert(void* arg) {
+  MxgicAdsPipeline* self = static_cast<MxgicAdsPipeline*>(arg);
+  self->readyFlag = true;
+  TaskHandle_t task = self->waiter;
+  if (task != nullptr) {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(task, &woken);
+    portYIELD_FROM_ISR(woken);
+  }
+}
+
+bool MxgicAdsPipeline::begin(Adafruit_ADS1115& ads, uint8_t i2cAddr, int8_t alertPinSel) {
+  addr = i2cAddr;
+  alertPin = alertPinSel;
+
+  const uint16_t rate = ads.getDataRate();
+  convTimeUs = kConvTimeUs[(rate >> 5) & 0x07];
+  configBase = ADS1X15_REG_CONFIG_CQUE_1CONV |
+               ADS1X15_REG_CONFIG_CLAT_NONLAT |
+               ADS1X15_REG_CONFIG_CPOL_ACTVLOW |
+               ADS1X15_REG_CONFIG_CMODE_TRAD |
+               ADS1X15_REG_CONFIG_MODE_SINGLE |
+               (uint16_t)ads.getGain() |
+               rate;
+
+  if (lock == nullptr) {
+    lock = xSemaphoreCreateMutex();
+  }
+
+  // Hi_thresh MSB = 1 and Lo_thresh MSB = 0 turns ALERT/RDY into a
+  // conversion-ready output (asserts low at the end of every conversion).
+  if (!writeRegister(ADS1X15_REG_POINTER_HITHRESH, 0x8000) ||
+      !writeRegister(ADS1X15_REG_POINTER_LOWTHRESH, 0x0000)) {
+    return false;
+  }
+
+  if (alertPin >= 0) {
+    pinMode(alertPin, INPUT_PULLUP);
+    attachInterruptArg(digitalPinToInterrupt(alertPin), onAlert, this, FALLING);
+  }
+
+  if (channelMask == 0) {
+    channelMask = 0x01;
+  }
+  // Idle until the first reader asks for a channel.
+  inFlightCh = -1;
+  started = true;
+  return true;
+}
+
+void MxgicAdsPipeline::setDataRate(uint16_t rate) {
+  rate &= RATE_MASK;
+  if (lock != nullptr) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+  }
+  configBase = (uint16_t)((configBase & ~RATE_MASK) | rate);
+  convTimeUs = kConvTimeUs[(rate >> 5) & 0x07];
+  if (lock != nullptr) {
+    xSemaphoreGive(lock);
+  }
+}
+
+void MxgicAdsPipeline::enableChannel(uint8_t ch) {
+  if (ch < CHANNEL_COUNT) {
+    channelMask |= (uint8_t)(1U << ch);
+  }
+}
+
+// Channel to start once `doneCh` has finished: an unmet demand first (the
+// same channel again if the finished conversion is too old for it), else the
+// next enabled channel, or none (-1) past the end of a frame.
+int8_t MxgicAdsPipeline::nextChannel(uint8_t doneCh, uint32_t doneStart) const {
+  const int8_t demand = demandCh;
+  if (demand >= 0 && !(demand == (int8_t)doneCh && doneStart > demandAfter)) {
+    return demand;
+  }
+  if (stopAfterCh >= 0 && (int8_t)doneCh == stopAfterCh) {
+    return -1;
+  }
+  for (uint8_t step = 1; step <= CHANNEL_COUNT; step++) {
+    const uint8_t ch = (uint8_t)((doneCh + step) % CHANNEL_COUNT);
+    if (channelMask & (1U << ch)) {
+      return (int8_t)ch;
+    }
+  }
+  return (int8_t)doneCh;
+}
+
+uint8_t MxgicAdsPipeline::lastChannel() const {
+  for (uint8_t ch = CHANNEL_COUNT; ch > 0; ch--) {
+    if (channelMask & (1U << (ch - 1))) {
+      return (uint8_t)(ch - 1);
+    }
+  }
+  return 0;
+}
+
+void MxgicAdsPipeline::startConversion(uint8_t ch) {
+  readyFlag = false;
+  inFlightCh = (int8_t)ch;
+  starts = starts + 1;
+  inFlightStart = starts;
+  convStartUs = micros();
+  writeRegister(ADS1X15_REG_POINTER_CONFIG, configBase | ADS1X15_REG_CONFIG_OS_SINGLE | kMuxForChannel[ch]);
+}
+
+// Asks for a sample of `ch` started after count `after`; an idle chip starts
+// it right away.
+void MxgicAdsPipeline::request(uint8_t ch, uint32_t after) {
+  xSemaphoreTake(lock, portMAX_DELAY);
+  demandAfter = after;
+  demandCh = (int8_t)ch;
+  if (inFlightCh < 0) {
+    startConversion(ch);
+  }
+  xSemaphoreGive(lock);
+}
+
+bool MxgicAdsPipeline::conversionReady() {
+  if (alertPin >= 0) {
+    return readyFlag;
+  }
+  // No RDY line: don't touch the bus before the conversion can possibly be done.
+  if ((uint32_t)(micros() - convStartUs) < convTimeUs) {
+    return false;
+  }
+  uint16_t config = 0;
+  if (!readRegister(ADS1X15_REG_POINTER_CONFIG, config)) {
+    return false;
+  }
+  return (config & ADS1X15_REG_CONFIG_OS_NOTBUSY) != 0;
+}
+
+bool MxgicAdsPipeline::poll() {
+  if (!started || inFlightCh < 0) {
+    return false;
+  }
+
+  xSemaphoreTake(lock, portMAX_DELAY);
+  if (!conversionReady()) {
+    xSemaphoreGive(lock);
+    return false;
+  }
+
+  // Start the next conversion before reading back the finished one.
+  const uint8_t doneCh = (uint8_t)inFlightCh;
+  const uint32_t doneStart = inFlightStart;
+  const int8_t next = nextChannel(doneCh, doneStart);
+  if (next >= 0) {
+    startConversion((uint8_t)next);
+  } else {
+    inFlightCh = -1;
+  }
+
+  uint16_t result = 0;
+  const bool ok = readRegister(ADS1X15_REG_POINTER_CONVERT, result);
+  if (ok) {
+    // Single-ended readings are never meaningfully negative; clamp noise below 0.
+    values[doneCh] = ((int16_t)result < 0) ? 0 : result;
+    sampleStart[doneCh] = doneStart;
+    seq[doneCh] = seq[doneCh] + 1;
+  }
+  xSemaphoreGive(lock);
+  return ok;
+}
+
+void MxgicAdsPipeline::waitForReady() {
+  if (alertPin >= 0) {
+    waiter = xTaskGetCurrentTaskHandle();
+    if (!readyFlag) {
+      // Timeout is only a safety net in case an edge is missed.
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(2) + 1);
+    }
+    waiter = nullptr;
+    return;
+  }
+
+  const uint32_t elapsed = (uint32_t)(micros() - convStartUs);
+  if (elapsed >= convTimeUs) {
+    delayMicroseconds(50);
+  } else if ((convTimeUs - elapsed) >= (uint32_t)portTICK_PERIOD_MS * 1000UL) {
+    vTaskDelay(1);
+  } else {
+    delayMicroseconds(convTimeUs - elapsed);
+  }
+}
+
+uint16_t MxgicAdsPipeline::read(uint8_t ch) {
+  if (ch >= CHANNEL_COUNT) {
+    return 0;
+  }
+  enableChannel(ch);
+  if (!started) {
+    return values[ch];
+  }
+  return readAfter(ch, starts);
+}
+
+uint16_t MxgicAdsPipeline::readAfter(uint8_t ch, uint32_t after) {
+  request(ch, after);
+  while (!fresh(ch, after)) {
+    if (!poll()) {
+      waitForReady();
+    }
+  }
+  demandCh = -1;
+  return values[ch];
+}
+
+bool MxgicAdsPipeline::writeRegister(uint8_t reg, uint16_t value) {
+  Wire.beginTransmission(addr);
+  Wire.write(reg);
+  Wire.write((uint8_t)(value >> 8));
+  Wire.write((uint8_t)(value & 0xFF));
+  return Wire.endTransmission() == 0;
+}
+
+bool MxgicAdsPipeline::readRegister(uint8_t reg, uint16_t& value) {
+  Wire.beginTransmission(addr);
+  Wire.write(reg);
+  if (Wire.endTransmission() != 0) {
+    return false;
+  }
+  if (Wire.requestFrom(addr, (uint8_t)2) != 2) {
+    return false;
+  }
+  const uint8_t hi = (uint8_t)Wire.read();
+  const uint8_t lo = (uint8_t)Wire.read();
+  value = (uint16_t)((hi << 8) | lo);
+  return true;
+}
+
+void adsPipelineReadFrame(MxgicAdsPipeline& a, MxgicAdsPipeline& b, AdsScanMode mode) {
+  const uint32_t startUs = micros();
+  a.stopAfterCh = (int8_t)a.lastChannel();
+  b.stopAfterCh = (int8_t)b.lastChannel();
+
+  // Nothing started before this point counts for the frame.
+  const uint32_t afterA = a.starts;
+  const uint32_t afterB = b.starts;
+
+  if (mode == AdsScanMode::Serialized) {
+    for (uint8_t ch = 0; ch < MxgicAdsPipeline::CHANNEL_COUNT; ch++) {
+      if (a.started && (a.enabledChannels() & (1U << ch))) (void)a.readAfter(ch, afterA);
+    }
+    for (uint8_t ch = 0; ch < MxgicAdsPipeline::CHANNEL_COUNT; ch++) {
+      if (b.started && (b.enabledChannels() & (1U << ch))) (void)b.readAfter(ch, afterB);
+    }
+  } else {
+    for (uint8_t ch = 0; ch < MxgicAdsPipeline::CHANNEL_COUNT; ch++) {
+      const bool useA = a.started && (a.enabledChannels() & (1U << ch));
+      const bool useB = b.started && (b.enabledChannels() & (1U << ch));
+      if (!useA && !useB) {
+        continue;
+      }
+
+      // Ask both chips for the same channel (idle chips start it at once, so
+      // the first channel starts on both together), then service both until
+      // each has delivered it. Whichever finishes first starts its next
+      // channel at once.
+      if (useA) a.request(ch, afterA);
+      if (useB) b.request(ch, afterB);
+
+      bool pendingA = useA && !a.fresh(ch, afterA);
+      bool pendingB = useB && !b.fresh(ch, afterB);
+      while (pendingA || pendingB) {
+        bool progressed = false;
+        if (pendingA) {
+          progressed |= a.poll();
+          pendingA = !a.fresh(ch, afterA);
+        }
+        if (pendingB) {
+          progressed |= b.poll();
+          pendingB = !b.fresh(ch, afterB);
+        }
+        if (!progressed && (pendingA || pendingB)) {
+          if (pendingA) {
+            a.waitForReady();
+          } else {
+            b.waitForReady();
+          }
+        }
+      }
+      a.demandCh = -1;
+      b.demandCh = -1;
+    }
+  }
+
+  const uint32_t elapsedUs = (uint32_t)(micros() - startUs);
+  // Light smoothing (1/8) so diagnostics show a stable number.
+  g_frameTimeUs = (g_frameTimeUs == 0) ? elapsedUs : (g_frameTimeUs - (g_frameTimeUs >> 3) + (elapsedUs >> 3));
+  g_frameCount++;
+}
+
+uint32_t adsPipelineFrameTimeUs() {
+  return g_frameTimeUs;
+}
+
+uint32_t adsPipelineFrameCount() {
+  return g_frameCount;
+}
@@ -0,0 +1,287 @@
+#include "sensor_acq.h"
+
+#include <atomic>
+
+#include "mxgicRotary.h"
+
+static constexpr uint32_t ACQ_TASK_STACK = 4096;
+static constexpr UBaseType_t ACQ_TASK_PRIORITY = 3;
+// Keep the bus owner off the Arduino core so key scanning and UI never
+// compete with it for CPU.
+static constexpr BaseType_t ACQ_TASK_CORE = (ARDUINO_RUNNING_CORE == 0) ? 1 : 0;
+
+static std::atomic<uint32_t> g_seq{0};
+static SensorSnapshot g_snapshot;
+
+static volatile AdsScanMode g_scanMode = AdsScanMode::Interleaved;
+static volatile TaskHandle_t g_frameListener = nullptr;
+static volatile TaskHandle_t g_startWaiter = nullptr;
+static TaskHandle_t g_acqTask = nullptr;
+static volatile uint32_t g_frameIntervalUs = 0;
+
+// Filter state is only touched by the acquisition task; settings changes are
+// handed over through g_filterGen.
+static MxgicFilter g_hallFilter[SENSOR_ADC_COUNT][SENSOR_ADC_CHANNELS];
+static volatile HallFilterMode g_filterMode = HallFilterMode::Off;
+static volatile uint8_t g_filterStrength = 2;
+static volatile uint32_t g_filterGen = 0;
+
+// Data-rate governor. Rates are ADS1115 config codes. 475 SPS roughly
+// halves the noise of 860 SPS and keeps an idle frame (three interleaved
+// conversions) near 6 ms, so the first press is not noticeably late.
+static constexpr uint16_t ACQ_RATE_ACTIVE = RATE_ADS1115_860SPS;
+static constexpr uint16_t ACQ_RATE_IDLE = RATE_ADS1115_475SPS;
+static constexpr uint32_t ACQ_IDLE_AFTER_MS = 1500;
+// Raw counts a channel must move from its rest value to count as movement;
+// well above the noise at either rate.
+static constexpr uint16_t ACQ_MOTION_COUNTS = 40;
+
+// Without ALERT/RDY the pipeline busy-waits the sub-tick tail of every
+// conversion, so the task never blocks on its own; sleep one tick this often
+// to let the idle task (watchdog) and lower priorities on this core run.
+static constexpr uint32_t ACQ_POLL_YIELD_MS = 10;
+
+static volatile bool g_governorEnabled = true;
+static volatile bool g_keysHeld = false;
+// Governor state; only the acquisition task writes it.
+static uint16_t g_restRaw[SENSOR_ADC_COUNT][SENSOR_ADC_CHANNELS] = {};
+static uint32_t g_lastMotionMs = 0;
+static volatile bool g_rateIdle = false;
+static volatile uint32_t g_rateToIdle = 0;
+static volatile uint32_t g_rateToActive = 0;
+static uint32_t g_idleSinceMs = 0;
+static volatile uint32_t g_idleTotalMs = 0;
+
+static void applyDataRate(bool idle, uint32_t nowMs) {
+  const uint16_t rate = idle ? ACQ_RATE_IDLE : ACQ_RATE_ACTIVE;
+  adsPipe1.setDataRate(rate);
+  adsPipe2.setDataRate(rate);
+  if (idle) {
+    g_idleSinceMs = nowMs;
+    g_rateToIdle = g_rateToIdle + 1;
+  } else {
+    g_idleTotalMs = g_idleTotalMs + (nowMs - g_idleSinceMs);
+    g_rateToActive = g_rateToActive + 1;
+  }
+  g_rateIdle = idle;
+}
+
+// Runs once per frame on the unfiltered values, before the next frame.
+static void governRate(const SensorSnapshot& snap, uint32_t nowMs) {
+  bool moving = g_keysHeld;
+  for (uint8_t sel = 0; sel < SENSOR_ADC_COUNT; sel++) {
+    for (uint8_t ch = 0; ch < SENSOR_ADC_CHANNELS; ch++) {
+      const uint16_t raw = snap.hallUnfiltered[sel][ch];
+      uint16_t& rest = g_restRaw[sel][ch];
+      const uint16_t delta = (raw > rest) ? (uint16_t)(raw - rest) : (uint16_t)(rest - raw);
+      if (delta > ACQ_MOTION_COUNTS) {
+        moving = true;
+        rest = raw;
+      } else {
+        // Follow slow drift (temperature) without ever counting it as movement.
+        rest = (uint16_t)((int32_t)rest + (((int32_t)raw - (int32_t)rest) >> 6));
+      }
+    }
+  }
+
+  if (moving || !g_governorEnabled) {
+    g_lastMotionMs = nowMs;
+    if (g_rateIdle) {
+      applyDataRate(false, nowMs);
+    }
+  } else if (!g_rateIdle && (uint32_t)(nowMs - g_lastMotionMs) >= ACQ_IDLE_AFTER_MS) {
+    applyDataRate(true, nowMs);
+  }
+}
+
+static void publishSnapshot(const SensorSnapshot& snap) {
+  const uint32_t seq = g_seq.load(std::memory_order_relaxed);
+  g_seq.store(seq + 1, std::memory_order_relaxed);  // odd: write in progress
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy((void*)&g_snapshot, &snap, sizeof(SensorSnapshot));
+  std::atomic_thread_fence(std::memory_order_release);
+  g_seq.store(seq + 2, std::memory_order_release);
+}
+
+void sensorAcqRead(SensorSnapshot& out) {
+  for (;;) {
+    const uint32_t before = g_seq.load(std::memory_order_acquire);
+    if (before & 1U) {
+      continue;
+    }
+    memcpy(&out, (const void*)&g_snapshot, sizeof(SensorSnapshot));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (g_seq.load(std::memory_order_relaxed) == before) {
+      return;
+    }
+  }
+}
+
+static void sensorAcqTask(void* parameters) {
+  (void)parameters;
+  SensorSnapshot snap;
+  uint32_t filterGen = g_filterGen - 1;
+  uint32_t lastYieldMs = millis();
+  for (;;) {
+    if (filterGen != g_filterGen) {
+      filterGen = g_filterGen;
+      for (uint8_t sel = 0; sel < SENSOR_ADC_COUNT; sel++) {
+        for (uint8_t ch = 0; ch < SENSOR_ADC_CHANNELS; ch++) {
+          g_hallFilter[sel][ch].configure(g_filterMode, g_filterStrength);
+        }
+      }
+    }
+
+    adsPipelineReadFrame(adsPipe1, adsPipe2, g_scanMode);
+
+    for (uint8_t ch = 0; ch < SENSOR_ADC_CHANNELS; ch++) {
+      snap.hallUnfiltered[0][ch] = adsPipe1.latest(ch);
+      snap.hallUnfiltered[1][ch] = adsPipe2.latest(ch);
+    }
+    for (uint8_t sel = 0; sel < SENSOR_ADC_COUNT; sel++) {
+      for (uint8_t ch = 0; ch < SENSOR_ADC_CHANNELS; ch++) {
+        snap.hallRaw[sel][ch] = g_hallFilter[sel][ch].update(snap.hallUnfiltered[sel][ch]);
+      }
+    }
+    snap.knobRaw = as5600.rawAngle();
+
+    const uint32_t nowUs = micros();
+    if (snap.frame != 0) {
+      const uint32_t intervalUs = nowUs - snap.timestampUs;
+      const uint32_t prev = g_frameIntervalUs;
+      g_frameIntervalUs = (prev == 0) ? intervalUs : (prev - (prev >> 3) + (intervalUs >> 3));
+    }
+    snap.timestampUs = nowUs;
+    snap.frame++;
+    publishSnapshot(snap);
+    const uint32_t nowMs = millis();
+    governRate(snap, nowMs);
+
+    const TaskHandle_t listener = g_frameListener;
+    if (listener != nullptr) {
+      xTaskNotifyGive(listener);
+    }
+    const TaskHandle_t starter = g_startWaiter;
+    if (starter != nullptr) {
+      g_startWaiter = nullptr;
+      xTaskNotifyGive(starter);
+    }
+
+    // With ALERT/RDY on both chips the frame already blocked on the ready
+    // notifications, so go straight on to the next one.
+    if (!adsPipe1.usesAlertPin() || !adsPipe2.usesAlertPin()) {
+      if ((uint32_t)(nowMs - lastYieldMs) >= ACQ_POLL_YIELD_MS) {
+        lastYieldMs = nowMs;
+        vTaskDelay(1);
+      }
+    }
+  }
+}
+
+void sensorAcqStart(AdsScanMode mode) {
+  if (g_acqTask != nullptr) {
+    return;
+  }
+  g_scanMode = mode;
+  g_startWaiter = xTaskGetCurrentTaskHandle();
+  xTaskCreatePinnedToCore(
+    sensorAcqTask,
+    "sensorAcq",
+    ACQ_TASK_STACK,
+    NULL,
+    ACQ_TASK_PRIORITY,
+    &g_acqTask,
+    ACQ_TASK_CORE
+  );
+
+  // Make sure readers never see an empty snapshot: the task notifies us
+  // after its first publish (the timeout is only a safety net).
+  do {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+  } while (g_seq.load(std::memory_order_acquire) == 0);
+  g_startWaiter = nullptr;
+}
+
+bool sensorAcqRunning() {
+  return g_acqTask != nullptr;
+}
+
+void sensorAcqSetScanMode(AdsScanMode mode) {
+  g_scanMode = mode;
+}
+
+AdsScanMode sensorAcqScanMode() {
+  return g_scanMode;
+}
+
+void sensorAcqSetFilter(HallFilterMode mode, uint8_t strength) {
+  if ((uint8_t)mode >= HALL_FILTER_MODE_COUNT) {
+    mode = HallFilterMode::Off;
+  }
+  if (strength < HALL_FILTER_STRENGTH_MIN) strength = HALL_FILTER_STRENGTH_MIN;
+  if (strength > HALL_FILTER_STRENGTH_MAX) strength = HALL_FILTER_STRENGTH_MAX;
+  g_filterMode = mode;
+  g_filterStrength = strength;
+  g_filterGen = g_filterGen + 1;
+}
+
+HallFilterMode sensorAcqFilterMode() {
+  return g_filterMode;
+}
+
+uint8_t sensorAcqFilterStrength() {
+  return g_filterStrength;
+}
+
+void sensorAcqSetRateGovernor(bool enabled) {
+  g_governorEnabled = enabled;
+}
+
+bool sensorAcqRateGovernor() {
+  return g_governorEnabled;
+}
+
+void sensorAcqSetKeysHeld(bool held) {
+  g_keysHeld = held;
+}
+
+void sensorAcqGetRateStats(SensorAcqRateStats& out) {
+  static const uint16_t kSamplesPerSecond[8] = {8, 16, 32, 64, 128, 250, 475, 860};
+  const bool idle = g_rateIdle;
+  out.samplesPerSecond = kSamplesPerSecond[(adsPipe1.dataRate() >> 5) & 0x07];
+  out.idle = idle;
+  out.toIdle = g_rateToIdle;
+  out.toActive = g_rateToActive;
+  out.idleMs = g_idleTotalMs;
+  if (idle) {
+    out.idleMs += (uint32_t)(millis() - g_idleSinceMs);
+  }
+}
+
+uint16_t sensorAcqHallRaw(int adcSel, int adcCh) {
+  if (adcSel < 1 || adcSel > (int)SENSOR_ADC_COUNT || adcCh < 0 || adcCh >= (int)SENSOR_ADC_CHANNELS) {
+    return 0;
+  }
+  SensorSnapshot snap;
+  sensorAcqRead(snap);
+  return snap.hallRaw[adcSel - 1][adcCh];
+}
+
+uint16_t sensorAcqKnobRaw() {
+  SensorSnapshot snap;
+  sensorAcqRead(snap);
+  return snap.knobRaw;
+}
+
+bool sensorAcqWaitFrame(TickType_t timeout) {
+  g_frameListener = xTaskGetCurrentTaskHandle();
+  return ulTaskNotifyTake(pdTRUE, timeout) != 0;
+}
+
+uint32_t sensorAcqFramesPerSecond() {
+  const uint32_t intervalUs = g_frameIntervalUs;
+  if (intervalUs == 0) {
+    return 0;
+  }
+  return 1000000UL / intervalUs;
+}
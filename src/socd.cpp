@@ -0,0 +1,103 @@
+#include "socd.h"
+
+static uint8_t bitCount(uint8_t mask) {
+  uint8_t count = 0;
+  for (; mask != 0; mask &= (uint8_t)(mask - 1)) {
+    count++;
+  }
+  return count;
+}
+
+static size_t keyIndex(uint8_t bit) {
+  size_t key = 0;
+  while (bit > 1) {
+    bit >>= 1;
+    key++;
+  }
+  return key;
+}
+
+void SocdResolver::configure(size_t pair, uint8_t keyMask, SocdPolicy policy) {
+  if (pair >= MAX_PAIRS) {
+    return;
+  }
+  if (bitCount(keyMask) != 2 || (uint8_t)policy >= SOCD_POLICY_COUNT) {
+    policy = SocdPolicy::Off;
+  }
+  pairs[pair].keys = (policy == SocdPolicy::Off) ? 0 : keyMask;
+  pairs[pair].policy = policy;
+  pairs[pair].winner = 0;
+
+  pairedMask = 0;
+  for (size_t p = 0; p < MAX_PAIRS; p++) {
+    pairedMask |= pairs[p].keys;
+  }
+}
+
+// The pair's deeper key; the current winner keeps it unless the other one
+// is deeper by more than the hysteresis. Ties go to the lower key.
+uint8_t SocdResolver::deeper(const Pair& pair, TravelFn travel) {
+  const uint8_t low = (uint8_t)(pair.keys & (uint8_t)-pair.keys);
+  const uint8_t high = (uint8_t)(pair.keys & ~low);
+  if (travel == nullptr) {
+    return (pair.winner != 0) ? pair.winner : low;
+  }
+  const uint16_t lowTravel = travel(keyIndex(low));
+  const uint16_t highTravel = travel(keyIndex(high));
+  if (pair.winner == low) {
+    return (highTravel > lowTravel + SOCD_TRAVEL_HYSTERESIS) ? high : low;
+  }
+  if (pair.winner == high) {
+    return (lowTravel > highTravel + SOCD_TRAVEL_HYSTERESIS) ? low : high;
+  }
+  return (highTravel > lowTravel) ? high : low;
+}
+
+void SocdResolver::update(uint8_t held, uint8_t pressed, uint8_t released, TravelFn travel) {
+  const uint8_t prevOut = heldOut;
+  uint8_t out = held;
+
+  for (size_t p = 0; p < MAX_PAIRS; p++) {
+    Pair& pair = pairs[p];
+    if (pair.keys == 0) {
+      continue;
+    }
+    const uint8_t down = (uint8_t)(held & pair.keys);
+    if (down != pair.keys) {
+      // At most one key down: it acts, and is "first" if the other follows.
+      pair.winner = down;
+      continue;
+    }
+
+    const uint8_t newlyDown = (uint8_t)(pressed & pair.keys);
+    switch (pair.policy) {
+      case SocdPolicy::LastWins:
+        if (newlyDown == pair.keys) {
+          pair.winner = deeper(pair, travel);
+        } else if (newlyDown != 0) {
+          pair.winner = newlyDown;
+        }
+        break;
+      case SocdPolicy::FirstWins:
+        if (newlyDown == pair.keys) {
+          pair.winner = deeper(pair, travel);
+        }
+        break;
+      case SocdPolicy::Neutral:
+        pair.winner = 0;
+        break;
+      case SocdPolicy::DeeperWins:
+        pair.winner = deeper(pair, travel);
+        break;
+      default:
+        break;
+    }
+    out &= (uint8_t)(~pair.keys | pair.winner);
+  }
+
+  heldOut = out;
+  // Unpaired keys keep the scan's edges; paired keys get edges from the
+  // resolved state (a key can start or stop acting without moving).
+  pressedOut = (uint8_t)((pressed & ~pairedMask) | (out & ~prevOut & pairedMask));
+  releasedOut = (uint8_t)((released & ~pairedMask) | (prevOut & ~out & pairedMask));
+}
@@ -0,0 +1,179 @@
+#include "tap_hold.h"
+
+void TapHoldEngine::configure(size_t key, TapHoldMode mode, uint16_t termMs) {
+  if (key >= MAX_KEYS) {
+    return;
+  }
+  if (termMs < TAP_HOLD_TERM_MIN_MS) termMs = TAP_HOLD_TERM_MIN_MS;
+  if (termMs > TAP_HOLD_TERM_MAX_MS) termMs = TAP_HOLD_TERM_MAX_MS;
+  keys[key].mode = mode;
+  keys[key].termMs = termMs;
+}
+
+uint8_t TapHoldEngine::pendingMask() const {
+  uint8_t mask = 0;
+  for (size_t i = 0; i < MAX_KEYS; i++) {
+    if (keys[i].state == Undecided || keys[i].state == Queued) {
+      mask |= (uint8_t)(1U << i);
+    }
+  }
+  return mask;
+}
+
+void TapHoldEngine::startTap(size_t key) {
+  keys[key].state = Tap;
+  taps |= (uint8_t)(1U << key);
+  tapStarted |= (uint8_t)(1U << key);
+}
+
+// Press and release in back-to-back reports: held for this frame only.
+void TapHoldEngine::pulseTap(size_t key) {
+  keys[key].state = Idle;
+  taps |= (uint8_t)(1U << key);
+  tapStarted |= (uint8_t)(1U << key);
+  pulses |= (uint8_t)(1U << key);
+}
+
+void TapHoldEngine::start(size_t key, ActivateFn activate) {
+  if (activate != nullptr && activate(key)) {
+    keys[key].state = Undecided;
+    undecided = (int8_t)key;
+    pressedAfter = 0;
+  } else {
+    startTap(key);
+  }
+}
+
+void TapHoldEngine::resolveHold() {
+  const size_t key = (size_t)undecided;
+  keys[key].state = Hold;
+  holds |= (uint8_t)(1U << key);
+  holdStarted |= (uint8_t)(1U << key);
+  undecided = -1;
+}
+
+void TapHoldEngine::checkTimeout(uint32_t nowMs) {
+  if (undecided >= 0 && (uint32_t)(nowMs - keys[undecided].pressMs) >= keys[undecided].termMs) {
+    resolveHold();
+  }
+}
+
+void TapHoldEngine::update(uint32_t nowMs, uint8_t pressedMask, uint8_t releasedMask, ActivateFn activate) {
+  const uint8_t released = pulses;
+  taps &= (uint8_t)~pulses;
+  pulses = 0;
+  tapStarted = 0;
+  holdStarted = 0;
+  // A tap resolved this frame goes out before anything queued behind it.
+  bool holdQueue = false;
+
+  for (size_t i = 0; i < MAX_KEYS; i++) {
+    const uint8_t bit = (uint8_t)(1U << i);
+    if (!(releasedMask & bit)) {
+      continue;
+    }
+    switch (keys[i].state) {
+      case Undecided:
+        undecided = -1;
+        pulseTap(i);
+        holdQueue = true;
+        break;
+      case Queued:
+        keys[i].releasedWhileQueued = true;
+        if (undecided >= 0 && keys[undecided].mode == TapHoldMode::PermissiveHold && (pressedAfter & bit)) {
+          resolveHold();
+        }
+        break;
+      case Tap:
+        taps &= (uint8_t)~bit;
+        keys[i].state = Idle;
+        break;
+      case Hold:
+        holds &= (uint8_t)~bit;
+        keys[i].state = Idle;
+        break;
+      default:
+        break;
+    }
+  }
+
+  for (size_t i = 0; i < MAX_KEYS; i++) {
+    const uint8_t bit = (uint8_t)(1U << i);
+    if (!(pressedMask & bit)) {
+      continue;
+    }
+    keys[i].pressMs = nowMs;
+    if (undecided >= 0 || queueLength > 0) {
+      if (keys[i].state == Queued) {
+        // Tapped again before it left the queue: replay the earlier tap.
+        if (keys[i].queuedTaps < UINT8_MAX) {
+          keys[i].queuedTaps++;
+        }
+        keys[i].releasedWhileQueued = false;
+      } else if (queueLength < MAX_KEYS) {
+        keys[i].state = Queued;
+        keys[i].releasedWhileQueued = false;
+        keys[i].queuedTaps = 0;
+        queue[queueLength++] = (uint8_t)i;
+      }
+      if (undecided >= 0) {
+        pressedAfter |= bit;
+        if (keys[undecided].mode == TapHoldMode::HoldOnOtherPress) {
+          resolveHold();
+        }
+      }
+    } else {
+      start(i, activate);
+    }
+  }
+
+  checkTimeout(nowMs);
+
+  // Release the queue in press order; stop at the next dual-role key.
+  while (!holdQueue && undecided < 0 && queueLength > 0) {
+    const size_t key = queue[0];
+    if (released & (1U << key)) {
+      // Its replayed tap is going up this frame; the next press waits one.
+      break;
+    }
+    if (keys[key].queuedTaps > 0) {
+      keys[key].queuedTaps--;
+      if (activate != nullptr) {
+        (void)activate(key);
+      }
+      pulseTap(key);
+      keys[key].state = Queued;
+      break;
+    }
+    for (size_t q = 1; q < queueLength; q++) {
+      queue[q - 1] = queue[q];
+    }
+    queueLength--;
+
+    if (keys[key].releasedWhileQueued) {
+      // Already up: whatever it is, it was a tap.
+      if (activate != nullptr) {
+        (void)activate(key);
+      }
+      pulseTap(key);
+      continue;
+    }
+    start(key, activate);
+    if (undecided < 0) {
+      continue;
+    }
+    // Everything still queued was pressed after it.
+    bool releasedAfter = false;
+    for (size_t q = 0; q < queueLength; q++) {
+      pressedAfter |= (uint8_t)(1U << queue[q]);
+      releasedAfter |= keys[queue[q]].releasedWhileQueued;
+    }
+    const TapHoldMode mode = keys[undecided].mode;
+    if ((mode == TapHoldMode::HoldOnOtherPress && queueLength > 0) ||
+        (mode == TapHoldMode::PermissiveHold && releasedAfter)) {
+      resolveHold();
+    } else {
+      checkTimeout(nowMs);
+    }
+  }
+}
@@ -4,6 +4,10 @@
 
 #include "wifi_config.h"
 #include "keybinds.h"
+#include "actions.h"
+#include "tap_hold.h"
+#include "combo.h"
+#include "socd.h"
 #include "diagnostics_web.h"
 
 static String htmlEscape(const String& input) {
@@ -22,9 +26,43 @@ static String htmlEscape(const String& input) {
   return out;
 }
 
-static String buildConfigHtml(const String* actions, size_t actionCount, uint8_t meterStyle, uint8_t ledBrightness, bool enableDiagnostics) {
+static constexpr size_t MAX_PORTAL_BUTTONS = 6;
+
+// Appends an error line for `source` if it doesn't compile.
+static void appendActionError(String& errors, const char* what, size_t layer, size_t idx, String source) {
+  source.trim();
+  ActionProgram program;
+  String error;
+  if (actionCompile(source, program, error)) {
+    return;
+  }
+  errors += F("<li>Layer ");
+  errors += String((int)layer + 1);
+  errors += F(" Button ");
+  errors += String((int)idx + 1);
+  errors += what;
+  errors += F(": ");
+  errors += htmlEscape(error);
+  errors += F("</li>");
+}
+
+static const char* const TAP_HOLD_MODE_LABELS[TAP_HOLD_MODE_COUNT] = {
+  "Timeout",
+  "Permissive hold",
+  "Hold on other key",
+};
+
+static const char* const SOCD_POLICY_LABELS[SOCD_POLICY_COUNT] = {
+  "Off",
+  "Last input wins",
+  "First input wins",
+  "Neutral",
+  "Deeper press wins",
+};
+
+static String buildConfigHtml(const String* actions, const String* holdActions, size_t actionCount, uint8_t layerCount, bool layerKnob, bool gamepadMode, bool midiMode, uint8_t midiChannel, uint8_t midiBaseNote, uint8_t midiKnobCc, uint8_t meterStyle, uint8_t ledBrightness, uint8_t hallFilter, uint8_t hallFilterK, bool rateGovernor, const uint8_t* rapidTrigger, const uint8_t* actuationPress, const uint8_t* actuationRelease, const uint8_t* tapHoldMode, const uint16_t* tapHoldTermMs, const String* depthActions, const uint8_t* depthPercent, const uint8_t* comboKeys, const String* comboActions, const uint16_t* comboWindowMs, const uint8_t* socdKeys, const uint8_t* socdPolicy, bool enableDiagnostics) {
   String html;
-  html.reserve(4600);
+  html.reserve(21000);
   html += F("<!doctype html><html><head><meta charset='utf-8'>");
   html += F("<meta name='viewport' content='width=device-width,initial-scale=1'>");
   html += F("<title>KRONOS WiFi Config</title></head><body>");
@@ -33,6 +71,13 @@ static String buildConfigHtml(const String* actions, size_t actionCount, uint8_t
     html += F("<p><a href='/diag'>Diagnostics</a></p>");
   }
   html += F("<p>Enter either <b>TYPE:</b>text to type, or a key combo like <b>CTRL+SHIFT+Z</b>, <b>GUI+NUM_MINUS</b>, <b>DELETE</b>.</p>");
+  html += F("<p>Or a macro: <b>MACRO:</b>steps separated by <b>;</b> &mdash; <b>PRESS</b> combo, <b>RELEASE</b> combo, <b>TAP</b> combo, <b>HOLD</b> ms combo, <b>WAIT</b> ms, <b>REPEAT</b> n ... <b>END</b>.</p>");
+  html += F("<p><b>LAYER:</b>n makes a key switch to layer n while held. A blank key on layers 2..4 does what it does on layer 1.</p>");
+  html += F("<p><b>Hold</b> makes a key dual-role: tapped it does its action, held it does the hold action (e.g. <b>SHIFT</b> or <b>LAYER:2</b>). ");
+  html += F("Keys without a hold action are never delayed.</p>");
+  html += F("<p>Rapid trigger: the key releases as soon as it rises by this much of its travel and re-actuates as soon as it goes down again.</p>");
+  html += F("<p>Actuation: the key presses at this % of its travel and releases when it rises back above the release %. 0 keeps the fixed threshold.</p>");
+  html += F("<p><b>Depth 2 / 3</b>: pressed past that % of its travel, the key does that action instead (e.g. <b>W</b> with depth 2 <b>SHIFT+W</b> at 70%). Leave blank for a single actuation point.</p>");
   html += F("<form method='POST' action='/save'>");
 
   html += F("<div style='margin:10px 0'>");
@@ -57,17 +102,178 @@ static String buildConfigHtml(const String* actions, size_t actionCount, uint8_t
   html += F("' oninput=\"document.getElementById('b').value=this.value; document.getElementById('b').dispatchEvent(new Event('input'))\"> ");
   html += F("</label></div>");
 
-  for (size_t i = 0; i < actionCount; i++) {
+  html += F("<div style='margin:10px 0'>");
+  html += F("<label>Hall Filter: ");
+  html += F("<select name='hallFilter'>");
+  static const char* const kFilterNames[] = {"Off", "Average (EMA)", "Median of 3", "Adaptive"};
+  for (uint8_t m = 0; m < 4; m++) {
+    html += F("<option value='");
+    html += String((int)m);
+    html += '\'';
+    if (hallFilter == m) html += F(" selected");
+    html += '>';
+    html += kFilterNames[m];
+    html += F("</option>");
+  }
+  html += F("</select></label> ");
+  html += F("<label>Strength: <input type='number' min='1' max='4' style='width:50px' name='hallFilterK' value='");
+  html += String((int)hallFilterK);
+  html += F("'></label></div>");
+
+  html += F("<div style='margin:10px 0'>");
+  html += F("<label><input type='checkbox' name='adsGov' value='1'");
+  if (rateGovernor) html += F(" checked");
+  html += F("> Quiet ADC when idle</label> (slower, less noisy sampling while no key moves; full speed on the first movement)</div>");
+
+  html += F("<div style='margin:10px 0'>");
+  html += F("<label><input type='checkbox' name='gamepad' value='1'");
+  if (gamepadMode) html += F(" checked");
+  html += F("> USB gamepad mode</label> (keys as analog axes + buttons, knob as slider; Bluetooth stays a keyboard)</div>");
+
+  html += F("<div style='margin:10px 0'>");
+  html += F("<label><input type='checkbox' name='midi' value='1'");
+  if (midiMode) html += F(" checked");
+  html += F("> BLE-MIDI mode</label> (keys play notes with velocity, knob sends a CC; replaces keybinds)<br>");
+  html += F("<label>Channel: <input type='number' min='1' max='16' style='width:50px' name='midiCh' value='");
+  html += String((int)midiChannel);
+  html += F("'></label> <label>LT note: <input type='number' min='0' max='121' style='width:60px' name='midiNote' value='");
+  html += String((int)midiBaseNote);
+  html += F("'></label> <label>Knob CC: <input type='number' min='0' max='119' style='width:60px' name='midiCC' value='");
+  html += String((int)midiKnobCc);
+  html += F("'></label></div>");
+
+  html += F("<div style='margin:10px 0'>");
+  html += F("<label>Layers: <select name='layers'>");
+  for (uint8_t n = 1; n <= KEYMAP_MAX_LAYERS; n++) {
+    html += F("<option value='");
+    html += String((int)n);
+    html += '\'';
+    if (layerCount == n) html += F(" selected");
+    html += '>';
+    html += String((int)n);
+    html += F("</option>");
+  }
+  html += F("</select></label> ");
+  html += F("<label><input type='checkbox' name='layerKnob' value='1'");
+  if (layerKnob) html += F(" checked");
+  html += F("> Knob selects layer</label></div>");
+
+  for (size_t layer = 0; layer < KEYMAP_MAX_LAYERS; layer++) {
+    html += F("<h3>Layer ");
+    html += String((int)layer + 1);
+    html += F("</h3>");
+    for (size_t i = 0; i < actionCount; i++) {
+      html += F("<div style='margin:10px 0'>");
+      html += F("<label>");
+      html += F("Button ");
+      html += String((int)i + 1);
+      html += F(": <input style='width:95%' maxlength='220' name='");
+      html += keybindsKeyForButton(i, layer);
+      html += F("' value='");
+      html += htmlEscape(actions[layer * actionCount + i]);
+      html += F("'></label>");
+      html += F("<br><label>Hold: <input style='width:95%' maxlength='220' name='");
+      html += keybindsKeyForHold(i, layer);
+      html += F("' value='");
+      html += htmlEscape(holdActions[layer * actionCount + i]);
+      html += F("'></label>");
+      if (layer == 0) {
+        html += F("<br><label>Tap-hold: <select name='");
+        html += keybindsKeyForTapHoldMode(i);
+        html += F("'>");
+        for (uint8_t m = 0; m < TAP_HOLD_MODE_COUNT; m++) {
+          html += F("<option value='");
+          html += String((int)m);
+          html += F("'");
+          if (tapHoldMode[i] == m) html += F(" selected");
+          html += F(">");
+          html += TAP_HOLD_MODE_LABELS[m];
+          html += F("</option>");
+        }
+        html += F("</select></label> <label>after <input type='number' min='50' max='1000' style='width:70px' name='");
+        html += keybindsKeyForTapHoldTerm(i);
+        html += F("' value='");
+        html += String((int)tapHoldTermMs[i]);
+        html += F("'> ms</label>");
+        html += F("<br><label>Rapid trigger %: <input type='number' min='0' max='50' style='width:60px' name='");
+        html += keybindsKeyForRapidTrigger(i);
+        html += F("' value='");
+        html += String((int)rapidTrigger[i]);
+        html += F("'> (0 = off)</label>");
+        html += F("<br><label>Actuation %: <input type='number' min='0' max='95' style='width:60px' name='");
+        html += keybindsKeyForActuationPress(i);
+        html += F("' value='");
+        html += String((int)actuationPress[i]);
+        html += F("'></label> <label>release %: <input type='number' min='0' max='94' style='width:60px' name='");
+        html += keybindsKeyForActuationRelease(i);
+        html += F("' value='");
+        html += String((int)actuationRelease[i]);
+        html += F("'></label>");
+        for (size_t point = 0; point < KEY_DEPTH_POINTS; point++) {
+          const size_t slot = point * actionCount + i;
+          html += F("<br><label>Depth ");
+          html += String((int)point + 2);
+          html += F(": <input style='width:60%' maxlength='220' name='");
+          html += keybindsKeyForDepthAction(i, point);
+          html += F("' value='");
+          html += htmlEscape(depthActions[slot]);
+          html += F("'></label> <label>at <input type='number' min='10' max='100' style='width:60px' name='");
+          html += keybindsKeyForDepthPercent(i, point);
+          html += F("' value='");
+          html += String((int)depthPercent[slot]);
+          html += F("'> %</label>");
+        }
+      }
+      html += F("</div>");
+    }
+  }
+
+  html += F("<h3>Combos</h3>");
+  html += F("<p>Keys pressed together (e.g. <b>LT+RT</b>) within the window do the combo's action instead. <b>MENU</b> opens the timer menu. Leave the action blank to turn a combo off.</p>");
+  for (size_t c = 0; c < ComboEngine::MAX_COMBOS; c++) {
     html += F("<div style='margin:10px 0'>");
-    html += F("<label>");
-    html += F("Button ");
-    html += String((int)i + 1);
-    html += F(": <input style='width:95%' maxlength='220' name='");
-    html += keybindsKeyForButton(i);
+    html += F("<label>Combo ");
+    html += String((int)c + 1);
+    html += F(" keys: <input style='width:100px' maxlength='20' name='");
+    html += keybindsKeyForComboKeys(c);
+    html += F("' value='");
+    html += keybindsComboKeysToString(comboKeys[c]);
+    html += F("'></label> <label>within <input type='number' min='10' max='200' style='width:60px' name='");
+    html += keybindsKeyForComboWindow(c);
     html += F("' value='");
-    html += htmlEscape(actions[i]);
+    html += String((int)comboWindowMs[c]);
+    html += F("'> ms</label>");
+    html += F("<br><label>Action: <input style='width:95%' maxlength='220' name='");
+    html += keybindsKeyForComboAction(c);
+    html += F("' value='");
+    html += htmlEscape(comboActions[c]);
     html += F("'></label></div>");
   }
+
+  html += F("<h3>Opposing keys (SOCD)</h3>");
+  html += F("<p>Two keys used as opposite directions (e.g. <b>LT+RT</b>). While both are held, the policy decides which one acts.</p>");
+  for (size_t p = 0; p < SocdResolver::MAX_PAIRS; p++) {
+    html += F("<div style='margin:10px 0'>");
+    html += F("<label>Pair ");
+    html += String((int)p + 1);
+    html += F(": <input style='width:100px' maxlength='20' name='");
+    html += keybindsKeyForSocdKeys(p);
+    html += F("' value='");
+    html += keybindsComboKeysToString(socdKeys[p]);
+    html += F("'></label> <select name='");
+    html += keybindsKeyForSocdPolicy(p);
+    html += F("'>");
+    for (uint8_t m = 0; m < SOCD_POLICY_COUNT; m++) {
+      html += F("<option value='");
+      html += String((int)m);
+      html += F("'");
+      if (socdPolicy[p] == m) html += F(" selected");
+      html += F(">");
+      html += SOCD_POLICY_LABELS[m];
+      html += F("</option>");
+    }
+    html += F("</select></div>");
+  }
   html += F("<button type='submit'>Save & Reboot</button>");
   html += F("</form>");
   html += F("</body></html>");
@@ -98,11 +304,52 @@ void startWifiConfigPortal(const char* ssid,
   if (ssid == nullptr || prefsNamespace == nullptr || actions == nullptr || actionCount == 0) {
     return;
   }
+  if (actionCount > MAX_PORTAL_BUTTONS) {
+    actionCount = MAX_PORTAL_BUTTONS;
+  }
 
   // Load existing (or initialize defaults) before serving UI.
-  keybindsLoadFromPrefs(prefsNamespace, actions, actionCount);
+  for (size_t layer = 0; layer < KEYMAP_MAX_LAYERS; layer++) {
+    keybindsLoadFromPrefs(prefsNamespace, actions + layer * actionCount, actionCount, nullptr, layer);
+  }
+  uint8_t layerCount = 1;
+  bool layerKnob = true;
+  keybindsLoadLayersFromPrefs(prefsNamespace, layerCount, layerKnob);
+  bool gamepadMode = keybindsLoadGamepadFromPrefs(prefsNamespace);
+  static bool midiMode = false;
+  static uint8_t midiChannel = 1;
+  static uint8_t midiBaseNote = 60;
+  static uint8_t midiKnobCc = 1;
+  keybindsLoadMidiFromPrefs(prefsNamespace, midiMode, midiChannel, midiBaseNote, midiKnobCc);
   uint8_t meterStyle = keybindsLoadMeterStyleFromPrefs(prefsNamespace);
   uint8_t ledBrightness = keybindsLoadLedBrightnessFromPrefs(prefsNamespace);
+  uint8_t hallFilter = 3;
+  uint8_t hallFilterK = 2;
+  keybindsLoadHallFilterFromPrefs(prefsNamespace, hallFilter, hallFilterK);
+  static bool rateGovernor = true;
+  rateGovernor = keybindsLoadRateGovernorFromPrefs(prefsNamespace);
+  static uint8_t rapidTrigger[MAX_PORTAL_BUTTONS];
+  keybindsLoadRapidTriggerFromPrefs(prefsNamespace, rapidTrigger, actionCount);
+  static uint8_t actuationPress[MAX_PORTAL_BUTTONS];
+  static uint8_t actuationRelease[MAX_PORTAL_BUTTONS];
+  keybindsLoadActuationFromPrefs(prefsNamespace, actuationPress, actuationRelease, actionCount);
+  static String holdActions[KEYMAP_MAX_LAYERS * MAX_PORTAL_BUTTONS];
+  for (size_t layer = 0; layer < KEYMAP_MAX_LAYERS; layer++) {
+    keybindsLoadHoldFromPrefs(prefsNamespace, holdActions + layer * actionCount, actionCount, nullptr, layer);
+  }
+  static uint8_t tapHoldMode[MAX_PORTAL_BUTTONS];
+  static uint16_t tapHoldTermMs[MAX_PORTAL_BUTTONS];
+  keybindsLoadTapHoldFromPrefs(prefsNamespace, tapHoldMode, tapHoldTermMs, actionCount);
+  static String depthActions[KEY_DEPTH_POINTS * MAX_PORTAL_BUTTONS];
+  static uint8_t depthPercent[KEY_DEPTH_POINTS * MAX_PORTAL_BUTTONS];
+  keybindsLoadDepthFromPrefs(prefsNamespace, depthActions, depthPercent, actionCount);
+  static uint8_t comboKeys[ComboEngine::MAX_COMBOS];
+  static String comboActions[ComboEngine::MAX_COMBOS];
+  static uint16_t comboWindowMs[ComboEngine::MAX_COMBOS];
+  keybindsLoadCombosFromPrefs(prefsNamespace, comboKeys, comboActions, comboWindowMs, ComboEngine::MAX_COMBOS);
+  static uint8_t socdKeys[SocdResolver::MAX_PAIRS];
+  static uint8_t socdPolicy[SocdResolver::MAX_PAIRS];
+  keybindsLoadSocdFromPrefs(prefsNamespace, socdKeys, socdPolicy, SocdResolver::MAX_PAIRS);
 
   WiFi.mode(WIFI_AP);
   WiFi.softAP(ssid);
@@ -121,11 +368,138 @@ void startWifiConfigPortal(const char* ssid,
     diagnosticsWebRegisterRoutes(server, *diagCtx);
   }
 
-  server.on("/", HTTP_GET, [actions, actionCount, meterStyle, ledBrightness, diagCtx]() {
-    server.send(200, "text/html", buildConfigHtml(actions, actionCount, meterStyle, ledBrightness, diagCtx != nullptr));
+  server.on("/", HTTP_GET, [actions, actionCount, layerCount, layerKnob, gamepadMode, meterStyle, ledBrightness, hallFilter, hallFilterK, diagCtx]() {
+    server.send(200, "text/html", buildConfigHtml(actions, holdActions, actionCount, layerCount, layerKnob, gamepadMode, midiMode, midiChannel, midiBaseNote, midiKnobCc, meterStyle, ledBrightness, hallFilter, hallFilterK, rateGovernor, rapidTrigger, actuationPress, actuationRelease, tapHoldMode, tapHoldTermMs, depthActions, depthPercent, comboKeys, comboActions, comboWindowMs, socdKeys, socdPolicy, diagCtx != nullptr));
   });
 
-  server.on("/save", HTTP_POST, [prefsNamespace, actions, actionCount, meterStyle, ledBrightness]() mutable {
+  server.on("/save", HTTP_POST, [prefsNamespace, actions, actionCount, layerCount, layerKnob, gamepadMode, meterStyle, ledBrightness, hallFilter, hallFilterK]() mutable {
+    // Reject the whole form if any action doesn't compile, so a typo never
+    // ends up as a half-working binding after the reboot.
+    String errors;
+    for (size_t layer = 0; layer < KEYMAP_MAX_LAYERS; layer++) {
+      for (size_t i = 0; i < actionCount; i++) {
+        const String argName = keybindsKeyForButton(i, layer);
+        if (server.hasArg(argName)) {
+          appendActionError(errors, "", layer, i, server.arg(argName));
+        }
+        const String holdName = keybindsKeyForHold(i, layer);
+        if (server.hasArg(holdName)) {
+          appendActionError(errors, " hold", layer, i, server.arg(holdName));
+        }
+      }
+    }
+    // Actuation points: press 0 or 5..95, release below press.
+    for (size_t i = 0; i < actionCount; i++) {
+      const String pressName = keybindsKeyForActuationPress(i);
+      if (!server.hasArg(pressName)) {
+        continue;
+      }
+      const int press = server.arg(pressName).toInt();
+      const int release = server.arg(keybindsKeyForActuationRelease(i)).toInt();
+      String error;
+      if (press != 0 && (press < (int)KEY_ACTUATION_MIN_PERCENT || press > (int)KEY_ACTUATION_MAX_PERCENT)) {
+        error = F("actuation % must be 0 or 5..95");
+      } else if (press != 0 && (release < 1 || release >= press)) {
+        error = F("release % must be 1 or more and below the actuation %");
+      }
+      if (error.length() > 0) {
+        errors += F("<li>Button ");
+        errors += String((int)i + 1);
+        errors += F(": ");
+        errors += error;
+        errors += F("</li>");
+      }
+    }
+    // Depth points: each must compile, and depth 3 needs a shallower depth 2.
+    for (size_t i = 0; i < actionCount; i++) {
+      int prevPercent = -1;
+      for (size_t point = 0; point < KEY_DEPTH_POINTS; point++) {
+        String action = server.arg(keybindsKeyForDepthAction(i, point));
+        action.trim();
+        if (action.length() == 0) {
+          prevPercent = -1;
+          continue;
+        }
+        const String what = String(F(" depth ")) + String((int)point + 2);
+        appendActionError(errors, what.c_str(), 0, i, action);
+        const int pct = server.arg(keybindsKeyForDepthPercent(i, point)).toInt();
+        String error;
+        if (pct < (int)KEY_DEPTH_PERCENT_MIN || pct > (int)KEY_DEPTH_PERCENT_MAX) {
+          error = F("% must be 10..100");
+        } else if (point > 0 && prevPercent < 0) {
+          error = F("needs depth 2 set");
+        } else if (point > 0 && pct <= prevPercent) {
+          error = F("must be deeper than depth 2");
+        }
+        if (error.length() > 0) {
+          errors += F("<li>Button ");
+          errors += String((int)i + 1);
+          errors += what;
+          errors += F(": ");
+          errors += error;
+          errors += F("</li>");
+        }
+        prevPercent = pct;
+      }
+    }
+    for (size_t c = 0; c < ComboEngine::MAX_COMBOS; c++) {
+      String action = server.arg(keybindsKeyForComboAction(c));
+      action.trim();
+      if (action.length() == 0) {
+        continue;
+      }
+      uint8_t keyMask = 0;
+      String error;
+      if (keybindsParseComboKeys(server.arg(keybindsKeyForComboKeys(c)), keyMask, error) &&
+          (keyMask & (uint8_t)(keyMask - 1)) == 0) {
+        error = F("needs at least two keys");
+      }
+      if (error.length() == 0) {
+        ActionProgram program;
+        (void)actionCompile(action, program, error);
+      }
+      if (error.length() > 0) {
+        errors += F("<li>Combo ");
+        errors += String((int)c + 1);
+        errors += F(": ");
+        errors += htmlEscape(error);
+        errors += F("</li>");
+      }
+    }
+    // SOCD pairs: exactly two keys, and a key in one pair only.
+    uint8_t socdUsed = 0;
+    for (size_t p = 0; p < SocdResolver::MAX_PAIRS; p++) {
+      if (server.arg(keybindsKeyForSocdPolicy(p)).toInt() <= 0) {
+        continue;
+      }
+      uint8_t keyMask = 0;
+      String error;
+      if (keybindsParseComboKeys(server.arg(keybindsKeyForSocdKeys(p)), keyMask, error)) {
+        const uint8_t rest = (uint8_t)(keyMask & (uint8_t)(keyMask - 1));  // Drops one key
+        if (rest == 0 || (rest & (uint8_t)(rest - 1)) != 0) {
+          error = F("needs exactly two keys");
+        } else if (keyMask & socdUsed) {
+          error = F("a key can only be in one pair");
+        }
+        socdUsed |= keyMask;
+      }
+      if (error.length() > 0) {
+        errors += F("<li>SOCD pair ");
+        errors += String((int)p + 1);
+        errors += F(": ");
+        errors += htmlEscape(error);
+        errors += F("</li>");
+      }
+    }
+    if (errors.length() > 0) {
+      String html;
+      html += F("<html><body><h3>Not saved</h3><ul>");
+      html += errors;
+      html += F("</ul><p><a href='/'>Back</a></p></body></html>");
+      server.send(400, "text/html", html);
+      return;
+    }
+
     if (server.hasArg("meterStyle")) {
       const String v = server.arg("meterStyle");
       meterStyle = (uint8_t)v.toInt();
@@ -140,17 +514,143 @@ void startWifiConfigPortal(const char* ssid,
       ledBrightness = (uint8_t)b;
     }
 
+    if (server.hasArg("hallFilter")) {
+      const int m = server.arg("hallFilter").toInt();
+      hallFilter = (m < 0 || m > 3) ? 3 : (uint8_t)m;
+    }
+
+    if (server.hasArg("hallFilterK")) {
+      int k = server.arg("hallFilterK").toInt();
+      if (k < 1) k = 1;
+      if (k > 4) k = 4;
+      hallFilterK = (uint8_t)k;
+    }
+
+    if (server.hasArg("layers")) {
+      const int n = server.arg("layers").toInt();
+      layerCount = (n < 1 || n > (int)KEYMAP_MAX_LAYERS) ? 1 : (uint8_t)n;
+    }
+    // Unchecked boxes aren't submitted at all.
+    layerKnob = server.hasArg("layerKnob");
+    gamepadMode = server.hasArg("gamepad");
+    rateGovernor = server.hasArg("adsGov");
+    midiMode = server.hasArg("midi");
+    if (server.hasArg("midiCh")) {
+      const int ch = server.arg("midiCh").toInt();
+      midiChannel = (ch < 1 || ch > 16) ? 1 : (uint8_t)ch;
+    }
+    if (server.hasArg("midiNote")) {
+      const int note = server.arg("midiNote").toInt();
+      midiBaseNote = (note < 0 || note > 121) ? 60 : (uint8_t)note;
+    }
+    if (server.hasArg("midiCC")) {
+      const int cc = server.arg("midiCC").toInt();
+      midiKnobCc = (cc < 0 || cc > 119) ? 1 : (uint8_t)cc;
+    }
+
+    for (size_t layer = 0; layer < KEYMAP_MAX_LAYERS; layer++) {
+      for (size_t i = 0; i < actionCount; i++) {
+        const String argName = keybindsKeyForButton(i, layer);
+        if (server.hasArg(argName)) {
+          String& action = actions[layer * actionCount + i];
+          action = server.arg(argName);
+          action.trim();
+        }
+        const String holdName = keybindsKeyForHold(i, layer);
+        if (server.hasArg(holdName)) {
+          String& action = holdActions[layer * actionCount + i];
+          action = server.arg(holdName);
+          action.trim();
+        }
+      }
+    }
+
     for (size_t i = 0; i < actionCount; i++) {
-      const String argName = keybindsKeyForButton(i);
-      if (server.hasArg(argName)) {
-        actions[i] = server.arg(argName);
-        actions[i].trim();
+      const String rtName = keybindsKeyForRapidTrigger(i);
+      if (server.hasArg(rtName)) {
+        int pct = server.arg(rtName).toInt();
+        if (pct < 0) pct = 0;
+        if (pct > 50) pct = 50;
+        rapidTrigger[i] = (uint8_t)pct;
+      }
+      const String pressName = keybindsKeyForActuationPress(i);
+      if (server.hasArg(pressName)) {
+        // Range checked above.
+        actuationPress[i] = (uint8_t)server.arg(pressName).toInt();
+        actuationRelease[i] = (actuationPress[i] == 0) ? 0 : (uint8_t)server.arg(keybindsKeyForActuationRelease(i)).toInt();
+      }
+      const String modeName = keybindsKeyForTapHoldMode(i);
+      if (server.hasArg(modeName)) {
+        const int m = server.arg(modeName).toInt();
+        tapHoldMode[i] = (m < 0 || m >= (int)TAP_HOLD_MODE_COUNT) ? 0 : (uint8_t)m;
+      }
+      const String termName = keybindsKeyForTapHoldTerm(i);
+      if (server.hasArg(termName)) {
+        int ms = server.arg(termName).toInt();
+        if (ms < (int)TAP_HOLD_TERM_MIN_MS) ms = TAP_HOLD_TERM_MIN_MS;
+        if (ms > (int)TAP_HOLD_TERM_MAX_MS) ms = TAP_HOLD_TERM_MAX_MS;
+        tapHoldTermMs[i] = (uint16_t)ms;
+      }
+      for (size_t point = 0; point < KEY_DEPTH_POINTS; point++) {
+        const size_t slot = point * actionCount + i;
+        const String actionName = keybindsKeyForDepthAction(i, point);
+        if (server.hasArg(actionName)) {
+          depthActions[slot] = server.arg(actionName);
+          depthActions[slot].trim();
+        }
+        const String percentName = keybindsKeyForDepthPercent(i, point);
+        if (server.hasArg(percentName)) {
+          // Out of range only happens on unused points (checked above);
+          // saving puts the default back.
+          const int pct = server.arg(percentName).toInt();
+          depthPercent[slot] = (pct < 0 || pct > 255) ? 0 : (uint8_t)pct;
+        }
+      }
+    }
+
+    for (size_t c = 0; c < ComboEngine::MAX_COMBOS; c++) {
+      comboActions[c] = server.arg(keybindsKeyForComboAction(c));
+      comboActions[c].trim();
+      String error;
+      if (comboActions[c].length() == 0 || !keybindsParseComboKeys(server.arg(keybindsKeyForComboKeys(c)), comboKeys[c], error)) {
+        comboKeys[c] = 0;
+      }
+      const String windowName = keybindsKeyForComboWindow(c);
+      if (server.hasArg(windowName)) {
+        int ms = server.arg(windowName).toInt();
+        if (ms < (int)COMBO_WINDOW_MIN_MS) ms = COMBO_WINDOW_MIN_MS;
+        if (ms > (int)COMBO_WINDOW_MAX_MS) ms = COMBO_WINDOW_MAX_MS;
+        comboWindowMs[c] = (uint16_t)ms;
       }
     }
 
-    keybindsSaveToPrefs(prefsNamespace, actions, actionCount);
+    for (size_t p = 0; p < SocdResolver::MAX_PAIRS; p++) {
+      const int m = server.arg(keybindsKeyForSocdPolicy(p)).toInt();
+      socdPolicy[p] = (m < 0 || m >= (int)SOCD_POLICY_COUNT) ? 0 : (uint8_t)m;
+      String error;
+      if (socdPolicy[p] == 0 || !keybindsParseComboKeys(server.arg(keybindsKeyForSocdKeys(p)), socdKeys[p], error)) {
+        socdKeys[p] = 0;
+        socdPolicy[p] = 0;
+      }
+    }
+
+    for (size_t layer = 0; layer < KEYMAP_MAX_LAYERS; layer++) {
+      keybindsSaveToPrefs(prefsNamespace, actions + layer * actionCount, actionCount, layer);
+      keybindsSaveHoldToPrefs(prefsNamespace, holdActions + layer * actionCount, actionCount, layer);
+    }
+    keybindsSaveLayersToPrefs(prefsNamespace, layerCount, layerKnob);
+    keybindsSaveGamepadToPrefs(prefsNamespace, gamepadMode);
+    keybindsSaveRateGovernorToPrefs(prefsNamespace, rateGovernor);
+    keybindsSaveMidiToPrefs(prefsNamespace, midiMode, midiChannel, midiBaseNote, midiKnobCc);
     keybindsSaveMeterStyleToPrefs(prefsNamespace, meterStyle);
     keybindsSaveLedBrightnessToPrefs(prefsNamespace, ledBrightness);
+    keybindsSaveHallFilterToPrefs(prefsNamespace, hallFilter, hallFilterK);
+    keybindsSaveRapidTriggerToPrefs(prefsNamespace, rapidTrigger, actionCount);
+    keybindsSaveActuationToPrefs(prefsNamespace, actuationPress, actuationRelease, actionCount);
+    keybindsSaveTapHoldToPrefs(prefsNamespace, tapHoldMode, tapHoldTermMs, actionCount);
+    keybindsSaveDepthToPrefs(prefsNamespace, depthActions, depthPercent, actionCount);
+    keybindsSaveCombosToPrefs(prefsNamespace, comboKeys, comboActions, comboWindowMs, ComboEngine::MAX_COMBOS);
+    keybindsSaveSocdToPrefs(prefsNamespace, socdKeys, socdPolicy, SocdResolver::MAX_PAIRS);
 
     server.send(200, "text/html", F("<html><body><h3>Saved. Rebooting...</h3></body></html>"));
     delay(500);
@@ -0,0 +1,68 @@
+#pragma once
+
+// Register constants and the settings half of Adafruit_ADS1115, for the
+// native tests. Conversions go through the simulated bus (Wire.h).
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#define ADS1X15_REG_POINTER_CONVERT (0x00)
+#define ADS1X15_REG_POINTER_CONFIG (0x01)
+#define ADS1X15_REG_POINTER_LOWTHRESH (0x02)
+#define ADS1X15_REG_POINTER_HITHRESH (0x03)
+
+#define ADS1X15_REG_CONFIG_OS_MASK (0x8000)
+#define ADS1X15_REG_CONFIG_OS_SINGLE (0x8000)
+#define ADS1X15_REG_CONFIG_OS_BUSY (0x0000)
+#define ADS1X15_REG_CONFIG_OS_NOTBUSY (0x8000)
+#define ADS1X15_REG_CONFIG_MUX_MASK (0x7000)
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_0 (0x4000)
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_1 (0x5000)
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_2 (0x6000)
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_3 (0x7000)
+#define ADS1X15_REG_CONFIG_MODE_SINGLE (0x0100)
+#define ADS1X15_REG_CONFIG_CMODE_TRAD (0x0000)
+#define ADS1X15_REG_CONFIG_CPOL_ACTVLOW (0x0000)
+#define ADS1X15_REG_CONFIG_CLAT_NONLAT (0x0000)
+#define ADS1X15_REG_CONFIG_CQUE_1CONV (0x0000)
+
+#define RATE_ADS1115_8SPS (0x0000)
+#define RATE_ADS1115_16SPS (0x0020)
+#define RATE_ADS1115_32SPS (0x0040)
+#define RATE_ADS1115_64SPS (0x0060)
+#define RATE_ADS1115_128SPS (0x0080)
+#define RATE_ADS1115_250SPS (0x00A0)
+#define RATE_ADS1115_475SPS (0x00C0)
+#define RATE_ADS1115_860SPS (0x00E0)
+
+typedef enum {
+  GAIN_TWOTHIRDS = 0x0000,
+  GAIN_ONE = 0x0200,
+  GAIN_TWO = 0x0400,
+  GAIN_FOUR = 0x0600,
+  GAIN_EIGHT = 0x0800,
+  GAIN_SIXTEEN = 0x0A00,
+} adsGain_t;
+
+class Adafruit_ADS1115 {
+  public:
+    void setGain(adsGain_t value) {
+      gain = value;
+    }
+
+    adsGain_t getGain() {
+      return gain;
+    }
+
+    void setDataRate(uint16_t value) {
+      rate = value;
+    }
+
+    uint16_t getDataRate() {
+      return rate;
+    }
+
+  private:
+    adsGain_t gain = GAIN_TWOTHIRDS;
+    uint16_t rate = RATE_ADS1115_128SPS;
+};
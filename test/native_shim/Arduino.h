@@ -0,0 +1,146 @@
+#pragma once
+
+// Just enough of the Arduino core for the host-side ([env:native]) tests.
+// Only modules that take their time and I/O as arguments build against it.
+
+#include <ctype.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+typedef uint8_t byte;
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+
+#define IRAM_ATTR
+#define INPUT_PULLUP 0x05
+#define FALLING 0x02
+#define digitalPinToInterrupt(p) (p)
+
+// Simulated clock. It only moves when code waits (delay*, vTaskDelay) or a
+// fake peripheral charges bus time, so timing tests are deterministic.
+inline uint32_t& nativeShimMicros() {
+  static uint32_t us = 0;
+  return us;
+}
+
+inline uint32_t micros() {
+  return nativeShimMicros();
+}
+
+inline uint32_t millis() {
+  return nativeShimMicros() / 1000UL;
+}
+
+inline void delayMicroseconds(uint32_t us) {
+  nativeShimMicros() += us;
+}
+
+inline void delay(uint32_t ms) {
+  nativeShimMicros() += ms * 1000UL;
+}
+
+inline void pinMode(uint8_t pin, uint8_t mode) {
+  (void)pin;
+  (void)mode;
+}
+
+// No interrupts on the host; code with an ALERT/RDY pin falls back to waiting.
+inline void attachInterruptArg(uint8_t pin, void (*handler)(void*), void* arg, int mode) {
+  (void)pin;
+  (void)handler;
+  (void)arg;
+  (void)mode;
+}
+
+inline bool isDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+// WString subset used by the action compiler and key-token parser.
+class String {
+  public:
+    String() {}
+    String(const char* text) : s(text != nullptr ? text : "") {}
+    String(const __FlashStringHelper* text) : s(reinterpret_cast<const char*>(text)) {}
+    explicit String(char c) : s(1, c) {}
+    explicit String(int value) : s(std::to_string(value)) {}
+    explicit String(unsigned int value) : s(std::to_string(value)) {}
+    explicit String(long value) : s(std::to_string(value)) {}
+    explicit String(unsigned long value) : s(std::to_string(value)) {}
+
+    unsigned int length() const { return (unsigned int)s.size(); }
+    const char* c_str() const { return s.c_str(); }
+    char operator[](unsigned int i) const { return (i < s.size()) ? s[i] : 0; }
+    char charAt(unsigned int i) const { return (*this)[i]; }
+
+    String substring(unsigned int from) const {
+      return substring(from, length());
+    }
+    String substring(unsigned int from, unsigned int to) const {
+      if (to > length()) to = length();
+      if (from >= to) return String();
+      return String(s.substr(from, to - from).c_str());
+    }
+    int indexOf(char c, unsigned int from = 0) const {
+      const size_t pos = s.find(c, from);
+      return (pos == std::string::npos) ? -1 : (int)pos;
+    }
+    int indexOf(const String& text, unsigned int from = 0) const {
+      const size_t pos = s.find(text.s, from);
+      return (pos == std::string::npos) ? -1 : (int)pos;
+    }
+    bool startsWith(const String& prefix) const { return s.compare(0, prefix.s.size(), prefix.s) == 0; }
+    bool endsWith(const String& suffix) const {
+      return s.size() >= suffix.s.size() && s.compare(s.size() - suffix.s.size(), suffix.s.size(), suffix.s) == 0;
+    }
+    bool equalsIgnoreCase(const String& other) const {
+      if (s.size() != other.s.size()) return false;
+      for (size_t i = 0; i < s.size(); i++) {
+        if (tolower((unsigned char)s[i]) != tolower((unsigned char)other.s[i])) return false;
+      }
+      return true;
+    }
+    void trim() {
+      const size_t first = s.find_first_not_of(" \t\r\n");
+      if (first == std::string::npos) {
+        s.clear();
+        return;
+      }
+      s = s.substr(first, s.find_last_not_of(" \t\r\n") - first + 1);
+    }
+    void toUpperCase() {
+      for (size_t i = 0; i < s.size(); i++) s[i] = (char)toupper((unsigned char)s[i]);
+    }
+    void toLowerCase() {
+      for (size_t i = 0; i < s.size(); i++) s[i] = (char)tolower((unsigned char)s[i]);
+    }
+    long toInt() const { return atol(s.c_str()); }
+
+    String& operator+=(const String& other) { s += other.s; return *this; }
+    String& operator+=(const char* other) { s += other; return *this; }
+    String& operator+=(const __FlashStringHelper* other) { s += reinterpret_cast<const char*>(other); return *this; }
+    String& operator+=(char c) { s += c; return *this; }
+
+    bool operator==(const String& other) const { return s == other.s; }
+    bool operator==(const char* other) const { return s == other; }
+    bool operator==(const __FlashStringHelper* other) const { return s == reinterpret_cast<const char*>(other); }
+    bool operator!=(const String& other) const { return s != other.s; }
+
+  private:
+    std::string s;
+};
+
+inline String operator+(String a, const String& b) { a += b; return a; }
+inline String operator+(String a, const char* b) { a += b; return a; }
+inline String operator+(String a, const __FlashStringHelper* b) { a += b; return a; }
+inline String operator+(String a, char b) { a += b; return a; }
+
+// The ESP32 core pulls FreeRTOS in through Arduino.h.
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
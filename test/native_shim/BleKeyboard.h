@@ -0,0 +1,35 @@
+#pragma once
+
+// Report layout and key codes of t-vk/ESP32 BLE Keyboard, for the native tests.
+
+#include <Arduino.h>
+
+typedef struct {
+  uint8_t modifiers;
+  uint8_t reserved;
+  uint8_t keys[6];
+} KeyReport;
+
+const uint8_t KEY_LEFT_CTRL = 0x80;
+const uint8_t KEY_LEFT_SHIFT = 0x81;
+const uint8_t KEY_LEFT_ALT = 0x82;
+const uint8_t KEY_LEFT_GUI = 0x83;
+const uint8_t KEY_RIGHT_CTRL = 0x84;
+const uint8_t KEY_RIGHT_SHIFT = 0x85;
+const uint8_t KEY_RIGHT_ALT = 0x86;
+const uint8_t KEY_RIGHT_GUI = 0x87;
+
+const uint8_t KEY_UP_ARROW = 0xDA;
+const uint8_t KEY_DOWN_ARROW = 0xD9;
+const uint8_t KEY_LEFT_ARROW = 0xD8;
+const uint8_t KEY_RIGHT_ARROW = 0xD7;
+const uint8_t KEY_BACKSPACE = 0xB2;
+const uint8_t KEY_TAB = 0xB3;
+const uint8_t KEY_RETURN = 0xB0;
+const uint8_t KEY_ESC = 0xB1;
+const uint8_t KEY_DELETE = 0xD4;
+const uint8_t KEY_F1 = 0xC2;
+
+const uint8_t KEY_NUM_MINUS = 0xDE;
+const uint8_t KEY_NUM_PLUS = 0xDF;
+const uint8_t KEY_NUM_ENTER = 0xE0;
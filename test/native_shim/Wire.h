@@ -0,0 +1,115 @@
+#pragma once
+
+// Simulated I2C bus for the native tests. Devices are plugged in by address;
+// every transaction charges its bytes (address byte included) to the
+// simulated clock.
+
+#include <Arduino.h>
+
+class NativeI2cDevice {
+  public:
+    virtual ~NativeI2cDevice() {}
+    // One write transaction (register pointer, then any data bytes).
+    virtual void i2cWrite(const uint8_t* data, size_t length) = 0;
+    // One read transaction; returns the bytes supplied.
+    virtual size_t i2cRead(uint8_t* data, size_t length) = 0;
+};
+
+class TwoWire {
+  public:
+    static constexpr size_t MAX_DEVICES = 4;
+    static constexpr size_t BUFFER_BYTES = 8;
+
+    uint32_t byteUs = 23;  // ~400 kHz
+    uint32_t transactions = 0;
+
+    void attach(uint8_t addr, NativeI2cDevice* device) {
+      for (size_t i = 0; i < MAX_DEVICES; i++) {
+        if (devices[i] == nullptr || addrs[i] == addr) {
+          addrs[i] = addr;
+          devices[i] = device;
+          return;
+        }
+      }
+    }
+
+    void detachAll() {
+      for (size_t i = 0; i < MAX_DEVICES; i++) {
+        devices[i] = nullptr;
+      }
+    }
+
+    void beginTransmission(uint8_t addr) {
+      txAddr = addr;
+      txLength = 0;
+    }
+
+    size_t write(uint8_t value) {
+      if (txLength >= BUFFER_BYTES) {
+        return 0;
+      }
+      tx[txLength++] = value;
+      return 1;
+    }
+
+    uint8_t endTransmission(bool stop = true) {
+      (void)stop;
+      transactions++;
+      delayMicroseconds(byteUs * (uint32_t)(txLength + 1));
+      NativeI2cDevice* device = find(txAddr);
+      if (device == nullptr) {
+        return 2;  // NACK on address
+      }
+      device->i2cWrite(tx, txLength);
+      return 0;
+    }
+
+    uint8_t requestFrom(uint8_t addr, uint8_t length) {
+      transactions++;
+      rxLength = 0;
+      rxPos = 0;
+      NativeI2cDevice* device = find(addr);
+      if (device == nullptr || length > BUFFER_BYTES) {
+        delayMicroseconds(byteUs);
+        return 0;
+      }
+      rxLength = device->i2cRead(rx, length);
+      delayMicroseconds(byteUs * (uint32_t)(rxLength + 1));
+      return (uint8_t)rxLength;
+    }
+
+    int available() {
+      return (int)(rxLength - rxPos);
+    }
+
+    int read() {
+      return (rxPos < rxLength) ? rx[rxPos++] : -1;
+    }
+
+  private:
+    uint8_t addrs[MAX_DEVICES] = {};
+    NativeI2cDevice* devices[MAX_DEVICES] = {};
+    uint8_t txAddr = 0;
+    uint8_t tx[BUFFER_BYTES] = {};
+    size_t txLength = 0;
+    uint8_t rx[BUFFER_BYTES] = {};
+    size_t rxLength = 0;
+    size_t rxPos = 0;
+
+    NativeI2cDevice* find(uint8_t addr) {
+      for (size_t i = 0; i < MAX_DEVICES; i++) {
+        if (devices[i] != nullptr && addrs[i] == addr) {
+          return devices[i];
+        }
+      }
+      return nullptr;
+    }
+};
+
+// One bus shared by every translation unit.
+inline TwoWire& nativeShimWire() {
+  static TwoWire wire;
+  return wire;
+}
+
+#define Wire nativeShimWire()
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "FreeRTOS.h"
+
+typedef void* TaskHandle_t;
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() {
+  static int task;
+  return &task;
+}
+
+// Waiting just moves the simulated clock on.
+inline void vTaskDelay(TickType_t ticks) {
+  nativeShimMicros() += ticks * portTICK_PERIOD_MS * 1000UL;
+}
+
+inline void taskYIELD() {}
+
+inline void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* woken) {
+  (void)task;
+  (void)woken;
+}
+
+// Nothing can notify on the host: the wait always runs to its timeout.
+inline uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+  (void)clear;
+  vTaskDelay(ticks);
+  return 0;
+}
@@ -0,0 +1,278 @@
+#include <unity.h>
+
+#include <stdio.h>
+
+#include "mxgicAdsPipeline.h"
+
+static const uint8_t ADDR_A = 0x48;
+static const uint8_t ADDR_B = 0x49;
+static const uint8_t HALL_CHANNELS = 3;
+
+// Conversions run a little slower than nominal, like a real chip whose
+// oscillator is off by a few percent, so the OS-bit polling path is used.
+static const uint32_t CONV_SLOW_PERCENT = 3;
+
+// ADS1115 as seen from the bus. A conversion samples its channel when it is
+// started; the conversion register keeps the previous result and the OS bit
+// reads busy until the conversion time has passed.
+class FakeAds1115 : public NativeI2cDevice {
+  public:
+    uint16_t input[MxgicAdsPipeline::CHANNEL_COUNT] = {};
+    uint32_t conversions = 0;
+
+    void i2cWrite(const uint8_t* data, size_t length) override {
+      if (length == 0) {
+        return;
+      }
+      pointer = data[0];
+      if (length < 3) {
+        return;
+      }
+      const uint16_t value = (uint16_t)((data[1] << 8) | data[2]);
+      if (pointer != ADS1X15_REG_POINTER_CONFIG) {
+        return;
+      }
+      settle();
+      config = (uint16_t)(value & ~ADS1X15_REG_CONFIG_OS_MASK);
+      if ((value & ADS1X15_REG_CONFIG_OS_SINGLE) && !busy) {
+        static const uint32_t kConvUs[8] = {125000, 62500, 31250, 15625, 7813, 4000, 2106, 1163};
+        const uint8_t ch = (uint8_t)(((value & ADS1X15_REG_CONFIG_MUX_MASK) >> 12) - 4);
+        sampled = input[ch & 0x03];
+        busy = true;
+        doneUs = micros() + kConvUs[(value >> 5) & 0x07] * (100 + CONV_SLOW_PERCENT) / 100;
+        conversions++;
+      }
+    }
+
+    size_t i2cRead(uint8_t* data, size_t length) override {
+      settle();
+      uint16_t value = 0;
+      if (pointer == ADS1X15_REG_POINTER_CONVERT) {
+        value = result;
+      } else if (pointer == ADS1X15_REG_POINTER_CONFIG) {
+        value = (uint16_t)(config | (busy ? ADS1X15_REG_CONFIG_OS_BUSY : ADS1X15_REG_CONFIG_OS_NOTBUSY));
+      }
+      if (length > 0) data[0] = (uint8_t)(value >> 8);
+      if (length > 1) data[1] = (uint8_t)(value & 0xFF);
+      return (length < 2) ? length : 2;
+    }
+
+  private:
+    uint8_t pointer = 0;
+    uint16_t config = 0x0583;
+    bool busy = false;
+    uint32_t doneUs = 0;
+    uint16_t sampled = 0;
+    uint16_t result = 0;
+
+    void settle() {
+      if (busy && (int32_t)(micros() - doneUs) >= 0) {
+        busy = false;
+        result = sampled;
+      }
+    }
+};
+
+static FakeAds1115 g_chipA;
+static FakeAds1115 g_chipB;
+
+// chip * 10000 + channel * 1000 + frame, so a reading names its source.
+static uint16_t inputValue(uint8_t chip, uint8_t ch, uint32_t frame) {
+  return (uint16_t)(chip * 10000U + ch * 1000U + (frame % 1000U));
+}
+
+static void setInputs(uint32_t frame) {
+  for (uint8_t ch = 0; ch < MxgicAdsPipeline::CHANNEL_COUNT; ch++) {
+    g_chipA.input[ch] = inputValue(0, ch, frame);
+    g_chipB.input[ch] = inputValue(1, ch, frame);
+  }
+}
+
+static void beginPair(MxgicAdsPipeline& a, MxgicAdsPipeline& b) {
+  Adafruit_ADS1115 ads;
+  ads.setGain(GAIN_ONE);
+  ads.setDataRate(RATE_ADS1115_860SPS);
+  for (uint8_t ch = 0; ch < HALL_CHANNELS; ch++) {
+    a.enableChannel(ch);
+    b.enableChannel(ch);
+  }
+  TEST_ASSERT_TRUE(a.begin(ads, ADDR_A));
+  TEST_ASSERT_TRUE(b.begin(ads, ADDR_B));
+}
+
+void setUp(void) {
+  g_chipA = FakeAds1115();
+  g_chipB = FakeAds1115();
+  Wire.detachAll();
+  Wire.attach(ADDR_A, &g_chipA);
+  Wire.attach(ADDR_B, &g_chipB);
+  Wire.byteUs = 23;
+  setInputs(0);
+}
+
+void tearDown(void) {}
+
+// Every channel must hold its own reading after a frame, never the one for
+// the channel converted before it, and never one sampled before the frame.
+static void checkFrames(AdsScanMode mode) {
+  MxgicAdsPipeline a;
+  MxgicAdsPipeline b;
+  beginPair(a, b);
+
+  char msg[64];
+  for (uint32_t frame = 1; frame <= 50; frame++) {
+    setInputs(frame);
+    adsPipelineReadFrame(a, b, mode);
+    for (uint8_t ch = 0; ch < HALL_CHANNELS; ch++) {
+      const MxgicAdsPipeline* pipes[2] = {&a, &b};
+      for (uint8_t chip = 0; chip < 2; chip++) {
+        snprintf(msg, sizeof(msg), "frame %u chip %u ch %u", (unsigned)frame, chip, ch);
+        TEST_ASSERT_EQUAL_UINT16_MESSAGE(inputValue(chip, ch, frame), pipes[chip]->latest(ch), msg);
+      }
+    }
+    // Both chips stop after the frame's last channel.
+    TEST_ASSERT_FALSE(a.poll());
+    TEST_ASSERT_FALSE(b.poll());
+  }
+  // Exactly one conversion per channel per frame, none wasted.
+  TEST_ASSERT_EQUAL_UINT32(50 * HALL_CHANNELS, g_chipA.conversions);
+  TEST_ASSERT_EQUAL_UINT32(50 * HALL_CHANNELS, g_chipB.conversions);
+}
+
+static void test_serialized_frame_returns_each_channels_value(void) {
+  checkFrames(AdsScanMode::Serialized);
+}
+
+static void test_interleaved_frame_returns_each_channels_value(void) {
+  checkFrames(AdsScanMode::Interleaved);
+}
+
+// read() jumps the round-robin: the demanded channel is the next one started.
+static void test_read_returns_the_demanded_channel(void) {
+  MxgicAdsPipeline a;
+  MxgicAdsPipeline b;
+  beginPair(a, b);
+
+  setInputs(7);
+  TEST_ASSERT_EQUAL_UINT16(inputValue(0, 2, 7), a.read(2));
+  TEST_ASSERT_EQUAL_UINT16(inputValue(0, 1, 7), a.read(1));
+  TEST_ASSERT_EQUAL_UINT16(inputValue(0, 2, 7), a.read(2));
+  TEST_ASSERT_EQUAL_UINT16(inputValue(1, 0, 7), b.read(0));
+}
+
+// A conversion of the requested channel that was already running when
+// read() was called is not good enough: it sampled the old input.
+static void test_read_skips_a_conversion_started_before_the_call(void) {
+  MxgicAdsPipeline a;
+  MxgicAdsPipeline b;
+  beginPair(a, b);
+
+  setInputs(1);
+  TEST_ASSERT_EQUAL_UINT16(inputValue(0, 2, 1), a.read(2));  // round-robin goes on to ch 0
+  setInputs(2);
+  TEST_ASSERT_EQUAL_UINT16(inputValue(0, 0, 2), a.read(0));
+}
+
+static void test_poll_waits_for_the_conversion(void) {
+  MxgicAdsPipeline a;
+  MxgicAdsPipeline b;
+  beginPair(a, b);
+
+  // Idle after begin(): nothing runs until a reader asks.
+  TEST_ASSERT_FALSE(a.poll());
+  TEST_ASSERT_EQUAL_UINT32(0, g_chipA.conversions);
+
+  TEST_ASSERT_EQUAL_UINT16(inputValue(0, 0, 0), a.read(0));
+  // ch 1 was started right after ch 0 finished.
+  TEST_ASSERT_FALSE(a.poll());
+  TEST_ASSERT_EQUAL_UINT32(0, a.sampleCount(1));
+  delayMicroseconds(1300);
+  TEST_ASSERT_TRUE(a.poll());
+  TEST_ASSERT_EQUAL_UINT32(1, a.sampleCount(1));
+  TEST_ASSERT_EQUAL_UINT16(inputValue(0, 1, 0), a.latest(1));
+}
+
+// Adafruit_ADS1115::readADC_SingleEnded() on the same bus: start, poll the
+// OS bit until it is done, read the result. Nothing overlaps.
+static uint16_t readRegister(uint8_t addr, uint8_t reg) {
+  Wire.beginTransmission(addr);
+  Wire.write(reg);
+  Wire.endTransmission();
+  Wire.requestFrom(addr, (uint8_t)2);
+  const uint8_t hi = (uint8_t)Wire.read();
+  const uint8_t lo = (uint8_t)Wire.read();
+  return (uint16_t)((hi << 8) | lo);
+}
+
+static uint16_t blockingRead(uint8_t addr, uint8_t ch) {
+  const uint16_t config = ADS1X15_REG_CONFIG_OS_SINGLE | (uint16_t)(ADS1X15_REG_CONFIG_MUX_SINGLE_0 + (ch << 12)) |
+                          ADS1X15_REG_CONFIG_MODE_SINGLE | GAIN_ONE | RATE_ADS1115_860SPS;
+  Wire.beginTransmission(addr);
+  Wire.write(ADS1X15_REG_POINTER_CONFIG);
+  Wire.write((uint8_t)(config >> 8));
+  Wire.write((uint8_t)(config & 0xFF));
+  Wire.endTransmission();
+  while (!(readRegister(addr, ADS1X15_REG_POINTER_CONFIG) & ADS1X15_REG_CONFIG_OS_NOTBUSY)) {
+  }
+  return readRegister(addr, ADS1X15_REG_POINTER_CONVERT);
+}
+
+static void test_blocking_baseline_reads_each_channel(void) {
+  setInputs(3);
+  for (uint8_t ch = 0; ch < HALL_CHANNELS; ch++) {
+    TEST_ASSERT_EQUAL_UINT16(inputValue(0, ch, 3), blockingRead(ADDR_A, ch));
+    TEST_ASSERT_EQUAL_UINT16(inputValue(1, ch, 3), blockingRead(ADDR_B, ch));
+  }
+}
+
+// Frames per second on the simulated bus (860 SPS, ~400 kHz I2C, 3+3
+// channels). The blocking driver pays six conversion periods per frame;
+// interleaving pays three, so it must come close to twice the rate.
+static void test_benchmark_blocking_vs_interleaved(void) {
+  const uint32_t kFrames = 200;
+  double fps[3] = {0, 0, 0};
+  const AdsScanMode modes[2] = {AdsScanMode::Serialized, AdsScanMode::Interleaved};
+
+  uint32_t startUs = micros();
+  for (uint32_t frame = 0; frame < kFrames; frame++) {
+    for (uint8_t ch = 0; ch < HALL_CHANNELS; ch++) {
+      (void)blockingRead(ADDR_A, ch);
+    }
+    for (uint8_t ch = 0; ch < HALL_CHANNELS; ch++) {
+      (void)blockingRead(ADDR_B, ch);
+    }
+  }
+  fps[0] = kFrames * 1e6 / (double)(micros() - startUs);
+
+  for (int m = 0; m < 2; m++) {
+    setUp();
+    MxgicAdsPipeline a;
+    MxgicAdsPipeline b;
+    beginPair(a, b);
+    startUs = micros();
+    for (uint32_t frame = 0; frame < kFrames; frame++) {
+      adsPipelineReadFrame(a, b, modes[m]);
+    }
+    fps[m + 1] = kFrames * 1e6 / (double)(micros() - startUs);
+  }
+
+  char line[112];
+  snprintf(line, sizeof(line), "blocking %.0f fps, serialized %.0f fps, interleaved %.0f fps (x%.2f)",
+           fps[0], fps[1], fps[2], fps[2] / fps[0]);
+  TEST_MESSAGE(line);
+  TEST_ASSERT_TRUE(fps[2] >= fps[0] * 1.8);
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_serialized_frame_returns_each_channels_value);
+  RUN_TEST(test_interleaved_frame_returns_each_channels_value);
+  RUN_TEST(test_read_returns_the_demanded_channel);
+  RUN_TEST(test_read_skips_a_conversion_started_before_the_call);
+  RUN_TEST(test_poll_waits_for_the_conversion);
+  RUN_TEST(test_blocking_baseline_reads_each_channel);
+  RUN_TEST(test_benchmark_blocking_vs_interleaved);
+  return UNITY_END();
+}
@@ -0,0 +1,114 @@
+#include <unity.h>
+
+#include "combo.h"
+
+static ComboEngine engine;
+static uint32_t now;
+
+static void frame(uint8_t pressed, uint8_t released, uint32_t advanceMs = 1) {
+  now += advanceMs;
+  engine.update(now, pressed, released);
+}
+
+void setUp(void) {
+  engine = ComboEngine();
+  engine.configure(0, 0x03, 50);  // keys 0+1
+  now = 0;
+}
+
+void tearDown(void) {}
+
+static void test_unrelated_key_passes_through(void) {
+  frame(0x10, 0);
+  TEST_ASSERT_EQUAL_HEX8(0x10, engine.pressedMask());
+  frame(0, 0x10);
+  TEST_ASSERT_EQUAL_HEX8(0x10, engine.releasedMask());
+}
+
+static void test_chord_inside_window_fires(void) {
+  frame(0x01, 0);
+  TEST_ASSERT_EQUAL_HEX8(0, engine.pressedMask());
+  TEST_ASSERT_EQUAL_HEX8(0x01, engine.bufferedMask());
+  frame(0x02, 0, 30);
+  TEST_ASSERT_EQUAL_HEX8(0x01, engine.firedMask());
+  TEST_ASSERT_EQUAL_HEX8(0x01, engine.activeMask());
+  TEST_ASSERT_EQUAL_HEX8(0, engine.pressedMask());
+
+  // First key up ends it; the keys never reach the next stage.
+  frame(0, 0x01);
+  TEST_ASSERT_EQUAL_HEX8(0, engine.activeMask());
+  TEST_ASSERT_EQUAL_HEX8(0, engine.releasedMask());
+  frame(0, 0x02);
+  TEST_ASSERT_EQUAL_HEX8(0, engine.releasedMask());
+}
+
+static void test_chord_at_window_edge(void) {
+  frame(0x01, 0);
+  frame(0x02, 0, 50);
+  TEST_ASSERT_EQUAL_HEX8(0x01, engine.firedMask());
+}
+
+static void test_chord_past_window_is_plain_presses(void) {
+  frame(0x01, 0);
+  frame(0, 0, 49);
+  TEST_ASSERT_EQUAL_HEX8(0, engine.pressedMask());
+  frame(0, 0);
+  // The window ran out with nothing else able to complete.
+  TEST_ASSERT_EQUAL_HEX8(0x01, engine.pressedMask());
+  frame(0x02, 0, 10);
+  TEST_ASSERT_EQUAL_HEX8(0, engine.firedMask());
+  TEST_ASSERT_EQUAL_HEX8(0, engine.pressedMask());
+  frame(0, 0, 50);
+  TEST_ASSERT_EQUAL_HEX8(0x02, engine.pressedMask());
+}
+
+static void test_member_tapped_alone(void) {
+  frame(0x01, 0);
+  frame(0, 0x01, 10);
+  TEST_ASSERT_EQUAL_HEX8(0x01, engine.pressedMask());
+  TEST_ASSERT_EQUAL_HEX8(0, engine.releasedMask());
+  frame(0, 0);
+  TEST_ASSERT_EQUAL_HEX8(0x01, engine.releasedMask());
+}
+
+static void test_other_key_flushes_in_order(void) {
+  frame(0x01, 0);
+  frame(0x10, 0, 5);
+  TEST_ASSERT_EQUAL_HEX8(0x11, engine.pressedMask());
+  TEST_ASSERT_EQUAL_HEX8(0, engine.bufferedMask());
+}
+
+static void test_bigger_chord_waits_for_its_window(void) {
+  engine.configure(1, 0x07, 80);  // keys 0+1+2
+  frame(0x01, 0);
+  frame(0x02, 0, 10);
+  // 0+1 is complete, but 0+1+2 can still complete.
+  TEST_ASSERT_EQUAL_HEX8(0, engine.firedMask());
+  frame(0x04, 0, 40);
+  TEST_ASSERT_EQUAL_HEX8(0x02, engine.firedMask());
+}
+
+static void test_smaller_chord_fires_when_bigger_expires(void) {
+  engine.configure(1, 0x07, 80);
+  frame(0x01, 0);
+  frame(0x02, 0, 10);
+  frame(0, 0, 69);
+  TEST_ASSERT_EQUAL_HEX8(0, engine.firedMask());
+  frame(0, 0);
+  TEST_ASSERT_EQUAL_HEX8(0x01, engine.firedMask());
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_unrelated_key_passes_through);
+  RUN_TEST(test_chord_inside_window_fires);
+  RUN_TEST(test_chord_at_window_edge);
+  RUN_TEST(test_chord_past_window_is_plain_presses);
+  RUN_TEST(test_member_tapped_alone);
+  RUN_TEST(test_other_key_flushes_in_order);
+  RUN_TEST(test_bigger_chord_waits_for_its_window);
+  RUN_TEST(test_smaller_chord_fires_when_bigger_expires);
+  return UNITY_END();
+}
@@ -0,0 +1,184 @@
+#include <unity.h>
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+
+#include "mxgicHallLut.h"
+
+// Worst-case distance (travel units of 4096) between the per-key table and
+// the reference below, for any raw count in the calibrated range.
+static const uint32_t LUT_MAX_ERROR = 8;
+
+struct Range {
+  unsigned int minRaw;
+  unsigned int maxRaw;
+};
+
+// Typical, narrow (just above MxgicHall::MIN_CAL_SPAN) and wide calibrations.
+static const Range kRanges[] = {
+  {8200, 13800},
+  {1000, 9000},
+  {9000, 9400},
+  {3000, 30000},
+};
+
+// Reference worked out by hand, not with the header's generator: the gap
+// closes from 4 to 2 mm, so the field (~ 1/gap^3) grows 8x. A normalized
+// signal s is a field of (1 + 7s) times the rest field, i.e. a gap of
+// 4 / cbrt(1 + 7s), and travel = (4 - gap) / 2 = 2 * (1 - 1 / cbrt(1 + 7s)).
+static double referenceFraction(double signal) {
+  return 2.0 * (1.0 - 1.0 / cbrt(1.0 + 7.0 * signal));
+}
+
+static uint32_t referenceTravel(unsigned int raw, const Range& r) {
+  const double signal = (double)(raw - r.minRaw) / (double)(r.maxRaw - r.minRaw);
+  return (uint32_t)(referenceFraction(signal) * HALL_TRAVEL_FULL + 0.5);
+}
+
+struct Point {
+  unsigned int raw;
+  uint16_t travel;
+};
+
+// Calibration 8200..13800, points computed from the formula above:
+// s = 1/56 (field x1.125), 1/7 (x2: 2 * (1 - 2^-1/3)), 3/7 (x4), 1/2 (x4.5), 7/8.
+static const Point kHandPoints[] = {
+  {8200, 0},
+  {8300, 315},
+  {9000, 1690},
+  {10600, 3031},
+  {11000, 3230},
+  {13100, 3935},
+  {13800, 4096},
+};
+
+// The straight-line path the LUT replaced (caliRead() before it).
+static uint32_t mapTravel(unsigned int raw, const Range& r) {
+  const long x = (long)((raw < r.minRaw) ? r.minRaw : (raw > r.maxRaw) ? r.maxRaw : raw);
+  return (uint32_t)((x - (long)r.minRaw) * (long)HALL_TRAVEL_FULL / (long)(r.maxRaw - r.minRaw));
+}
+
+static uint32_t distance(uint32_t a, uint32_t b) {
+  return (a > b) ? a - b : b - a;
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void test_lut_tracks_reference_curve(void) {
+  for (size_t i = 0; i < sizeof(kRanges) / sizeof(kRanges[0]); i++) {
+    const Range& r = kRanges[i];
+    MxgicHallLut lut;
+    lut.build(r.minRaw, r.maxRaw);
+    TEST_ASSERT_TRUE(lut.isValid());
+
+    uint32_t worstLut = 0;
+    uint32_t worstMap = 0;
+    for (unsigned int raw = r.minRaw; raw <= r.maxRaw; raw++) {
+      const uint32_t ref = referenceTravel(raw, r);
+      const uint32_t errLut = distance(lut.lookup(raw), ref);
+      const uint32_t errMap = distance(mapTravel(raw, r), ref);
+      if (errLut > worstLut) worstLut = errLut;
+      if (errMap > worstMap) worstMap = errMap;
+    }
+    char line[96];
+    snprintf(line, sizeof(line), "range %u..%u: max error lut %u, map %u",
+             r.minRaw, r.maxRaw, (unsigned)worstLut, (unsigned)worstMap);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(LUT_MAX_ERROR, worstLut);
+    TEST_ASSERT_LESS_THAN_UINT32(worstMap, worstLut);
+  }
+}
+
+static void test_lut_matches_hand_computed_points(void) {
+  MxgicHallLut lut;
+  lut.build(8200, 13800);
+  for (size_t i = 0; i < sizeof(kHandPoints) / sizeof(kHandPoints[0]); i++) {
+    TEST_ASSERT_UINT_WITHIN(LUT_MAX_ERROR, kHandPoints[i].travel, lut.lookup(kHandPoints[i].raw));
+  }
+}
+
+// Outside the calibrated range the table clamps instead of extrapolating.
+static void test_lut_clamps_outside_the_range(void) {
+  MxgicHallLut lut;
+  lut.build(8200, 13800);
+  TEST_ASSERT_EQUAL_UINT16(0, lut.lookup(0));
+  TEST_ASSERT_EQUAL_UINT16(0, lut.lookup(8199));
+  TEST_ASSERT_EQUAL_UINT16(0, lut.lookup(8200));
+  TEST_ASSERT_TRUE(lut.lookup(8201) > 0);
+  TEST_ASSERT_EQUAL_UINT16(HALL_TRAVEL_FULL, lut.lookup(13800));
+  TEST_ASSERT_EQUAL_UINT16(HALL_TRAVEL_FULL, lut.lookup(13801));
+  TEST_ASSERT_EQUAL_UINT16(HALL_TRAVEL_FULL, lut.lookup(65535));
+}
+
+static void test_lut_endpoints_and_monotonic(void) {
+  const Range& r = kRanges[0];
+  MxgicHallLut lut;
+  lut.build(r.minRaw, r.maxRaw);
+  TEST_ASSERT_EQUAL_UINT16(0, lut.lookup(0));
+  TEST_ASSERT_EQUAL_UINT16(0, lut.lookup(r.minRaw));
+  TEST_ASSERT_EQUAL_UINT16(HALL_TRAVEL_FULL, lut.lookup(r.maxRaw));
+  TEST_ASSERT_EQUAL_UINT16(HALL_TRAVEL_FULL, lut.lookup(r.maxRaw + 5000));
+
+  uint16_t prev = 0;
+  for (unsigned int raw = r.minRaw; raw <= r.maxRaw; raw++) {
+    const uint16_t travel = lut.lookup(raw);
+    TEST_ASSERT_TRUE(travel >= prev);
+    prev = travel;
+  }
+}
+
+static void test_empty_range_is_invalid(void) {
+  MxgicHallLut lut;
+  lut.build(9000, 9000);
+  TEST_ASSERT_FALSE(lut.isValid());
+  TEST_ASSERT_EQUAL_UINT16(0, lut.lookup(12000));
+}
+
+// Host timing of the per-sample cost, reported only. It says nothing about
+// the ESP32-S3 (on x86 the map() path is the faster one), so no speed claim
+// rests on it; the table is there for accuracy.
+static void test_benchmark_lut_vs_map(void) {
+  const Range& r = kRanges[0];
+  MxgicHallLut lut;
+  lut.build(r.minRaw, r.maxRaw);
+  const int kPasses = 200;
+  volatile uint32_t sink = 0;
+
+  const auto t0 = std::chrono::steady_clock::now();
+  for (int p = 0; p < kPasses; p++) {
+    for (unsigned int raw = r.minRaw; raw <= r.maxRaw; raw++) {
+      sink = sink + lut.lookup(raw);
+    }
+  }
+  const auto t1 = std::chrono::steady_clock::now();
+  for (int p = 0; p < kPasses; p++) {
+    for (unsigned int raw = r.minRaw; raw <= r.maxRaw; raw++) {
+      sink = sink + mapTravel(raw, r);
+    }
+  }
+  const auto t2 = std::chrono::steady_clock::now();
+
+  const double samples = (double)kPasses * (r.maxRaw - r.minRaw + 1);
+  const double lutNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / samples;
+  const double mapNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / samples;
+  char line[96];
+  snprintf(line, sizeof(line), "lookup %.2f ns/sample, map() %.2f ns/sample", lutNs, mapNs);
+  TEST_MESSAGE(line);
+  TEST_ASSERT_TRUE(sink != 0);
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_lut_tracks_reference_curve);
+  RUN_TEST(test_lut_matches_hand_computed_points);
+  RUN_TEST(test_lut_clamps_outside_the_range);
+  RUN_TEST(test_lut_endpoints_and_monotonic);
+  RUN_TEST(test_empty_range_is_invalid);
+  RUN_TEST(test_benchmark_lut_vs_map);
+  return UNITY_END();
+}
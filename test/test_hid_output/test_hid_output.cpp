@@ -0,0 +1,317 @@
+#include <unity.h>
+
+#include <string>
+#include <vector>
+
+#include "actions.h"
+#include "hid_report.h"
+#include "hid_typing.h"
+#include "macro_engine.h"
+
+// Records every report instead of sending it, and the order of sends ('S')
+// and waits for completion ('W').
+class RecordingSink : public HidSink {
+  public:
+    std::vector<KeyReport> reports;
+    std::string calls;
+
+    void sendReport(const KeyReport& report) override {
+      reports.push_back(report);
+      calls += 'S';
+    }
+
+    void waitSent(uint32_t timeoutMs) override {
+      (void)timeoutMs;
+      calls += 'W';
+    }
+};
+
+static const uint8_t USAGE_A = 0x04;
+static const uint8_t USAGE_B = 0x05;
+static const uint8_t MOD_LEFT_CTRL = 0x01;
+static const uint8_t MOD_LEFT_SHIFT = 0x02;
+
+static RecordingSink sink;
+
+static ActionProgram compile(const char* source) {
+  ActionProgram program;
+  String error;
+  TEST_ASSERT_TRUE_MESSAGE(actionCompile(String(source), program, error), error.c_str());
+  return program;
+}
+
+static bool hasUsage(const KeyReport& report, uint8_t usage) {
+  for (size_t i = 0; i < HID_REPORT_KEY_SLOTS; i++) {
+    if (report.keys[i] == usage) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static size_t usageCount(const KeyReport& report) {
+  size_t count = 0;
+  for (size_t i = 0; i < HID_REPORT_KEY_SLOTS; i++) {
+    count += (report.keys[i] != 0) ? 1 : 0;
+  }
+  return count;
+}
+
+// What a host makes of the stream: a character for every newly pressed
+// letter, upper case while shift is down.
+static std::string hostText(const std::vector<KeyReport>& reports) {
+  std::string text;
+  KeyReport prev;
+  hidReportClear(prev);
+  for (size_t r = 0; r < reports.size(); r++) {
+    const KeyReport& report = reports[r];
+    for (size_t i = 0; i < HID_REPORT_KEY_SLOTS; i++) {
+      const uint8_t usage = report.keys[i];
+      if (usage >= USAGE_A && usage <= 0x1D && !hasUsage(prev, usage)) {
+        const char base = (report.modifiers & MOD_LEFT_SHIFT) ? 'A' : 'a';
+        text += (char)(base + (usage - USAGE_A));
+      }
+    }
+    prev = report;
+  }
+  return text;
+}
+
+void setUp(void) {
+  sink.reports.clear();
+  sink.calls.clear();
+}
+
+void tearDown(void) {}
+
+static void test_base_report_sent_once(void) {
+  MacroEngine engine;
+  KeyReport base;
+  hidReportClear(base);
+  TEST_ASSERT_TRUE(hidReportAddKey(base, KEY_LEFT_CTRL));
+  engine.setBaseReport(base);
+  TEST_ASSERT_EQUAL_UINT32(MacroEngine::IDLE, engine.run(0, sink));
+  TEST_ASSERT_EQUAL(1, sink.reports.size());
+  TEST_ASSERT_EQUAL_HEX8(MOD_LEFT_CTRL, sink.reports[0].modifiers);
+
+  // Unchanged: nothing new goes out.
+  engine.setBaseReport(base);
+  engine.run(5, sink);
+  TEST_ASSERT_EQUAL(1, sink.reports.size());
+}
+
+static void test_macro_merges_with_held_keys(void) {
+  MacroEngine engine;
+  KeyReport base;
+  hidReportClear(base);
+  TEST_ASSERT_TRUE(hidReportAddKey(base, KEY_LEFT_CTRL));
+  engine.setBaseReport(base);
+  const ActionProgram program = compile("MACRO:HOLD 50 B");
+  TEST_ASSERT_TRUE(engine.start(&program, 0));
+
+  // Never blocks: the WAIT comes back as the time to sleep.
+  TEST_ASSERT_EQUAL_UINT32(50, engine.run(0, sink));
+  const KeyReport& held = sink.reports.back();
+  TEST_ASSERT_EQUAL_HEX8(MOD_LEFT_CTRL, held.modifiers);
+  TEST_ASSERT_TRUE(hasUsage(held, USAGE_B));
+
+  TEST_ASSERT_EQUAL_UINT32(30, engine.run(20, sink));
+  TEST_ASSERT_EQUAL_UINT32(MacroEngine::IDLE, engine.run(50, sink));
+  const KeyReport& after = sink.reports.back();
+  TEST_ASSERT_EQUAL_HEX8(MOD_LEFT_CTRL, after.modifiers);
+  TEST_ASSERT_EQUAL(0, usageCount(after));
+  TEST_ASSERT_EQUAL(0, engine.runningCount());
+}
+
+static void test_macros_run_side_by_side(void) {
+  MacroEngine engine;
+  const ActionProgram hold = compile("MACRO:HOLD 100 A");
+  const ActionProgram taps = compile("MACRO:REPEAT 3; TAP B; WAIT 10; END");
+  TEST_ASSERT_TRUE(engine.start(&hold, 0));
+  TEST_ASSERT_TRUE(engine.start(&taps, 0));
+
+  size_t bPresses = 0;
+  bool bDown = false;
+  for (uint32_t now = 0; now <= 100; now++) {
+    const size_t before = sink.reports.size();
+    engine.run(now, sink);
+    for (size_t r = before; r < sink.reports.size(); r++) {
+      const bool down = hasUsage(sink.reports[r], USAGE_B);
+      if (down && !bDown) {
+        bPresses++;
+      }
+      bDown = down;
+      if (now < 100) {
+        TEST_ASSERT_TRUE(hasUsage(sink.reports[r], USAGE_A));
+      }
+    }
+  }
+  TEST_ASSERT_EQUAL(3, bPresses);
+  TEST_ASSERT_TRUE(hidReportIsEmpty(sink.reports.back()));
+}
+
+// Every SYNC waits for its report to leave before the next step runs.
+static void test_sync_steps_wait_for_send_completion(void) {
+  MacroEngine engine;
+  const ActionProgram program = compile("MACRO:TAP A; TAP B");
+  TEST_ASSERT_TRUE(engine.start(&program, 0));
+  TEST_ASSERT_EQUAL_UINT32(MacroEngine::IDLE, engine.run(0, sink));
+  TEST_ASSERT_EQUAL_STRING("SWSWSWSW", sink.calls.c_str());
+  TEST_ASSERT_EQUAL_STRING("ab", hostText(sink.reports).c_str());
+}
+
+// A REPEAT block without WAIT still sleeps between passes, so the worker
+// never gets a 0 ms sleep back.
+static void test_repeat_without_wait_yields_every_pass(void) {
+  MacroEngine engine;
+  const ActionProgram program = compile("MACRO:REPEAT 5; TAP B; END");
+  TEST_ASSERT_TRUE(engine.start(&program, 0));
+
+  uint32_t now = 0;
+  size_t runs = 0;
+  for (;;) {
+    const uint32_t sleepMs = engine.run(now, sink);
+    runs++;
+    if (sleepMs == MacroEngine::IDLE) {
+      break;
+    }
+    TEST_ASSERT_TRUE(sleepMs >= MACRO_REPEAT_MIN_MS);
+    now += sleepMs;
+    TEST_ASSERT_TRUE(runs < 20);
+  }
+  TEST_ASSERT_EQUAL(5, runs);
+  TEST_ASSERT_EQUAL_UINT32(4 * MACRO_REPEAT_MIN_MS, now);
+  TEST_ASSERT_EQUAL_STRING("bbbbb", hostText(sink.reports).c_str());
+  TEST_ASSERT_TRUE(hidReportIsEmpty(sink.reports.back()));
+}
+
+// Passes that WAIT keep their own timing; the minimum adds nothing.
+static void test_repeat_with_wait_keeps_its_schedule(void) {
+  MacroEngine engine;
+  const ActionProgram program = compile("MACRO:REPEAT 3; TAP B; WAIT 10; END");
+  TEST_ASSERT_TRUE(engine.start(&program, 0));
+  TEST_ASSERT_EQUAL_UINT32(10, engine.run(0, sink));
+  TEST_ASSERT_EQUAL_UINT32(10, engine.run(10, sink));
+  TEST_ASSERT_EQUAL_UINT32(10, engine.run(20, sink));
+  TEST_ASSERT_EQUAL_UINT32(MacroEngine::IDLE, engine.run(30, sink));
+  TEST_ASSERT_EQUAL_STRING("bbb", hostText(sink.reports).c_str());
+}
+
+static void test_text_packs_distinct_keys(void) {
+  KeyReport held;
+  hidReportClear(held);
+  TEST_ASSERT_EQUAL(8, hidTypeText(sink, "abcdefgh", 8, held));
+  // Six keys, the last two (no key shared, so no release between), release.
+  TEST_ASSERT_EQUAL(3, sink.reports.size());
+  TEST_ASSERT_EQUAL(6, usageCount(sink.reports[0]));
+  TEST_ASSERT_EQUAL(2, usageCount(sink.reports[1]));
+  TEST_ASSERT_TRUE(hidReportIsEmpty(sink.reports[2]));
+  TEST_ASSERT_EQUAL_STRING("abcdefgh", hostText(sink.reports).c_str());
+}
+
+static void test_text_repeats_and_shift_split_chunks(void) {
+  KeyReport held;
+  hidReportClear(held);
+  hidTypeText(sink, "aaBb", 4, held);
+  TEST_ASSERT_EQUAL_STRING("aaBb", hostText(sink.reports).c_str());
+  TEST_ASSERT_TRUE(hidReportIsEmpty(sink.reports.back()));
+}
+
+static void test_text_releases_a_clashing_held_key(void) {
+  KeyReport held;
+  hidReportClear(held);
+  TEST_ASSERT_TRUE(hidReportAddUsage(held, USAGE_A));
+  hidTypeText(sink, "ab", 2, held);
+  TEST_ASSERT_TRUE(hidReportIsEmpty(sink.reports[0]));
+  std::vector<KeyReport> seen(1, held);
+  seen.insert(seen.end(), sink.reports.begin(), sink.reports.end());
+  // The host saw "a" already held; the typed one must still register.
+  TEST_ASSERT_EQUAL_STRING("aab", hostText(seen).c_str());
+}
+
+// A held key the text never types stays down throughout; a held modifier
+// goes up first so it can't turn the text into shortcuts.
+static void test_text_keeps_a_non_clashing_held_key(void) {
+  const uint8_t usageX = 0x1B;
+  KeyReport held;
+  hidReportClear(held);
+  held.modifiers = 0x01;
+  TEST_ASSERT_TRUE(hidReportAddUsage(held, usageX));
+  TEST_ASSERT_EQUAL(3, hidTypeText(sink, "abc", 3, held));
+  for (size_t r = 0; r < sink.reports.size(); r++) {
+    TEST_ASSERT_TRUE(hasUsage(sink.reports[r], usageX));
+  }
+  TEST_ASSERT_EQUAL_HEX8(0, sink.reports[0].modifiers);
+  TEST_ASSERT_EQUAL(1, usageCount(sink.reports[0]));
+  TEST_ASSERT_EQUAL(1, usageCount(sink.reports.back()));
+  std::vector<KeyReport> seen(1, held);
+  seen.insert(seen.end(), sink.reports.begin(), sink.reports.end());
+  TEST_ASSERT_EQUAL_STRING("xabc", hostText(seen).c_str());
+}
+
+// What the scan sends for one key moving between depth programs: the
+// bridge (when anything is shared), then the new program's report.
+static void sendDepthChange(const ActionProgram& from, const ActionProgram& to) {
+  KeyReport report = sink.reports.back();
+  if (actionReleaseShared(from, to, report)) {
+    sink.sendReport(report);
+  }
+  hidReportClear(report);
+  actionApplyHeld(to, report);
+  sink.sendReport(report);
+}
+
+static void test_depth_change_presses_shared_key_again(void) {
+  const ActionProgram shallow = compile("CTRL+Z");
+  const ActionProgram deep = compile("CTRL+SHIFT+Z");
+  KeyReport report;
+  hidReportClear(report);
+  actionApplyHeld(shallow, report);
+  sink.sendReport(report);
+
+  sendDepthChange(shallow, deep);
+  TEST_ASSERT_EQUAL(3, sink.reports.size());
+  // Z is let go for one report; CTRL stays down throughout.
+  TEST_ASSERT_EQUAL_HEX8(MOD_LEFT_CTRL, sink.reports[1].modifiers);
+  TEST_ASSERT_EQUAL(0, usageCount(sink.reports[1]));
+  TEST_ASSERT_EQUAL_HEX8(MOD_LEFT_CTRL | MOD_LEFT_SHIFT, sink.reports[2].modifiers);
+  // The host sees undo, then a fresh Z press with shift: redo.
+  TEST_ASSERT_EQUAL_STRING("zZ", hostText(sink.reports).c_str());
+
+  // Back up: the shallow program is pressed fresh as well.
+  sendDepthChange(deep, shallow);
+  TEST_ASSERT_EQUAL(5, sink.reports.size());
+  TEST_ASSERT_EQUAL_STRING("zZz", hostText(sink.reports).c_str());
+}
+
+static void test_depth_change_without_shared_keys_has_no_bridge(void) {
+  const ActionProgram shallow = compile("CTRL+Z");
+  const ActionProgram deep = compile("CTRL+Y");
+  KeyReport report;
+  hidReportClear(report);
+  actionApplyHeld(shallow, report);
+  sink.sendReport(report);
+
+  sendDepthChange(shallow, deep);
+  TEST_ASSERT_EQUAL(2, sink.reports.size());
+  TEST_ASSERT_EQUAL_STRING("zy", hostText(sink.reports).c_str());
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_base_report_sent_once);
+  RUN_TEST(test_macro_merges_with_held_keys);
+  RUN_TEST(test_macros_run_side_by_side);
+  RUN_TEST(test_sync_steps_wait_for_send_completion);
+  RUN_TEST(test_repeat_without_wait_yields_every_pass);
+  RUN_TEST(test_repeat_with_wait_keeps_its_schedule);
+  RUN_TEST(test_text_packs_distinct_keys);
+  RUN_TEST(test_text_repeats_and_shift_split_chunks);
+  RUN_TEST(test_text_releases_a_clashing_held_key);
+  RUN_TEST(test_text_keeps_a_non_clashing_held_key);
+  RUN_TEST(test_depth_change_presses_shared_key_again);
+  RUN_TEST(test_depth_change_without_shared_keys_has_no_bridge);
+  return UNITY_END();
+}
@@ -0,0 +1,133 @@
+#include <unity.h>
+
+#include <vector>
+
+#include "hid_router.h"
+
+// A transport whose host can be plugged in and out; records what it is sent.
+class FakeTransport : public HidSink {
+  public:
+    bool connected = false;
+    uint32_t waits = 0;
+    std::vector<KeyReport> reports;
+
+    void sendReport(const KeyReport& report) override {
+      reports.push_back(report);
+    }
+
+    bool isConnected() override {
+      return connected;
+    }
+
+    void waitSent(uint32_t timeoutMs) override {
+      (void)timeoutMs;
+      waits++;
+    }
+};
+
+static const uint8_t USAGE_A = 0x04;
+
+static FakeTransport usb;
+static FakeTransport ble;
+
+static KeyReport keyA() {
+  KeyReport report;
+  hidReportClear(report);
+  hidReportAddUsage(report, USAGE_A);
+  return report;
+}
+
+void setUp(void) {
+  usb = FakeTransport();
+  ble = FakeTransport();
+}
+
+void tearDown(void) {}
+
+static void test_nothing_connected_drops_reports(void) {
+  HidRouter router(usb, ble);
+  TEST_ASSERT_FALSE(router.update());
+  TEST_ASSERT_EQUAL(HidTransportKind::None, router.active());
+  TEST_ASSERT_FALSE(router.isConnected());
+  router.sendReport(keyA());
+  TEST_ASSERT_EQUAL(0, usb.reports.size());
+  TEST_ASSERT_EQUAL(0, ble.reports.size());
+}
+
+static void test_usb_wins_while_mounted(void) {
+  HidRouter router(usb, ble);
+  usb.connected = true;
+  ble.connected = true;
+  TEST_ASSERT_TRUE(router.update());
+  TEST_ASSERT_EQUAL(HidTransportKind::Usb, router.active());
+  router.sendReport(keyA());
+  router.waitSent(30);
+  TEST_ASSERT_EQUAL(1, usb.reports.size());
+  TEST_ASSERT_EQUAL(1, usb.waits);
+  TEST_ASSERT_EQUAL(0, ble.reports.size());
+  TEST_ASSERT_EQUAL(0, ble.waits);
+  // No change: no release, nothing for the caller to resend.
+  TEST_ASSERT_FALSE(router.update());
+  TEST_ASSERT_EQUAL(1, usb.reports.size());
+}
+
+// Unplugged: the USB host is gone, so nothing is sent to it; BLE takes over.
+static void test_unmount_falls_back_to_ble(void) {
+  HidRouter router(usb, ble);
+  usb.connected = true;
+  ble.connected = true;
+  router.update();
+  router.sendReport(keyA());
+
+  usb.connected = false;
+  TEST_ASSERT_TRUE(router.update());
+  TEST_ASSERT_EQUAL(HidTransportKind::Ble, router.active());
+  TEST_ASSERT_EQUAL(1, usb.reports.size());
+  router.sendReport(keyA());
+  TEST_ASSERT_EQUAL(1, ble.reports.size());
+  TEST_ASSERT_TRUE(hidReportEquals(keyA(), ble.reports[0]));
+}
+
+// Plugged in while a key is held on BLE: BLE gets a release before the
+// route moves, so nothing stays stuck down on that host.
+static void test_switch_releases_the_old_transport(void) {
+  HidRouter router(usb, ble);
+  ble.connected = true;
+  router.update();
+  TEST_ASSERT_EQUAL(HidTransportKind::Ble, router.active());
+  router.sendReport(keyA());
+
+  usb.connected = true;
+  TEST_ASSERT_TRUE(router.update());
+  TEST_ASSERT_EQUAL(HidTransportKind::Usb, router.active());
+  TEST_ASSERT_EQUAL(2, ble.reports.size());
+  TEST_ASSERT_TRUE(hidReportIsEmpty(ble.reports[1]));
+  TEST_ASSERT_EQUAL(0, usb.reports.size());
+
+  // The caller resends its held state on the new route.
+  router.sendReport(keyA());
+  TEST_ASSERT_EQUAL(1, usb.reports.size());
+  TEST_ASSERT_EQUAL(2, ble.reports.size());
+}
+
+static void test_losing_every_host_routes_nowhere(void) {
+  HidRouter router(usb, ble);
+  ble.connected = true;
+  router.update();
+  ble.connected = false;
+  TEST_ASSERT_TRUE(router.update());
+  TEST_ASSERT_EQUAL(HidTransportKind::None, router.active());
+  TEST_ASSERT_EQUAL(0, ble.reports.size());
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_nothing_connected_drops_reports);
+  RUN_TEST(test_usb_wins_while_mounted);
+  RUN_TEST(test_unmount_falls_back_to_ble);
+  RUN_TEST(test_switch_releases_the_old_transport);
+  RUN_TEST(test_losing_every_host_routes_nowhere);
+  return UNITY_END();
+}
@@ -0,0 +1,110 @@
+#include <unity.h>
+
+#include "midi_velocity.h"
+
+struct Sample {
+  MidiVelocityTracker::Event event;
+  uint8_t velocity;
+  uint32_t strikeUs;
+};
+
+static Sample feed(MidiVelocityTracker& key, uint16_t travel, uint32_t us) {
+  Sample s = {MidiVelocityTracker::None, 0, 0};
+  s.event = key.update(travel, us, s.velocity, s.strikeUs);
+  return s;
+}
+
+// Presses a key at constant speed from rest to the bottom in `pressUs`,
+// sampled every `frameUs`. Returns the NoteOn sample.
+static Sample strike(MidiVelocityTracker& key, uint32_t pressUs, uint32_t frameUs) {
+  feed(key, 0, 0);
+  for (uint32_t t = frameUs;; t += frameUs) {
+    const uint32_t travel = (t >= pressUs) ? MIDI_TRAVEL_FULL : (uint32_t)((uint64_t)MIDI_TRAVEL_FULL * t / pressUs);
+    const Sample s = feed(key, (uint16_t)travel, t);
+    if (s.event != MidiVelocityTracker::None) {
+      return s;
+    }
+    TEST_ASSERT_TRUE(t < pressUs + frameUs);
+  }
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+// Crossings are interpolated between frames: 0 -> 20 % -> 100 % puts the
+// start crossing halfway through the first frame and the strike 87.5 % of
+// the way through the second.
+static void test_crossings_are_interpolated(void) {
+  MidiVelocityTracker key;
+  TEST_ASSERT_EQUAL(MidiVelocityTracker::None, feed(key, 0, 10000).event);
+  TEST_ASSERT_EQUAL(MidiVelocityTracker::None, feed(key, 818, 14000).event);  // start (409) at 12000
+  const Sample s = feed(key, 4090, 18000);                                     // strike (3686) at 17506
+  TEST_ASSERT_EQUAL(MidiVelocityTracker::NoteOn, s.event);
+  TEST_ASSERT_UINT_WITHIN(2, 17506, s.strikeUs);
+  TEST_ASSERT_EQUAL_UINT8(MidiVelocityTracker::velocityForUs(s.strikeUs - 12000), s.velocity);
+}
+
+// The same press gives the same velocity at any frame interval (frames
+// chosen so the strike frame ends before the key bottoms out).
+static void test_velocity_independent_of_frame_rate(void) {
+  const uint32_t frames[] = {700, 1300, 2300};
+  for (size_t i = 0; i < sizeof(frames) / sizeof(frames[0]); i++) {
+    MidiVelocityTracker key;
+    const Sample s = strike(key, 20000, frames[i]);
+    TEST_ASSERT_EQUAL(MidiVelocityTracker::NoteOn, s.event);
+    // 90 % of a 20 ms press; start at 10 %, so 16 ms start to strike.
+    TEST_ASSERT_UINT_WITHIN(5, 17998, s.strikeUs);
+    TEST_ASSERT_UINT_WITHIN(1, MidiVelocityTracker::velocityForUs(16000), s.velocity);
+  }
+}
+
+static void test_velocity_clamps_at_127_and_1(void) {
+  TEST_ASSERT_EQUAL_UINT8(127, MidiVelocityTracker::velocityForUs(0));
+  TEST_ASSERT_EQUAL_UINT8(127, MidiVelocityTracker::velocityForUs(MIDI_FASTEST_US));
+  TEST_ASSERT_EQUAL_UINT8(1, MidiVelocityTracker::velocityForUs(MIDI_SLOWEST_US));
+  TEST_ASSERT_EQUAL_UINT8(1, MidiVelocityTracker::velocityForUs(5000000));
+  // Slower is never louder.
+  uint8_t prev = 127;
+  for (uint32_t us = MIDI_FASTEST_US; us <= MIDI_SLOWEST_US; us += 500) {
+    const uint8_t v = MidiVelocityTracker::velocityForUs(us);
+    TEST_ASSERT_TRUE(v <= prev && v >= 1);
+    prev = v;
+  }
+
+  MidiVelocityTracker fast;
+  TEST_ASSERT_EQUAL_UINT8(127, strike(fast, 500, 1000).velocity);  // bottom in one frame
+  MidiVelocityTracker slow;
+  TEST_ASSERT_EQUAL_UINT8(1, strike(slow, 1000000, 1000).velocity);
+}
+
+// Note off only below 40 %; bouncing between 40 % and full never re-strikes.
+static void test_release_hysteresis(void) {
+  MidiVelocityTracker key;
+  TEST_ASSERT_EQUAL(MidiVelocityTracker::NoteOn, strike(key, 10000, 1000).event);
+  uint32_t t = 20000;
+  TEST_ASSERT_EQUAL(MidiVelocityTracker::None, feed(key, 2048, t += 1000).event);
+  TEST_ASSERT_EQUAL(MidiVelocityTracker::None, feed(key, MIDI_RELEASE_TRAVEL, t += 1000).event);
+  TEST_ASSERT_EQUAL(MidiVelocityTracker::None, feed(key, MIDI_TRAVEL_FULL, t += 1000).event);
+  TEST_ASSERT_TRUE(key.noteOn());
+
+  TEST_ASSERT_EQUAL(MidiVelocityTracker::NoteOff, feed(key, MIDI_RELEASE_TRAVEL - 1, t += 1000).event);
+  TEST_ASSERT_FALSE(key.noteOn());
+  TEST_ASSERT_EQUAL(MidiVelocityTracker::None, feed(key, 3000, t += 1000).event);
+
+  // Re-struck from part way down: timed from the release, not from rest.
+  const Sample again = feed(key, MIDI_TRAVEL_FULL, t += 1000);
+  TEST_ASSERT_EQUAL(MidiVelocityTracker::NoteOn, again.event);
+  TEST_ASSERT_TRUE(again.velocity > 1);
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_crossings_are_interpolated);
+  RUN_TEST(test_velocity_independent_of_frame_rate);
+  RUN_TEST(test_velocity_clamps_at_127_and_1);
+  RUN_TEST(test_release_hysteresis);
+  return UNITY_END();
+}
@@ -0,0 +1,159 @@
+#include <unity.h>
+
+#include "tap_hold.h"
+
+// Key 0 is dual-role, every other key is plain.
+static bool activate(size_t key) {
+  return key == 0;
+}
+
+static TapHoldEngine engine;
+static uint32_t now;
+
+static void frame(uint8_t pressed, uint8_t released, uint32_t advanceMs = 1) {
+  now += advanceMs;
+  engine.update(now, pressed, released, activate);
+}
+
+void setUp(void) {
+  engine = TapHoldEngine();
+  engine.configure(0, TapHoldMode::Timeout, 200);
+  now = 0;
+}
+
+void tearDown(void) {}
+
+static void test_plain_key_acts_on_press(void) {
+  frame(0x02, 0);
+  TEST_ASSERT_EQUAL_HEX8(0x02, engine.tapMask());
+  TEST_ASSERT_EQUAL_HEX8(0x02, engine.tapEdges());
+  frame(0, 0x02);
+  TEST_ASSERT_EQUAL_HEX8(0, engine.tapMask());
+}
+
+static void test_release_before_term_is_tap(void) {
+  frame(0x01, 0);
+  TEST_ASSERT_EQUAL_HEX8(0x01, engine.pendingMask());
+  TEST_ASSERT_EQUAL_HEX8(0, engine.tapMask());
+  frame(0, 0x01, 199);
+  TEST_ASSERT_EQUAL_HEX8(0x01, engine.tapMask());
+  TEST_ASSERT_EQUAL_HEX8(0, engine.holdMask());
+  frame(0, 0);
+  TEST_ASSERT_EQUAL_HEX8(0, engine.tapMask());
+}
+
+static void test_held_for_term_is_hold(void) {
+  frame(0x01, 0);
+  frame(0, 0, 199);
+  TEST_ASSERT_EQUAL_HEX8(0, engine.holdMask());
+  frame(0, 0);
+  TEST_ASSERT_EQUAL_HEX8(0x01, engine.holdMask());
+  TEST_ASSERT_EQUAL_HEX8(0x01, engine.holdEdges());
+  frame(0, 0x01);
+  TEST_ASSERT_EQUAL_HEX8(0, engine.holdMask());
+  TEST_ASSERT_EQUAL_HEX8(0, engine.tapMask());
+}
+
+static void test_queued_key_follows_hold(void) {
+  frame(0x01, 0);
+  frame(0x02, 0, 10);
+  TEST_ASSERT_EQUAL_HEX8(0x03, engine.pendingMask());
+  TEST_ASSERT_EQUAL_HEX8(0, engine.tapMask());
+  frame(0, 0, 190);
+  TEST_ASSERT_EQUAL_HEX8(0x01, engine.holdMask());
+  TEST_ASSERT_EQUAL_HEX8(0x02, engine.tapMask());
+  TEST_ASSERT_EQUAL_HEX8(0, engine.pendingMask());
+}
+
+static void test_hold_on_other_press_resolves_at_once(void) {
+  engine.configure(0, TapHoldMode::HoldOnOtherPress, 200);
+  frame(0x01, 0);
+  frame(0x02, 0, 5);
+  TEST_ASSERT_EQUAL_HEX8(0x01, engine.holdMask());
+  TEST_ASSERT_EQUAL_HEX8(0x02, engine.tapMask());
+}
+
+static void test_permissive_hold_needs_a_release(void) {
+  engine.configure(0, TapHoldMode::PermissiveHold, 200);
+  frame(0x01, 0);
+  frame(0x02, 0, 5);
+  TEST_ASSERT_EQUAL_HEX8(0, engine.holdMask());
+  frame(0, 0x02, 5);
+  TEST_ASSERT_EQUAL_HEX8(0x01, engine.holdMask());
+  // The queued key was already up: one press, then its release.
+  TEST_ASSERT_EQUAL_HEX8(0x02, engine.tapMask());
+  frame(0, 0);
+  TEST_ASSERT_EQUAL_HEX8(0, engine.tapMask());
+}
+
+// More taps than queue slots while the dual-role key is undecided: every
+// tap comes out as its own press and release, in order, after the tap.
+static void test_repeated_taps_while_undecided(void) {
+  const int kTaps = 12;
+  frame(0x01, 0);
+  for (int i = 0; i < kTaps; i++) {
+    frame(0x02, 0);
+    frame(0, 0x02);
+  }
+  TEST_ASSERT_EQUAL_HEX8(0x03, engine.pendingMask());
+
+  frame(0, 0x01);
+  TEST_ASSERT_EQUAL_HEX8(0x01, engine.tapMask());
+  TEST_ASSERT_EQUAL_HEX8(0, engine.tapMask() & 0x02);
+
+  int edges = 0;
+  bool down = false;
+  for (int f = 0; f < 4 * kTaps && engine.pendingMask() != 0; f++) {
+    frame(0, 0);
+    const bool nowDown = (engine.tapMask() & 0x02) != 0;
+    if (engine.tapEdges() & 0x02) {
+      TEST_ASSERT_FALSE(down);
+      edges++;
+    }
+    down = nowDown;
+  }
+  frame(0, 0);
+  TEST_ASSERT_EQUAL_INT(kTaps, edges);
+  TEST_ASSERT_EQUAL_HEX8(0, engine.pendingMask());
+  TEST_ASSERT_EQUAL_HEX8(0, engine.tapMask());
+
+  // Still usable afterwards.
+  frame(0x04, 0);
+  TEST_ASSERT_EQUAL_HEX8(0x04, engine.tapMask());
+}
+
+// Held on its last press: the earlier taps replay, then it stays down.
+static void test_repeated_taps_end_held(void) {
+  frame(0x01, 0);
+  frame(0x02, 0);
+  frame(0, 0x02);
+  frame(0x02, 0);
+  frame(0, 0x01);
+
+  int edges = 0;
+  for (int f = 0; f < 8; f++) {
+    frame(0, 0);
+    if (engine.tapEdges() & 0x02) {
+      edges++;
+    }
+  }
+  TEST_ASSERT_EQUAL_INT(2, edges);
+  TEST_ASSERT_EQUAL_HEX8(0x02, engine.tapMask());
+  frame(0, 0x02);
+  TEST_ASSERT_EQUAL_HEX8(0, engine.tapMask());
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_plain_key_acts_on_press);
+  RUN_TEST(test_release_before_term_is_tap);
+  RUN_TEST(test_held_for_term_is_hold);
+  RUN_TEST(test_queued_key_follows_hold);
+  RUN_TEST(test_hold_on_other_press_resolves_at_once);
+  RUN_TEST(test_permissive_hold_needs_a_release);
+  RUN_TEST(test_repeated_taps_while_undecided);
+  RUN_TEST(test_repeated_taps_end_held);
+  return UNITY_END();
+}